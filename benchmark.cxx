@@ -0,0 +1,88 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "VFRendering/Geometry.hxx"
+#include "ThreadPool.hxx"
+
+// Times the index generation of rectilinear grids for increasing numbers of
+// threads. Usage: benchmark [grid size] [repetitions]
+
+static std::vector<float> axisCoordinates(int n) {
+    std::vector<float> coordinates(n);
+    for (int i = 0; i < n; i++) {
+        coordinates[i] = static_cast<float>(i);
+    }
+    return coordinates;
+}
+
+// Returns the fastest of several runs in seconds. Every run uses a new
+// geometry, as geometries cache the generated indices.
+static double measure(const std::function<void(const VFRendering::Geometry&)>& function, int n, int num_repetitions) {
+    double best_duration = 0;
+    for (int repetition = 0; repetition < num_repetitions; repetition++) {
+        auto coordinates = axisCoordinates(n);
+        auto geometry = VFRendering::Geometry::rectilinearGeometry(coordinates, coordinates, coordinates);
+        auto start = std::chrono::steady_clock::now();
+        function(geometry);
+        std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+        if (repetition == 0 || duration.count() < best_duration) {
+            best_duration = duration.count();
+        }
+    }
+    return best_duration;
+}
+
+int main(int argc, char** argv) {
+    int n = 128;
+    int num_repetitions = 3;
+    if (argc > 1) {
+        n = std::max(2, std::atoi(argv[1]));
+    }
+    if (argc > 2) {
+        num_repetitions = std::max(1, std::atoi(argv[2]));
+    }
+
+    VFRendering::Utilities::setNumThreads(0);
+    std::size_t max_num_threads = VFRendering::Utilities::numThreads();
+    std::vector<std::size_t> thread_counts;
+    for (std::size_t num_threads = 1; num_threads < max_num_threads; num_threads *= 2) {
+        thread_counts.push_back(num_threads);
+    }
+    thread_counts.push_back(max_num_threads);
+
+    {
+        auto coordinates = axisCoordinates(n);
+        auto geometry = VFRendering::Geometry::rectilinearGeometry(coordinates, coordinates, coordinates);
+        std::cout << n << "x" << n << "x" << n << " grid: ";
+        std::cout << geometry.numSurfaceTriangles() << " surface triangles, ";
+        std::cout << geometry.numVolumeTetrahedra() << " volume tetrahedra" << std::endl;
+    }
+    std::cout << "threads   surface [s]   speedup   volume [s]   speedup" << std::endl;
+    double serial_surface_duration = 0;
+    double serial_volume_duration = 0;
+    for (std::size_t num_threads : thread_counts) {
+        VFRendering::Utilities::setNumThreads(num_threads);
+        double surface_duration = measure([](const VFRendering::Geometry& geometry) {
+            geometry.surfaceIndices();
+        }, n, num_repetitions);
+        double volume_duration = measure([](const VFRendering::Geometry& geometry) {
+            geometry.volumeIndices();
+        }, n, num_repetitions);
+        if (num_threads == 1) {
+            serial_surface_duration = surface_duration;
+            serial_volume_duration = volume_duration;
+        }
+        std::cout << std::fixed << std::setw(7) << num_threads;
+        std::cout << std::setprecision(4) << std::setw(14) << surface_duration;
+        std::cout << std::setprecision(2) << std::setw(10) << serial_surface_duration / surface_duration;
+        std::cout << std::setprecision(4) << std::setw(13) << volume_duration;
+        std::cout << std::setprecision(2) << std::setw(10) << serial_volume_duration / volume_duration << std::endl;
+    }
+    VFRendering::Utilities::setNumThreads(0);
+    return 0;
+}
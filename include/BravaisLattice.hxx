@@ -0,0 +1,97 @@
+#ifndef VFRENDERING_BRAVAIS_LATTICE_HXX
+#define VFRENDERING_BRAVAIS_LATTICE_HXX
+
+#include <vector>
+#include <array>
+
+#include <glm/glm.hpp>
+
+#include <VFRendering/Geometry.hxx>
+
+namespace VFRendering {
+/** A Bravais lattice with a multi-atom basis.
+ *
+ *  Atom a of cell (i, j, k) is located at
+ *  cell_atoms[a] + i * basis_vectors[0] + j * basis_vectors[1] + k * basis_vectors[2]
+ *  and has the index a * atomStride() + i * cellStrides()[0] + ..., so that
+ *  lattices can describe positions in any loop order.
+ */
+class BravaisLattice {
+public:
+    typedef Geometry::index_type index_type;
+
+    BravaisLattice();
+    /** Creates a lattice with the atom as the fastest and the third lattice
+     *  direction as the slowest index.
+     */
+    BravaisLattice(const std::array<glm::vec3, 3>& basis_vectors, const std::vector<glm::vec3>& cell_atoms, const glm::ivec3& n_cells);
+    BravaisLattice(const std::array<glm::vec3, 3>& basis_vectors, const std::vector<glm::vec3>& cell_atoms, const glm::ivec3& n_cells, index_type atom_stride, const std::array<index_type, 3>& cell_strides);
+
+    /** Tries to find a lattice that reproduces the given positions, including
+     *  their order. Every position is verified, so a detected lattice can
+     *  replace the positions exactly (up to floating point precision).
+     */
+    static bool detect(const std::vector<glm::vec3>& positions, BravaisLattice& lattice);
+
+    const std::array<glm::vec3, 3>& basisVectors() const;
+    const std::vector<glm::vec3>& cellAtoms() const;
+    const glm::ivec3& numCells() const;
+    index_type atomStride() const;
+    const std::array<index_type, 3>& cellStrides() const;
+
+    index_type numPositions() const;
+    glm::vec3 position(index_type index) const;
+    void copyPositions(index_type first, index_type count, glm::vec3* destination) const;
+
+    /** Returns whether the lattice can be tetrahedralized by repeating the
+     *  tetrahedra of a single cell.
+     *
+     *  Single-atom lattices split each cell into six tetrahedra. For
+     *  multi-atom lattices, the Delaunay tetrahedra of one cell are taken from
+     *  a small periodic patch and verified to fill the cell without gaps or
+     *  overlaps. Tetrahedra that would need atoms of cells outside the lattice
+     *  are left out.
+     */
+    bool hasCellTetrahedra() const;
+    index_type numTetrahedra() const;
+    void copyTetrahedra(index_type first, index_type count, std::array<index_type, 4>* destination) const;
+
+private:
+    // A tetrahedron of a cell, repeated for all cells for which the cells of
+    // its vertices exist.
+    struct CellTetrahedron {
+        std::array<glm::ivec3, 4> cell_offsets;
+        std::array<index_type, 4> atoms;
+        glm::ivec3 first_cell;
+        glm::ivec3 num_cells;
+        index_type first_tetrahedron;
+    };
+
+    // One digit of a lattice index, i.e. the atom or a cell coordinate.
+    struct IndexDigit {
+        index_type stride;
+        // the offset per cell, for cell coordinates
+        glm::vec3 offset;
+        bool is_atom;
+    };
+
+    static std::vector<IndexDigit> indexDigits(const std::array<glm::vec3, 3>& basis_vectors, const std::vector<glm::vec3>& cell_atoms, const glm::ivec3& n_cells, index_type atom_stride, const std::array<index_type, 3>& cell_strides);
+    static glm::vec3 digitsPosition(const std::vector<IndexDigit>& digits, const std::vector<glm::vec3>& cell_atoms, index_type index);
+    static bool matchesLattice(const std::vector<glm::vec3>& positions, index_type num_atoms, const glm::ivec3& n_cells, int atom_digit, BravaisLattice& lattice);
+
+    void findCellTetrahedra();
+    void findMultiAtomCellTetrahedra();
+
+    std::array<glm::vec3, 3> m_basis_vectors;
+    std::vector<glm::vec3> m_cell_atoms;
+    glm::ivec3 m_n_cells;
+    index_type m_atom_stride;
+    std::array<index_type, 3> m_cell_strides;
+    // the digits of an index, calculated once for position and copyPositions
+    std::vector<IndexDigit> m_index_digits;
+    std::vector<CellTetrahedron> m_cell_tetrahedra;
+    index_type m_num_tetrahedra;
+};
+}
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef VFRENDERING_CAMERA_BLOCK_HXX
+#define VFRENDERING_CAMERA_BLOCK_HXX
+
+#include <glm/glm.hpp>
+
+#include <VFRendering/Options.hxx>
+
+namespace VFRendering {
+namespace Utilities {
+/** Contents of the std140 uniform block CameraBlock, which shaders declare
+ *  with CAMERA_UNIFORMS, with the matrices of a camera and the position of
+ *  the light in view space.
+ */
+struct CameraBlock {
+    glm::mat4 projection_matrix;
+    glm::mat4 modelview_matrix;
+    glm::vec4 light_position;
+};
+
+/** Binding point that createProgram assigns to CameraBlock. */
+static const unsigned int camera_block_binding = 0;
+
+/** Returns the camera of the given options for a viewport with the given
+ *  aspect ratio, with the light at the camera position.
+ */
+CameraBlock getCameraBlock(const Options& options, float aspect_ratio);
+/** Returns whether two sets of options contain the same camera. */
+bool hasSameCamera(const Options& options, const Options& other_options);
+}
+}
+
+#endif
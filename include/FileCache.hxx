@@ -0,0 +1,55 @@
+#ifndef VFRENDERING_FILE_CACHE_HXX
+#define VFRENDERING_FILE_CACHE_HXX
+
+#include <cstddef>
+#include <string>
+
+namespace VFRendering {
+namespace Utilities {
+/** Returns the path of the cache file with the given name, creating the cache
+ *  directory if necessary, or an empty string if caching is disabled.
+ */
+std::string cacheFilePath(const std::string& name);
+
+/** Writes a cache file consisting of a header followed by data.
+ *
+ *  The file is written under a temporary name first and then renamed, so
+ *  that other processes never see partially written files. Afterwards, the
+ *  least recently used cache files are removed until the cache directory
+ *  fits into the limit set with setCacheSizeLimit. Returns false if the file
+ *  could not be written.
+ */
+bool writeCacheFile(const std::string& path, const void* header, std::size_t header_size, const void* data, std::size_t data_size);
+
+/** Marks a cache file that was read as recently used, so that less recently
+ *  used files are removed before it.
+ */
+void touchCacheFile(const std::string& path);
+
+/** Read-only view of the contents of a file, memory-mapped where supported.
+ */
+class MappedFile {
+public:
+    MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool isValid() const;
+    const char* data() const;
+    std::size_t size() const;
+    /** Reads size bytes starting at offset into memory ahead of their use,
+     *  blocking until they are resident.
+     */
+    void prefetch(std::size_t offset, std::size_t size) const;
+
+private:
+    const char* m_data = nullptr;
+    std::size_t m_size = 0;
+    bool m_is_mapped = false;
+};
+}
+}
+
+#endif
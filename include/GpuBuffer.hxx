@@ -0,0 +1,65 @@
+#ifndef VFRENDERING_GPU_BUFFER_HXX
+#define VFRENDERING_GPU_BUFFER_HXX
+
+#include <cstddef>
+#include <vector>
+
+namespace VFRendering {
+namespace Utilities {
+/** Buffer object for data that is uploaded as a whole, e.g. glyph meshes or
+ *  index data.
+ *
+ *  The storage grows geometrically and is kept when smaller or equally sized
+ *  data is uploaded, unless it would be less than a quarter full, so that
+ *  most updates only need glBufferSubData instead of reallocating the
+ *  storage. The buffer object itself is never recreated, so
+ *  vertex array objects referencing it stay valid.
+ */
+class GpuBuffer {
+public:
+    /** Creates a buffer for the given binding target, e.g. GL_ARRAY_BUFFER.
+     *  A context has to be current.
+     */
+    explicit GpuBuffer(unsigned int target);
+    ~GpuBuffer();
+
+    GpuBuffer(const GpuBuffer&) = delete;
+    GpuBuffer& operator=(const GpuBuffer&) = delete;
+
+    /** Binds the buffer to its target. */
+    void bind() const;
+    /** Binds the buffer and replaces its contents with size bytes of data. */
+    void upload(const void* data, std::size_t size);
+    template<typename T>
+    void upload(const std::vector<T>& data);
+    /** Binds the buffer and sets the size of its contents, which can then be
+     *  written with update. If the storage has to grow, or shrinks because
+     *  size is less than a quarter of the capacity, the previous contents
+     *  are lost.
+     */
+    void resize(std::size_t size);
+    /** Replaces size bytes of the contents starting at offset. The buffer has
+     *  to be bound.
+     */
+    void update(std::size_t offset, std::size_t size, const void* data);
+    unsigned int id() const;
+    /** Returns the size of the contents in bytes. */
+    std::size_t size() const;
+    /** Returns the size of the allocated storage in bytes. */
+    std::size_t capacity() const;
+
+private:
+    unsigned int m_target;
+    unsigned int m_buffer = 0;
+    std::size_t m_size = 0;
+    std::size_t m_capacity = 0;
+};
+
+template<typename T>
+void GpuBuffer::upload(const std::vector<T>& data) {
+    upload(data.data(), sizeof(T) * data.size());
+}
+}
+}
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef VFRENDERING_HALF_FLOAT_HXX
+#define VFRENDERING_HALF_FLOAT_HXX
+
+#include <cstddef>
+#include <cstdint>
+
+namespace VFRendering {
+namespace Utilities {
+/** Converts count floats to IEEE 754 half precision floats, rounding to the
+ *  nearest representable value. Values beyond the half float range become
+ *  infinite.
+ *
+ *  On x86 processors supporting F16C, eight values are converted at once.
+ */
+void floatsToHalfs(const float* source, std::size_t count, std::uint16_t* destination);
+void halfsToFloats(const std::uint16_t* source, std::size_t count, float* destination);
+}
+}
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef VFRENDERING_HASH_HXX
+#define VFRENDERING_HASH_HXX
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace VFRendering {
+namespace Utilities {
+/** Calculates a fast, non-cryptographic 64 bit hash of size bytes of data.
+ *
+ *  Different seeds yield independent hashes, so two calls with different
+ *  seeds can be combined if 64 bit are not enough.
+ */
+std::uint64_t hash(const void* data, std::size_t size, std::uint64_t seed=0);
+
+/** Formats a hash value as 16 hexadecimal digits. */
+std::string hashToString(std::uint64_t hash);
+}
+}
+
+#endif
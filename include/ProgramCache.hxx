@@ -0,0 +1,52 @@
+#ifndef VFRENDERING_PROGRAM_CACHE_HXX
+#define VFRENDERING_PROGRAM_CACHE_HXX
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <utility>
+
+namespace VFRendering {
+namespace Utilities {
+/** Shader programs linked by createProgram for the renderers of one view.
+ *
+ *  Programs only exist in the OpenGL context they were created in, so every
+ *  view has its own cache. It is destroyed after the renderers of the view
+ *  and deletes all programs that are left, so the context of the view has
+ *  to be current when the view is destroyed.
+ */
+struct ProgramCache {
+    ProgramCache() = default;
+    ~ProgramCache();
+
+    ProgramCache(const ProgramCache&) = delete;
+    ProgramCache& operator=(const ProgramCache&) = delete;
+
+    struct CachedProgram {
+        unsigned int program;
+        std::size_t num_references;
+        // when the program was last released, to evict the oldest unused ones
+        std::uint64_t release_time;
+        // whether the binary of the program should still be written to the
+        // cache directory, and since when the program has been in use
+        bool is_binary_pending;
+        std::chrono::steady_clock::time_point use_time;
+    };
+
+    // programs are identified by two independent 64 bit hashes of their
+    // sources and attributes
+    std::map<std::pair<std::uint64_t, std::uint64_t>, CachedProgram> programs;
+    std::uint64_t release_time = 0;
+};
+
+/** Writes the binaries of programs that have been in use for a while to the
+ *  cache directory. Called by the view after drawing, so that programs that
+ *  are released straight away, e.g. while options are changed, are not
+ *  stored.
+ */
+void writeProgramBinaries(ProgramCache& program_cache);
+}
+}
+
+#endif
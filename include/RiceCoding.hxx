@@ -0,0 +1,29 @@
+#ifndef VFRENDERING_RICE_CODING_HXX
+#define VFRENDERING_RICE_CODING_HXX
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace VFRendering {
+namespace Utilities {
+/** Appends count signed integers, read with the given stride, to output.
+ *
+ *  The integers are zigzag-encoded and then written with a Rice code, whose
+ *  parameter is chosen to minimize the encoded size. This suits integers
+ *  that are usually close to zero, e.g. differences between consecutive
+ *  values.
+ */
+void riceEncode(const std::int32_t* values, std::size_t count, std::size_t stride, std::vector<unsigned char>& output);
+
+/** Decodes count integers encoded by riceEncode from the size bytes at
+ *  input and writes them with the given stride. If add is true, they are
+ *  added to the values instead.
+ *
+ *  Returns the number of bytes read, or 0 if the input is invalid.
+ */
+std::size_t riceDecode(const unsigned char* input, std::size_t size, std::size_t count, std::int32_t* values, std::size_t stride, bool add=false);
+}
+}
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef VFRENDERING_STREAMING_BUFFER_HXX
+#define VFRENDERING_STREAMING_BUFFER_HXX
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace VFRendering {
+namespace Utilities {
+/** Vertex buffer for data that is replaced as a whole, e.g. vectors that a
+ *  running simulation updates for every frame.
+ *
+ *  With ARB_buffer_storage, the buffer holds a ring of segments that stay
+ *  mapped. Data is written into the next segment, which the GPU finished
+ *  reading a few updates ago, so that neither the driver nor the GPU have to
+ *  synchronize. A fence is inserted when the ring moves on from a segment and
+ *  waited for before the segment is written again. Otherwise, the storage is
+ *  orphaned and mapped without synchronization.
+ *
+ *  As the data does not start at the beginning of the buffer, and as the
+ *  buffer object may be replaced, vertex attributes have to bind the buffer
+ *  and use offset() after each update.
+ */
+class StreamingBuffer {
+public:
+    explicit StreamingBuffer(std::size_t num_segments=3);
+    ~StreamingBuffer();
+
+    StreamingBuffer(const StreamingBuffer&) = delete;
+    StreamingBuffer& operator=(const StreamingBuffer&) = delete;
+
+    /** Binds the buffer to GL_ARRAY_BUFFER and returns memory for size bytes
+     *  of new data, which may be written from any thread until unmap is
+     *  called.
+     */
+    void* map(std::size_t size);
+    /** Passes the data written to the mapped memory on to the GPU. The buffer
+     *  has to be bound to GL_ARRAY_BUFFER.
+     */
+    void unmap();
+    /** Binds the buffer to GL_ARRAY_BUFFER and returns memory for new data of
+     *  the same size, of which only the given byte ranges (offset and size,
+     *  sorted and not overlapping) changed, e.g. when only some vectors
+     *  changed. Only these ranges may be written until unmap is called.
+     *
+     *  With a persistently mapped ring, the new data is placed in the next
+     *  segment, so that neither the driver nor the GPU have to synchronize,
+     *  and unmap copies the rest from the current segment on the GPU.
+     *  Otherwise, unmap uploads only the changed ranges into the current
+     *  storage.
+     */
+    void* mapRanges(const std::vector<std::array<std::size_t, 2>>& ranges);
+    /** Binds the buffer to GL_ARRAY_BUFFER. */
+    void bind() const;
+    /** Returns the offset of the current data in the buffer. */
+    std::size_t offset() const;
+    std::size_t size() const;
+    /** Returns the size of the allocated storage in bytes, including all
+     *  segments of the ring.
+     */
+    std::size_t capacity() const;
+
+private:
+    void* mapPersistently(std::size_t size);
+    void nextSegment();
+    void fenceSegment(std::size_t segment);
+    void waitForSegment(std::size_t segment);
+    void copyUnchangedRanges(unsigned int source_buffer, std::size_t source_offset);
+    void release();
+
+    std::size_t m_num_segments;
+    unsigned int m_buffer = 0;
+    std::size_t m_size = 0;
+    // persistently mapped storage, its segments and their fences
+    bool m_is_persistent = false;
+    char* m_mapped_data = nullptr;
+    std::size_t m_segment_size = 0;
+    std::size_t m_segment = 0;
+    std::vector<void*> m_fences;
+    // data that cannot be mapped is staged in memory instead
+    bool m_is_staged = false;
+    std::vector<char> m_staged_data;
+    // ranges written after mapRanges and the segment the rest is copied from
+    std::vector<std::array<std::size_t, 2>> m_changed_ranges;
+    bool m_is_mapping_ranges = false;
+    unsigned int m_previous_buffer = 0;
+    std::size_t m_previous_offset = 0;
+};
+}
+}
+
+#endif
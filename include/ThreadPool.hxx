@@ -0,0 +1,47 @@
+#ifndef VFRENDERING_THREAD_POOL_HXX
+#define VFRENDERING_THREAD_POOL_HXX
+
+#include <cstddef>
+#include <functional>
+
+// Without pthread support, emscripten cannot start threads at all.
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+#define VFRENDERING_NO_THREADS
+#endif
+
+namespace VFRendering {
+namespace Utilities {
+/** Calls function(begin, end) for disjoint blocks covering [first, last).
+ *
+ *  The blocks are processed by a process-wide pool of worker threads and the
+ *  calling thread, and parallelFor returns once all blocks are done. Blocks
+ *  are at least min_block_size elements large (except for the last one), so
+ *  that small ranges are processed on the calling thread alone. If function
+ *  throws, the first exception is rethrown in the calling thread.
+ */
+void parallelFor(std::size_t first, std::size_t last, const std::function<void(std::size_t, std::size_t)>& function, std::size_t min_block_size=4096);
+
+/** Returns the number of threads used by parallelFor, including the calling
+ *  thread.
+ */
+std::size_t numThreads();
+
+/** Limits the number of threads used by parallelFor, including the calling
+ *  thread, e.g. to measure how calculations scale. A value of 0 or one
+ *  larger than the pool removes the limit.
+ */
+void setNumThreads(std::size_t num_threads);
+
+/** Calls task on a background thread and returns immediately, e.g. for
+ *  calculations that renderers can poll for.
+ *
+ *  Tasks run one after another on a thread of their own, so that they do not
+ *  delay parallelFor. When the process exits, tasks that have not started
+ *  yet are discarded and the thread is joined once the running one is done.
+ *  Without thread support, the task is called before runInBackground returns.
+ */
+void runInBackground(const std::function<void()>& task);
+}
+}
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef VFRENDERING_TRIANGULATION_HXX
+#define VFRENDERING_TRIANGULATION_HXX
+
+#include <vector>
+#include <array>
+
+#include <glm/glm.hpp>
+
+#include <VFRendering/Geometry.hxx>
+
+namespace VFRendering {
+namespace Triangulation {
+/** Tetrahedralizes the given positions, analytically if they form a Bravais
+ *  lattice and using delaunayTetrahedra otherwise.
+ */
+std::vector<std::array<Geometry::index_type, 4>> tetrahedra(const std::vector<glm::vec3>& positions);
+
+/** Calculates the Delaunay tetrahedralization of the given positions using
+ *  QHull.
+ */
+std::vector<std::array<Geometry::index_type, 4>> delaunayTetrahedra(const std::vector<glm::vec3>& positions);
+
+/** Calculates the Delaunay triangulation of positions that lie in a common
+ *  plane, using QHull on their coordinates within that plane.
+ */
+std::vector<std::array<Geometry::index_type, 3>> planarDelaunayTriangles(const std::vector<glm::vec3>& positions);
+
+/** Finds the boundary of a tetrahedralization, i.e. the faces referenced by
+ *  exactly one tetrahedron, oriented so that their normals point outwards.
+ *
+ *  The faces are distributed into partitions by their hash and each
+ *  partition is matched in its own open addressing hash table, so the work is
+ *  spread over all threads of the thread pool.
+ */
+std::vector<std::array<Geometry::index_type, 3>> boundaryTriangles(const std::vector<glm::vec3>& positions, const std::vector<std::array<Geometry::index_type, 4>>& tetrahedra);
+}
+}
+
+#endif
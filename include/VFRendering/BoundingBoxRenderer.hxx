@@ -1,9 +1,15 @@
 #ifndef VFRENDERING_BOUNDING_BOX_RENDERER_HXX
 #define VFRENDERING_BOUNDING_BOX_RENDERER_HXX
 
+#include <memory>
+
 #include <VFRendering/RendererBase.hxx>
 
 namespace VFRendering {
+namespace Utilities {
+class GpuBuffer;
+}
+
 class BoundingBoxRenderer : public RendererBase {
 public:
     enum Option {
@@ -14,12 +20,18 @@ public:
 
 
     BoundingBoxRenderer(const View& view, const std::vector<glm::vec3>& vertices, const std::vector<float>& dashing_values={});
+    /** Copies the vertices and options of another bounding box renderer, e.g.
+     *  one returned by forCuboid. The copy creates its own buffers when it is
+     *  drawn for the first time.
+     */
+    BoundingBoxRenderer(const BoundingBoxRenderer& other);
     static BoundingBoxRenderer forCuboid(const View& view, const glm::vec3& center, const glm::vec3& side_lengths, const glm::vec3& periodic_boundary_condition_lengths={0.0f, 0.0f, 0.0f}, float dashes_per_length=1.0f);
     static BoundingBoxRenderer forParallelepiped(const View& view, const glm::vec3& center, const glm::vec3& v1, const glm::vec3& v2, const glm::vec3& v3, const glm::vec3& periodic_boundary_condition_lengths={0.0f, 0.0f, 0.0f}, float dashes_per_length=1.0f);
     static BoundingBoxRenderer forHexagonalCell(const View& view, const glm::vec3& center, float radius, float height, const glm::vec2& periodic_boundary_condition_lengths={0.0f, 0.0f}, float dashes_per_length=1.0f);
     virtual ~BoundingBoxRenderer();
     virtual void draw(float aspect_ratio) override;
     virtual void optionsHaveChanged(const std::vector<int>& changed_options) override;
+    virtual std::size_t gpuMemoryUsage() const override;
 
 protected:
     virtual void update(bool keep_geometry) override;
@@ -30,9 +42,10 @@ private:
     
     bool m_is_initialized = false;
     unsigned int m_program = 0;
+    int m_color_location = -1;
     unsigned int m_vao = 0;
-    unsigned int m_vbo = 0;
-    unsigned int m_dash_vbo = 0;
+    std::unique_ptr<Utilities::GpuBuffer> m_vbo;
+    std::unique_ptr<Utilities::GpuBuffer> m_dash_vbo;
     unsigned int num_vertices = 0;
     std::vector<glm::vec3> m_vertices;
     std::vector<float> m_dashing_values;
@@ -15,11 +15,14 @@ public:
     virtual void draw(float aspect_ratio) override;
     virtual void optionsHaveChanged(const std::vector<int>& changed_options) override;
     virtual void updateOptions(const Options& options) override;
+    virtual std::size_t gpuMemoryUsage() const override;
 
 protected:
     virtual void update(bool keep_geometry) override;
 
 private:
+    virtual void sharedGpuMemoryUsage(std::map<const void*, std::size_t>& shared_memory_usage) const override;
+
     std::vector<std::shared_ptr<RendererBase>> m_renderers;
 };
 }
@@ -1,9 +1,15 @@
 #ifndef VFRENDERING_COORDINATE_SYSTEM_RENDERER_HXX
 #define VFRENDERING_COORDINATE_SYSTEM_RENDERER_HXX
 
+#include <memory>
+
 #include <VFRendering/RendererBase.hxx>
 
 namespace VFRendering {
+namespace Utilities {
+class GpuBuffer;
+}
+
 class CoordinateSystemRenderer : public RendererBase {
 public:
     enum Option {
@@ -21,6 +27,7 @@ public:
     virtual ~CoordinateSystemRenderer();
     virtual void draw(float aspect_ratio) override;
     virtual void optionsHaveChanged(const std::vector<int>& changed_options) override;
+    virtual std::size_t gpuMemoryUsage() const override;
 
 protected:
     virtual void update(bool keep_geometry) override;
@@ -33,8 +40,9 @@ private:
     bool m_is_initialized = false;
 
     unsigned int m_program = 0;
+    int m_origin_location = -1;
     unsigned int m_vao = 0;
-    unsigned int m_vbo = 0;
+    std::unique_ptr<Utilities::GpuBuffer> m_vbo;
     unsigned int m_num_vertices = 0;
 };
 
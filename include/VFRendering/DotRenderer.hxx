@@ -22,23 +22,23 @@ public:
     DotRenderer(const View& view, const VectorField& vf);
     virtual ~DotRenderer();
     virtual void update(bool keep_geometry) override;
+    virtual void updatePositions() override;
     virtual void draw(float aspect_ratio) override;
     virtual void optionsHaveChanged(const std::vector<int>& changed_options) override;
     std::string getDotStyle(const DotStyle& dotstyle);
 
 private:
     void updateShaderProgram();
+    void updateChannels() override;
     void updateVertexData();
     void initialize();
 
     bool m_is_initialized = false;
     
     unsigned int m_program = 0;
+    int m_dot_radius_location = -1;
     unsigned int m_vao = 0;
     
-    unsigned int m_instance_position_vbo = 0;
-    unsigned int m_instance_direction_vbo = 0;
-    
     unsigned int m_num_instances = 0;
 };
 
@@ -3,10 +3,21 @@
 
 #include <vector>
 #include <array>
+#include <cstdint>
+#include <future>
+#include <memory>
 
 #include <glm/glm.hpp>
 
 namespace VFRendering {
+class BravaisLattice;
+
+/** The positions of a vector field and their surface triangles and volume
+ *  tetrahedra.
+ *
+ *  Geometries are immutable handles to shared data, so copying them is cheap
+ *  and copies share lazily calculated indices and bounds.
+ */
 class Geometry {
 public:
     /** Type for use as indices into positions and vectors.
@@ -31,18 +42,91 @@ public:
     const glm::vec3& max() const;
     const bool& is2d() const;
 
+    /** Starts calculating the volume indices on a background thread, unless
+     *  they are available already or are being calculated.
+     *
+     *  The returned future becomes ready once volumeIndices() returns without
+     *  running QHull, so renderers can poll it instead of blocking. Copies
+     *  of this geometry share the background calculation.
+     */
+    std::shared_future<void> prepareVolumeIndices() const;
+
+    /** Returns a hash of the data this geometry was created from, i.e. of
+     *  the positions (or grid or lattice description) and of the indices
+     *  passed to the constructor.
+     */
+    std::uint64_t contentHash() const;
+    /** Geometries are equal if they share their data or if they were
+     *  created from the same data.
+     */
+    bool operator==(const Geometry& other) const;
+    bool operator!=(const Geometry& other) const;
+
+    /** Returns a geometry equal to the given one, sharing its data with an
+     *  equal geometry that is still in use, if there is one.
+     *
+     *  This way, geometries that are created independently from the same
+     *  data are only stored once.
+     */
+    static Geometry shared(const Geometry& geometry);
+
+    /** Returns a geometry with the given positions and the surface triangles
+     *  and volume tetrahedra of this geometry, e.g. for atoms that move while
+     *  their connectivity stays the same.
+     *
+     *  The indices are shared instead of being calculated again, and bounds
+     *  are only calculated again for blocks of positions that changed. If the
+     *  number of positions differs from numPositions(), a geometry with its
+     *  own indices is returned instead.
+     */
+    Geometry withPositions(const std::vector<glm::vec3>& positions) const;
+    /** Like withPositions, but only replaces the count positions starting
+     *  with the one at index first.
+     */
+    Geometry withPositions(index_type first, index_type count, const glm::vec3* positions) const;
+    /** Returns whether this geometry and the given one have the same surface
+     *  triangles and volume tetrahedra because one was created from the
+     *  other by withPositions.
+     */
+    bool hasSameTopology(const Geometry& other) const;
+
+    /** Returns whether this geometry is a rectilinear grid or a Bravais
+     *  lattice that only stores its axis coordinates or lattice description
+     *  and computes positions, surface triangles and volume tetrahedra on
+     *  demand.
+     *
+     *  For such geometries, positions(), surfaceIndices() and volumeIndices()
+     *  still work, but they materialize and cache the full arrays. To avoid
+     *  this, use the size and copy functions below.
+     */
+    bool isImplicit() const;
+    index_type numPositions() const;
+    index_type numSurfaceTriangles() const;
+    index_type numVolumeTetrahedra() const;
+    glm::vec3 position(index_type index) const;
+    void copyPositions(index_type first, index_type count, glm::vec3* destination) const;
+    void copySurfaceIndices(index_type first, index_type count, std::array<index_type, 3>* destination) const;
+    void copyVolumeIndices(index_type first, index_type count, std::array<index_type, 4>* destination) const;
+
     static Geometry cartesianGeometry(glm::ivec3 n, glm::vec3 bounds_min, glm::vec3 bounds_max);
     static Geometry rectilinearGeometry(const std::vector<float>& xs, const std::vector<float>& ys, const std::vector<float>& zs);
+    /** Creates a Bravais lattice geometry, with atom a of cell (i, j, k) at
+     *  cell_atoms[a] + i * basis_vectors[0] + j * basis_vectors[1] + k * basis_vectors[2]
+     *  and the atom as the fastest and k as the slowest index.
+     */
+    static Geometry bravaisLatticeGeometry(const std::array<glm::vec3, 3>& basis_vectors, const std::vector<glm::vec3>& cell_atoms, glm::ivec3 n_cells);
 
 private:
-    std::vector<glm::vec3> m_positions;
-    mutable std::vector<std::array<index_type, 3>> m_surface_indices;
-    mutable std::vector<std::array<index_type, 4>> m_volume_indices;
-    bool m_is_2d;
-    mutable bool m_bounds_min_set;
-    mutable glm::vec3 m_bounds_min;
-    mutable bool m_bounds_max_set;
-    mutable glm::vec3 m_bounds_max;
+    struct Data;
+
+    // the geometry whose surface triangles and volume tetrahedra are used
+    Geometry topology() const;
+    void calculateBounds() const;
+    bool hasImplicitSurfaceIndices() const;
+    bool hasImplicitVolumeIndices() const;
+    glm::ivec3 gridSize() const;
+
+    std::shared_ptr<Data> m_data;
 };
 }
 
@@ -13,12 +13,15 @@ public:
     GlyphRenderer(const View& view, const VectorField& vf);
     virtual ~GlyphRenderer();
     virtual void update(bool keep_geometry) override;
+    virtual void updatePositions() override;
     virtual void draw(float aspect_ratio) override;
     virtual void optionsHaveChanged(const std::vector<int>& changed_options) override;
+    virtual std::size_t gpuMemoryUsage() const override;
     void setGlyph(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals, const std::vector<std::uint16_t>& indices);
 
 private:
     void updateShaderProgram();
+    void updateChannels() override;
     void updateVertexData();
     void initialize();
 
@@ -28,11 +31,9 @@ private:
     std::vector<std::uint16_t> m_indices;
     unsigned int m_program = 0;
     unsigned int m_vao = 0;
-    unsigned int m_position_vbo = 0;
-    unsigned int m_normal_vbo = 0;
-    unsigned int m_ibo = 0;
-    unsigned int m_instance_position_vbo = 0;
-    unsigned int m_instance_direction_vbo = 0;
+    std::unique_ptr<Utilities::GpuBuffer> m_position_vbo;
+    std::unique_ptr<Utilities::GpuBuffer> m_normal_vbo;
+    std::unique_ptr<Utilities::GpuBuffer> m_ibo;
     unsigned int m_num_indices = 0;
     unsigned int m_num_instances = 0;
 };
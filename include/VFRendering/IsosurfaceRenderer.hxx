@@ -2,10 +2,17 @@
 #define VFRENDERING_ISOSURFACE_RENDERER_HXX
 
 #include <functional>
+#include <memory>
 
 #include <VFRendering/VectorFieldRenderer.hxx>
 
 namespace VFRendering {
+/** Renders an isosurface of a value function of the vector field.
+ *
+ *  For arbitrary geometries, the tetrahedralization is calculated on a
+ *  background thread and nothing is drawn until it is ready, so applications
+ *  should keep drawing (e.g. with a timer) until the isosurface appears.
+ */
 class IsosurfaceRenderer : public VectorFieldRenderer {
 public:
 
@@ -23,9 +30,11 @@ public:
     virtual ~IsosurfaceRenderer();
     virtual void draw(float aspect_ratio) override;
     virtual void optionsHaveChanged(const std::vector<int>& changed_options) override;
+    virtual std::size_t gpuMemoryUsage() const override;
 
 protected:
     virtual void update(bool keep_geometry) override;
+    virtual void updatePositions() override;
 
 private:
     void updateShaderProgram();
@@ -34,15 +43,19 @@ private:
 
     bool m_is_initialized = false;
     unsigned int m_program = 0;
+    int m_z_range_location = -1;
+    int m_flip_normals_location = -1;
     unsigned int m_vao = 0;
-    unsigned int m_ibo = 0;
-    unsigned int m_position_vbo = 0;
-    unsigned int m_direction_vbo = 0;
-    unsigned int m_normal_vbo = 0;
+    std::unique_ptr<Utilities::GpuBuffer> m_ibo;
+    std::unique_ptr<Utilities::StreamingBuffer> m_position_buffer;
+    std::unique_ptr<Utilities::StreamingBuffer> m_direction_buffer;
+    std::unique_ptr<Utilities::StreamingBuffer> m_normal_buffer;
     unsigned int m_num_indices = 0;
 
     bool m_value_function_changed;
     bool m_isovalue_changed;
+    bool m_positions_changed = false;
+    bool m_is_waiting_for_volume_indices = false;
 };
 
 namespace Utilities {
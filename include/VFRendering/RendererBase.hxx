@@ -1,6 +1,9 @@
 #ifndef VFRENDERING_RENDERER_BASE_HXX
 #define VFRENDERING_RENDERER_BASE_HXX
 
+#include <cstddef>
+#include <map>
+#include <memory>
 #include <vector>
 
 #include <glm/glm.hpp>
@@ -9,12 +12,19 @@
 #include <VFRendering/Options.hxx>
 
 namespace VFRendering {
+namespace Utilities {
+class GpuBuffer;
+struct CameraBlock;
+}
+
 class RendererBase {
 public:
 
     RendererBase(const View& view);
+    /** Copies the view and options of another renderer. */
+    RendererBase(const RendererBase& other);
 
-    virtual ~RendererBase() {};
+    virtual ~RendererBase();
     virtual void update(bool keep_geometry) = 0;
     virtual void draw(float aspect_ratio) = 0;
     virtual void updateOptions(const Options& options);
@@ -25,12 +35,50 @@ public:
     typename Options::Type<index>::type getOption() const;
     virtual void optionsHaveChanged(const std::vector<int>& changed_options);
     virtual void updateIfNecessary();
+    /** Returns the number of bytes of GPU buffer storage the renderer uses.
+     *  Buffers shared with other renderers are counted for each of them,
+     *  except by a CombinedRenderer, which counts them once.
+     */
+    virtual std::size_t gpuMemoryUsage() const;
 
 protected:
     virtual void options(const Options& options);
+    /** Makes the camera of the renderer's options available to the shaders
+     *  of the given program, which has to be in use, as uProjectionMatrix,
+     *  uModelviewMatrix and uLightPosition. While the view draws, renderers
+     *  using its camera bind the camera uniform block it wrote for the
+     *  viewport.
+     */
+    void useCamera(unsigned int program, float aspect_ratio) const;
+    /** Makes a camera of the renderer's own available to the shaders of the
+     *  given program, e.g. one that only follows the orientation of the
+     *  view's camera.
+     */
+    void useCamera(unsigned int program, const glm::mat4& projection_matrix, const glm::mat4& modelview_matrix, const glm::vec3& light_position) const;
+    /** Looks up the uniform of the colormap range in the renderer's program
+     *  using the colormap. Call this after creating the program.
+     */
+    void resolveColormapUniforms(unsigned int program);
+    /** Sets the colormap range of the renderer's options for the program
+     *  passed to resolveColormapUniforms, which has to be in use.
+     */
+    void setColormapUniforms() const;
     const View& m_view;
 private:
+    friend class CombinedRenderer;
+
+    void useCamera(unsigned int program, const Utilities::CameraBlock& camera_block) const;
+    /** Adds the number of bytes of storage in buffers shared with other
+     *  renderers, which gpuMemoryUsage includes, to shared_memory_usage,
+     *  keyed by the address of whatever holds these buffers.
+     */
+    virtual void sharedGpuMemoryUsage(std::map<const void*, std::size_t>& shared_memory_usage) const;
+
     Options m_options;
+    int m_colormap_z_range_location = -1;
+    mutable std::unique_ptr<Utilities::GpuBuffer> m_camera_buffer;
+    // contents of m_camera_buffer
+    mutable std::vector<char> m_camera_block;
 };
 
 template<int index>
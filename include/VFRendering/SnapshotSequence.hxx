@@ -0,0 +1,200 @@
+#ifndef VFRENDERING_SNAPSHOT_SEQUENCE_HXX
+#define VFRENDERING_SNAPSHOT_SEQUENCE_HXX
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <VFRendering/Geometry.hxx>
+#include <VFRendering/VectorField.hxx>
+
+namespace VFRendering {
+namespace Utilities {
+class MappedFile;
+}
+
+/** Plays back a sequence of vector snapshots, e.g. of a simulation run, from
+ *  a file written by SnapshotSequenceWriter or
+ *  CompressedSnapshotSequenceWriter.
+ *
+ *  The file is memory-mapped. For uncompressed files, the vector field reads
+ *  the vectors of the current frame directly from the mapping, so frames are
+ *  neither parsed nor copied. Compressed frames are decoded in parallel into
+ *  a buffer the vector field reads from. A background thread reads the
+ *  upcoming frames into memory while the current one is shown.
+ *
+ *  Uncompressed files consist of a 24 byte header, the characters
+ *  "VFRSNAP1", the size of a vector component (4 for float or 8 for double)
+ *  as a 32 bit integer, 4 reserved bytes and the number of vectors per frame
+ *  as a 64 bit integer, followed by the frames, each with three components
+ *  per vector. All values are little-endian.
+ */
+class SnapshotSequence {
+public:
+    /** Opens the file at path and shows its first frame in vf, which has to
+     *  outlive this sequence. num_prefetched_frames frames after the current
+     *  one are prefetched.
+     *
+     *  When the sequence is destroyed, vf keeps a copy of the current frame.
+     */
+    SnapshotSequence(VectorField& vf, const std::string& path, std::size_t num_prefetched_frames=8);
+    ~SnapshotSequence();
+
+    SnapshotSequence(const SnapshotSequence&) = delete;
+    SnapshotSequence& operator=(const SnapshotSequence&) = delete;
+
+    /** Returns whether the file could be opened and all frames shown so far
+     *  could be decoded. After a corrupted frame, the vector field keeps the
+     *  last frame that could be decoded and playback stops.
+     */
+    bool isValid() const;
+    Geometry::index_type numVectors() const;
+    std::size_t numFrames() const;
+    std::size_t currentFrame() const;
+
+    /** Shows the given frame. If the sequence is playing, playback continues
+     *  from this frame.
+     */
+    void seek(std::size_t frame);
+    /** Starts playing from the current frame. After the last frame, playback
+     *  either starts over or stops.
+     */
+    void play(double frames_per_second, bool is_looping=true);
+    void pause();
+    bool isPlaying() const;
+    /** Shows the frame that is due according to the playback rate and returns
+     *  whether it changed. Call this before drawing the view.
+     *
+     *  If drawing takes longer than the time between two frames, frames are
+     *  skipped, so that playback keeps to the given rate.
+     */
+    bool update();
+
+private:
+    bool openCompressedFile();
+    void showFrame(std::size_t frame);
+    // decodes the quantized vectors of a frame, returning false if the frame
+    // is corrupted
+    bool decodeFrame(std::size_t frame);
+    void prefetchFrames();
+
+    VectorField& m_vf;
+    std::unique_ptr<Utilities::MappedFile> m_file;
+    Geometry::index_type m_num_vectors = 0;
+    std::size_t m_component_size = 0;
+    std::size_t m_num_frames = 0;
+    std::size_t m_current_frame = 0;
+    bool m_is_playing = false;
+    bool m_is_looping = true;
+    double m_frames_per_second = 0;
+    std::size_t m_play_start_frame = 0;
+    std::chrono::steady_clock::time_point m_play_start_time;
+
+    // for compressed files, the offsets of the frames and the end of the
+    // last one, the latest keyframe at or before each frame and the decoded
+    // state of the frame m_decoded_frame
+    bool m_is_compressed = false;
+    std::vector<std::size_t> m_frame_offsets;
+    std::vector<std::size_t> m_keyframes;
+    std::size_t m_block_size = 0;
+    float m_quantization_step = 0;
+    std::vector<std::int32_t> m_quantized_vectors;
+    std::vector<glm::vec3> m_decoded_vectors;
+    std::size_t m_decoded_frame = 0;
+    bool m_has_decoded_frame = false;
+    bool m_has_decoding_error = false;
+
+    std::size_t m_num_prefetched_frames;
+    std::thread m_prefetch_thread;
+    std::mutex m_prefetch_mutex;
+    std::condition_variable m_prefetch_condition_variable;
+    // the frame after which frames are prefetched and whether it changed
+    std::size_t m_prefetch_frame = 0;
+    bool m_has_prefetch_frame_changed = false;
+    bool m_is_stopping = false;
+};
+
+/** Writes a sequence of vector snapshots in the format read by
+ *  SnapshotSequence.
+ */
+class SnapshotSequenceWriter {
+public:
+    /** Creates the file at path for frames of num_vectors vectors, stored as
+     *  doubles if is_double_precision is true and as floats otherwise.
+     */
+    SnapshotSequenceWriter(const std::string& path, Geometry::index_type num_vectors, bool is_double_precision=false);
+
+    bool isValid() const;
+    /** Appends a frame of numVectors() vectors, converting them if
+     *  necessary. Returns false if the frame could not be written.
+     */
+    bool appendFrame(const glm::vec3* vectors);
+    bool appendFrame(const double* vectors);
+    bool appendFrame(const std::vector<glm::vec3>& vectors);
+    Geometry::index_type numVectors() const;
+
+private:
+    std::ofstream m_file;
+    Geometry::index_type m_num_vectors;
+    bool m_is_double_precision;
+};
+
+/** Writes a sequence of vector snapshots in a compressed format read by
+ *  SnapshotSequence.
+ *
+ *  The vector components are quantized to multiples of quantization_step.
+ *  Every keyframe_interval-th frame is a keyframe, storing the quantized
+ *  components themselves, while the other frames store their differences to
+ *  the previous frame. Both are entropy coded with Rice codes, which suits
+ *  the small differences of smoothly evolving vectors. As the differences
+ *  are taken between quantized components, errors do not accumulate over
+ *  the frames, so each component differs by at most half the quantization
+ *  step from the original one.
+ *
+ *  The frames are split into blocks of vectors that are coded independently,
+ *  so that they can be encoded and decoded in parallel. The file consists of
+ *  a 24 byte header, the characters "VFRSNAPZ", the number of vectors per
+ *  block as a 32 bit integer, the quantization step as a 32 bit float and
+ *  the number of vectors per frame as a 64 bit integer. Each frame starts
+ *  with a 32 bit integer that is 1 for keyframes and 0 otherwise, followed by
+ *  the number of blocks and the size of each block in bytes as 32 bit
+ *  integers, and the blocks. All values are little-endian.
+ */
+class CompressedSnapshotSequenceWriter {
+public:
+    /** Creates the file at path for frames of num_vectors vectors. */
+    CompressedSnapshotSequenceWriter(const std::string& path, Geometry::index_type num_vectors, float quantization_step=1e-4f, std::size_t keyframe_interval=64);
+
+    bool isValid() const;
+    /** Appends a frame of numVectors() vectors. Returns false if the frame
+     *  could not be written.
+     */
+    bool appendFrame(const glm::vec3* vectors);
+    bool appendFrame(const double* vectors);
+    bool appendFrame(const std::vector<glm::vec3>& vectors);
+    Geometry::index_type numVectors() const;
+
+private:
+    template<typename T>
+    bool appendQuantizedFrame(const T* components);
+
+    std::ofstream m_file;
+    Geometry::index_type m_num_vectors;
+    float m_quantization_step;
+    std::size_t m_keyframe_interval;
+    std::size_t m_num_frames = 0;
+    std::vector<std::int32_t> m_quantized_vectors;
+    std::vector<std::int32_t> m_previous_quantized_vectors;
+};
+}
+
+#endif
@@ -13,21 +13,22 @@ public:
     virtual ~SurfaceRenderer();
     virtual void draw(float aspect_ratio) override;
     virtual void optionsHaveChanged(const std::vector<int>& changed_options) override;
+    virtual std::size_t gpuMemoryUsage() const override;
 
 protected:
     virtual void update(bool keep_geometry) override;
+    virtual void updatePositions() override;
 
 private:
     void updateShaderProgram();
+    void updateChannels() override;
     void updateSurfaceIndices();
     void initialize();
 
     bool m_is_initialized = false;
     unsigned int m_program = 0;
     unsigned int m_vao = 0;
-    unsigned int m_ibo = 0;
-    unsigned int m_position_vbo = 0;
-    unsigned int m_direction_vbo = 0;
+    std::unique_ptr<Utilities::GpuBuffer> m_ibo;
     unsigned int m_num_indices = 0;
 };
 
@@ -9,6 +9,7 @@
 
 namespace VFRendering {
 using Options = Utilities::Options;
+class View;
 
 namespace Utilities {
 
@@ -17,10 +18,32 @@ public:
     OpenGLException(const std::string& message);
 };
 
-unsigned int createProgram(const std::string& vertex_shader_source,
+/** Returns a program linked from the given sources, with the attributes
+ *  bound to consecutive locations, for a renderer of the given view.
+ *
+ *  Programs are cached by a hash of their sources and attributes, so that
+ *  renderers of the view with the same shaders share one program. Each view
+ *  has its own cache, as the view may use a different OpenGL context than
+ *  other views, and deletes its programs when it is destroyed. A program has
+ *  to be passed to releaseProgram instead of being deleted, and as its
+ *  uniforms are shared as well, they have to be set before each draw call.
+ *
+ *  Where the driver supports it, linked programs are also stored in the
+ *  cache directory and loaded from there when the same sources are used
+ *  with the same driver again. Binaries the driver rejects are replaced by
+ *  newly compiled programs.
+ */
+unsigned int createProgram(const View& view,
+                           const std::string& vertex_shader_source,
                            const std::string& fragment_shader_source,
                            const std::vector<std::string>& attributes);
 
+/** Releases a program returned by createProgram. Programs that are no longer
+ *  used are kept for a while, so that switching back to previous options,
+ *  e.g. a colormap, does not have to compile them again.
+ */
+void releaseProgram(const View& view, unsigned int program);
+
 enum class Colormap {
     DEFAULT,
     BLUERED,
@@ -32,9 +55,35 @@ enum class Colormap {
 };
 
 std::string getColormapImplementation(const Colormap& colormap);
+/** Returns an implementation of the colormap that uses its full range of
+ *  colors for the z components of the vectors in View::Option::COLORMAP_Z_RANGE,
+ *  e.g. those of VectorField::statistics(), instead of the z components of
+ *  the normalized vectors from -1 to 1.
+ *
+ *  The range is passed to the shaders as a uniform, so changing it does not
+ *  compile the shaders again.
+ */
+std::string getRangedColormapImplementation(const Colormap& colormap);
 
 std::pair<glm::mat4, glm::mat4> getMatrices(const VFRendering::Options& options, float aspect_ratio);
 
+/** Sets the directory used for persistent caches, e.g. of tetrahedralizations
+ *  and shader program binaries.
+ *
+ *  It defaults to $VFRENDERING_CACHE_DIR or a vfrendering directory in the
+ *  user's cache directory. An empty string disables caching.
+ */
+void setCacheDirectory(const std::string& directory);
+std::string getCacheDirectory();
+
+/** Sets the maximum total size in bytes of the files in the cache directory.
+ *
+ *  Whenever a file is added to a cache directory exceeding this size, the
+ *  least recently used files are removed. It defaults to 1 GiB.
+ */
+void setCacheSizeLimit(std::size_t size_limit);
+std::size_t getCacheSizeLimit();
+
 }
 }
 
@@ -2,7 +2,12 @@
 #define VFRENDERING_VECTORFIELD_HXX
 
 #include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
 #include <memory>
+#include <string>
 
 #include <glm/glm.hpp>
 
@@ -15,27 +20,300 @@ namespace VFRendering {
 
 class VectorField {
 public:
+    /** Formats for storing and uploading the vectors. */
+    enum class DirectionEncoding {
+        // three 32 bit floats per vector
+        FLOAT,
+        // two 16 bit integers per vector, storing the octahedral encoding of
+        // its direction, so that all vectors except zero vectors are treated
+        // as unit vectors
+        OCTAHEDRAL,
+        // three 16 bit integers per vector, the octahedral encoding of its
+        // direction and its length relative to the longest vector
+        OCTAHEDRAL_WITH_MAGNITUDE,
+        // three 16 bit half precision floats per vector
+        HALF_FLOAT
+    };
+
+    /** Formats for uploading the positions of the geometry. */
+    enum class PositionEncoding {
+        // three 32 bit floats per position
+        FLOAT,
+        // three 16 bit half precision floats per position, relative to the
+        // center of a brick of consecutive positions
+        HALF_FLOAT
+    };
+
+    /** Statistics of the vectors, e.g. for overlays or colormap ranges. */
+    struct Statistics {
+        static const unsigned int num_histogram_bins = 64;
+
+        Geometry::index_type num_vectors = 0;
+        // the sum of the vectors, e.g. the total magnetization
+        glm::dvec3 sum = glm::dvec3(0);
+        // the componentwise minimum and maximum of the vectors
+        glm::vec3 min = glm::vec3(0);
+        glm::vec3 max = glm::vec3(0);
+        float min_length = 0;
+        float max_length = 0;
+        // the number of directions per bin of the z component of the
+        // normalized vectors from -1 to 1, so that all bins cover the same
+        // solid angle, and per bin of the azimuthal angle from -pi to pi.
+        // Vectors of length zero are not counted.
+        std::array<Geometry::index_type, num_histogram_bins> z_histogram = {{}};
+        std::array<Geometry::index_type, num_histogram_bins> azimuth_histogram = {{}};
+
+        glm::dvec3 mean() const;
+    };
 
     VectorField(const Geometry& geometry, const std::vector<glm::vec3>& vectors);
     virtual ~VectorField();
 
     void update(const Geometry& geometry, const std::vector<glm::vec3>& vectors);
+    /** Replaces the geometry. If the new geometry was created from the
+     *  current one by Geometry::withPositions, only the positions changed, so
+     *  this is equivalent to updatePositions.
+     */
     void updateGeometry(const Geometry& geometry);
+    /** Moves the positions while keeping the surface triangles and volume
+     *  tetrahedra of the geometry, so that renderers only upload the
+     *  positions again instead of rebuilding their index buffers.
+     *
+     *  If the number of positions changes, the geometry is replaced instead.
+     */
+    void updatePositions(const std::vector<glm::vec3>& positions);
+    void updatePositions(Geometry::index_type first, Geometry::index_type count, const glm::vec3* positions);
+    /** Replaces the vectors.
+     *
+     *  Blocks of vectors are hashed and compared to the previous vectors, so
+     *  that the update id only changes if the vectors did, and renderers only
+     *  upload the blocks that changed.
+     */
     void updateVectors(const std::vector<glm::vec3>& vectors);
+    /** Uses count vectors of three floats or doubles from memory owned by
+     *  the caller instead of copying them, with stride bytes from one vector
+     *  to the next.
+     *
+     *  The memory has to stay valid until the vectors are updated again or
+     *  this vector field is destroyed. Renderers read it when they are
+     *  updated during their next draw call, so call updateVectors again after
+     *  changing the memory.
+     */
+    void updateVectors(const float* vectors, Geometry::index_type count, std::size_t stride=3 * sizeof(float));
+    void updateVectors(const double* vectors, Geometry::index_type count, std::size_t stride=3 * sizeof(double));
+    /** Replaces count vectors, starting with the vector at index first, so
+     *  that renderers only need to upload the changed range.
+     *
+     *  If the vectors are in caller-owned memory, vectors may be nullptr to
+     *  mark a range of that memory as changed. With a direction encoding
+     *  other than FLOAT, caller-owned memory is not referenced, so nullptr
+     *  throws std::invalid_argument.
+     */
+    void updateVectors(Geometry::index_type first, Geometry::index_type count, const glm::vec3* vectors);
+
+    /** Publishes a snapshot of the vectors from a producer thread, e.g. a
+     *  simulation running alongside the rendering thread.
+     *
+     *  Publishing is wait-free, as the vectors are passed through a triple
+     *  buffer. Only one thread may publish vectors, and a snapshot that was
+     *  not acquired yet is replaced by the next one.
+     */
+    void publishVectors(const glm::vec3* vectors, Geometry::index_type count);
+    void publishVectors(const std::vector<glm::vec3>& vectors);
+    /** Makes the latest published snapshot the current vectors, if there is
+     *  a new one, and returns whether there was.
+     *
+     *  Renderers call this when they are drawn, so it has to be called from
+     *  the thread using the vector field otherwise.
+     */
+    bool acquirePublishedVectors() const;
 
+    /** Sets the format the vectors are stored and uploaded in.
+     *
+     *  With encodings other than FLOAT, vectors are encoded when they are
+     *  updated and only the encoded vectors are kept, so vectors in
+     *  caller-owned memory are not referenced after updateVectors returns.
+     *  Functions returning the vectors decode them.
+     */
+    void setDirectionEncoding(DirectionEncoding direction_encoding);
+    DirectionEncoding directionEncoding() const;
+    /** Returns the encoded vectors, with numEncodedComponents() signed
+     *  normalized 16 bit integers or half floats per vector, or nullptr for
+     *  the FLOAT encoding.
+     */
+    const std::int16_t* encodedVectorsData() const;
+    unsigned int numEncodedComponents() const;
+    /** Returns the length that the magnitudes of the
+     *  OCTAHEDRAL_WITH_MAGNITUDE encoding are relative to.
+     */
+    float encodedMagnitudeScale() const;
+
+    /** Sets the format renderers upload the positions in.
+     *
+     *  The positions are converted while they are uploaded, so the geometry
+     *  itself is not changed. Half floats only have a precision of 11 bits,
+     *  so for HALF_FLOAT, consecutive positions are grouped in bricks, which
+     *  store their positions relative to their center. This works best for
+     *  geometries with nearby consecutive positions, such as grids and
+     *  lattices.
+     */
+    void setPositionEncoding(PositionEncoding position_encoding);
+    PositionEncoding positionEncoding() const;
+
+    /** Sets a named channel of additional per-point values, e.g. an energy
+     *  or a charge, with one value or three components per point.
+     *
+     *  Renderers upload each channel to a buffer of its own, so updating a
+     *  channel does not upload the directions or other channels again. The
+     *  colormap and visibility implementations can use the values of the
+     *  current point through a float or vec3 variable named after the
+     *  channel, so the name has to be a valid GLSL identifier. Renderers that
+     *  do not draw individual points, like the isosurface renderer, set these
+     *  variables to zero, and renderers without a vector field do not declare
+     *  them at all, so such implementations should be set as options of the
+     *  vector field renderers rather than of the view.
+     */
+    void updateChannel(const std::string& name, const std::vector<float>& values);
+    void updateChannel(const std::string& name, const std::vector<glm::vec3>& values);
+    void removeChannel(const std::string& name);
+    /** Returns the names of the channels in alphabetical order. */
+    std::vector<std::string> channelNames() const;
+    /** Returns 1 for scalar channels, 3 for vector channels and 0 if there is
+     *  no channel with the given name.
+     */
+    unsigned int channelNumComponents(const std::string& name) const;
+    const std::vector<float>& channelValues(const std::string& name) const;
+    unsigned long channelUpdateId(const std::string& name) const;
+    /** Returns an id that changes whenever a channel is updated or removed. */
+    unsigned long channelsUpdateId() const;
+    /** Returns an id that changes whenever a channel is added or removed, or
+     *  the number of components of a channel changes.
+     */
+    unsigned long channelsLayoutId() const;
+
+    const Geometry& geometry() const;
     const std::vector<glm::vec3>& positions() const;
+    /** Returns the vectors. If they are in caller-owned memory, they are
+     *  copied, so prefer numVectors() and copyVectors() where possible.
+     */
     const std::vector<glm::vec3>& directions() const;
+    Geometry::index_type numVectors() const;
+    void copyVectors(Geometry::index_type first, Geometry::index_type count, glm::vec3* destination) const;
+    /** Returns a pointer to the vectors if they are stored as contiguous
+     *  glm::vec3 values and nullptr otherwise.
+     */
+    const glm::vec3* vectorsData() const;
     const std::vector<std::array<Geometry::index_type, 3>>& surfaceIndices() const;
     const std::vector<std::array<Geometry::index_type, 4>>& volumeIndices() const;
 
+    /** Returns the statistics of the current vectors.
+     *
+     *  They are calculated in parallel for blocks of vectors and cached until
+     *  the vectors are updated. If only ranges of vectors were updated since
+     *  the last call, only the blocks containing these ranges are calculated
+     *  again.
+     */
+    const Statistics& statistics() const;
+
     unsigned long geometryUpdateId() const;
+    /** Returns an id that changes whenever the positions are moved without
+     *  changing the topology of the geometry.
+     */
+    unsigned long positionsUpdateId() const;
     unsigned long vectorsUpdateId() const;
+    /** Stores the ranges of vectors (first index and count) that were changed
+     *  since the update with the given id in ranges, sorted and merged.
+     *  Returns false if all vectors may have changed since then.
+     */
+    bool changedVectorRanges(unsigned long since_update_id, std::vector<std::array<Geometry::index_type, 2>>& ranges) const;
     
 private:
+    // renderers share their buffers per view and vector field instance
+    friend class VectorFieldRenderer;
+
+    // Identifies a vector field instance. Unlike addresses, ids are never
+    // reused, and copies of a vector field get an id of their own.
+    struct InstanceId {
+        InstanceId();
+        InstanceId(const InstanceId&) : InstanceId() {}
+        InstanceId& operator=(const InstanceId&) {
+            return *this;
+        }
+
+        std::uint64_t value;
+    };
+
+    // A triple buffer for the vectors published by a producer thread. Copies
+    // of a vector field start with an empty triple buffer.
+    struct PublishedVectors {
+        PublishedVectors() {}
+        PublishedVectors(const PublishedVectors&) {}
+        PublishedVectors& operator=(const PublishedVectors&) {
+            return *this;
+        }
+
+        static const unsigned int is_new_flag = 4;
+        std::array<std::vector<glm::vec3>, 3> slots;
+        // index of the slot with the latest snapshot, with is_new_flag set
+        // if the snapshot has not been acquired yet
+        std::atomic<unsigned int> latest_slot{1};
+        unsigned int producer_slot = 2;
+        unsigned int consumer_slot = 0;
+    };
+
+    struct Channel {
+        unsigned int num_components;
+        std::vector<float> values;
+        unsigned long update_id;
+    };
+
+    void updateChannel(const std::string& name, unsigned int num_components, const float* values, std::size_t num_values);
+
+    // updates the encoded vectors, the update id and the changed ranges after
+    // all vectors may have changed
+    void vectorsHaveChanged() const;
+    void addChangedVectorRange(Geometry::index_type first, Geometry::index_type count) const;
+    // hashes a block of unencoded vectors
+    std::uint64_t hashVectorBlock(std::size_t block) const;
+    void encodeVectors(Geometry::index_type first, Geometry::index_type count, const glm::vec3* vectors) const;
+    void decodeVectors(Geometry::index_type first, Geometry::index_type count, glm::vec3* destination) const;
+    void copyUnencodedVectors(Geometry::index_type first, Geometry::index_type count, glm::vec3* destination) const;
+    void calculateStatistics(Geometry::index_type first, Geometry::index_type count, Statistics& statistics) const;
+
     Geometry m_geometry;
-    std::vector<glm::vec3> m_vectors;
+    // the vector state is mutable, as renderers acquire published vectors
+    // through const references
+    mutable std::vector<glm::vec3> m_vectors;
+    mutable const void* m_external_vectors = nullptr;
+    bool m_external_vectors_are_double = false;
+    std::size_t m_external_vectors_stride = 0;
+    Geometry::index_type m_num_external_vectors = 0;
+    mutable bool m_are_external_vectors_copied = false;
     unsigned long m_geometry_update_id = 0;
-    unsigned long m_vectors_update_id = 0;
+    unsigned long m_positions_update_id = 0;
+    mutable unsigned long m_vectors_update_id = 0;
+    // ranges changed after the update with id m_changed_vector_ranges_since
+    mutable std::vector<std::pair<unsigned long, std::array<Geometry::index_type, 2>>> m_changed_vector_ranges;
+    mutable unsigned long m_changed_vector_ranges_since = 0;
+    mutable PublishedVectors m_published_vectors;
+    // hashes of blocks of the unencoded vectors, to find those that changed
+    mutable std::vector<std::uint64_t> m_vector_block_hashes;
+    mutable Geometry::index_type m_num_hashed_vectors = 0;
+    DirectionEncoding m_direction_encoding = DirectionEncoding::FLOAT;
+    PositionEncoding m_position_encoding = PositionEncoding::FLOAT;
+    std::map<std::string, Channel> m_channels;
+    unsigned long m_channels_update_id = 0;
+    unsigned long m_channels_layout_id = 0;
+    mutable std::vector<std::int16_t> m_encoded_vectors;
+    mutable Geometry::index_type m_num_encoded_vectors = 0;
+    mutable float m_encoded_magnitude_scale = 0;
+    mutable bool m_are_encoded_vectors_decoded = false;
+    // statistics of the vectors with update id m_statistics_update_id and of
+    // the blocks they are combined from
+    mutable Statistics m_statistics;
+    mutable std::vector<Statistics> m_block_statistics;
+    mutable unsigned long m_statistics_update_id = 0;
+    InstanceId m_instance_id;
 };
 
 }
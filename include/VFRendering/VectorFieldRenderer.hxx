@@ -1,6 +1,9 @@
 #ifndef VFRENDERING_VECTORFIELD_RENDERER_HXX
 #define VFRENDERING_VECTORFIELD_RENDERER_HXX
 
+#include <map>
+#include <memory>
+#include <string>
 #include <vector>
 
 #include <glm/glm.hpp>
@@ -10,24 +13,149 @@
 #include <VFRendering/RendererBase.hxx>
 
 namespace VFRendering {
+namespace Utilities {
+class GpuBuffer;
+class StreamingBuffer;
+}
+
+/** Base class of renderers for a vector field.
+ *
+ *  Renderers of the same vector field in the same view share the buffers of
+ *  its positions, directions and channels, so that these are only uploaded
+ *  and stored once, no matter how many renderers draw them. Views may use
+ *  different OpenGL contexts, so buffers are not shared between views.
+ *
+ *  Positions and directions are written to streaming buffers, so that
+ *  vectors updated for every frame are uploaded without waiting for the GPU
+ *  to finish drawing the previous ones.
+ */
 class VectorFieldRenderer  : public RendererBase {
 public:
 
     VectorFieldRenderer(const View& view, const VectorField& vf);
 
-    virtual ~VectorFieldRenderer() {};
+    virtual ~VectorFieldRenderer();
     virtual void updateIfNecessary();
+    virtual std::size_t gpuMemoryUsage() const override;
 
 protected:
+    /** Where shaders get the values of the vector field's channels from. */
+    enum class ChannelSource {
+        // vertex attributes, which are passed on to the fragment shader
+        ATTRIBUTES,
+        // the values passed on by the vertex shader
+        VARYINGS,
+        // channels are not available, so all values are zero
+        NONE
+    };
+
+    const Geometry& geometry() const;
     const std::vector<glm::vec3>& positions() const;
     const std::vector<glm::vec3>& directions() const;
     const std::vector<std::array<Geometry::index_type, 3>>& surfaceIndices() const;
     const std::vector<std::array<Geometry::index_type, 4>>& volumeIndices() const;
+    /** Binds the shared buffer of the geometry's positions to the given
+     *  vertex attribute of the bound vertex array object and sets its format
+     *  to match their encoding. If the positions changed, they are uploaded
+     *  first, without materializing the positions of implicit geometries.
+     */
+    void bindPositionData(unsigned int attribute_index) const;
+    /** Streams positions derived from the vector field, e.g. the vertices of
+     *  an isosurface, to the given buffer and binds it to the given vertex
+     *  attribute of the bound vertex array object, with a format matching
+     *  the position encoding.
+     */
+    void streamPositionData(Utilities::StreamingBuffer& buffer, unsigned int attribute_index, const std::vector<glm::vec3>& positions) const;
+    /** Streams vectors derived from the vector field to the given buffer,
+     *  as half floats for the HALF_FLOAT direction encoding, and binds it to
+     *  the given vertex attribute of the bound vertex array object.
+     */
+    void streamVectorData(Utilities::StreamingBuffer& buffer, unsigned int attribute_index, const std::vector<glm::vec3>& vectors) const;
+    /** Fills the given element array buffer with the geometry's surface
+     *  triangles and returns their number.
+     */
+    Geometry::index_type bufferSurfaceIndexData(Utilities::GpuBuffer& buffer) const;
+    /** Binds the shared buffer of the vector field's directions to the given
+     *  vertex attribute of the bound vertex array object and sets its format
+     *  to match their encoding. If the directions changed, they are uploaded
+     *  first, directly from caller-owned memory if possible, and if only some
+     *  ranges of directions changed, only these are uploaded.
+     */
+    void bindDirectionData(unsigned int attribute_index) const;
+    Geometry::index_type numDirections() const;
+    /** Returns the implementation of the GLSL function
+     *  vec3 decodeDirection(vec3 direction), which vertex shaders use to
+     *  decode the direction attribute.
+     */
+    std::string directionDecodingImplementation() const;
+    /** Returns the implementation of the GLSL function
+     *  vec3 decodePosition(vec3 position, int index), which vertex shaders
+     *  use to decode the position attribute of the vertex or instance with
+     *  the given index.
+     */
+    std::string positionDecodingImplementation() const;
+    /** Looks up the locations of the uniforms used by decodeDirection and
+     *  decodePosition after the given program was linked.
+     */
+    void resolveDecodingUniforms(unsigned int program);
+    /** Sets the uniforms and binds the textures used by decodeDirection and
+     *  decodePosition in the program in use, which was passed to
+     *  resolveDecodingUniforms.
+     */
+    void setDecodingUniforms() const;
+    /** Returns GLSL declarations of a variable for each channel of the
+     *  vector field and the implementation of void loadChannels(), which
+     *  shaders call at the beginning of main() to set these variables.
+     */
+    std::string channelsImplementation(ChannelSource source) const;
+    /** Returns the names of the channel attributes, which follow the other
+     *  attributes of a shader program.
+     */
+    std::vector<std::string> channelAttributes() const;
+    /** Uploads the channels that changed to shared buffers of their own,
+     *  with one value per direction, and sets up the vertex attributes of all
+     *  channels, starting at first_attribute_index, in the bound vertex array
+     *  object.
+     */
+    void bindChannelData(unsigned int first_attribute_index, unsigned int divisor) const;
+    /** Recreates the shader programs, e.g. when the direction or position
+     *  encoding of the vector field has changed.
+     */
+    virtual void updateShaderProgram() = 0;
+    /** Uploads the positions after they moved without changing the topology
+     *  of the geometry, e.g. by VectorField::updatePositions. Renderers
+     *  override this to keep their index buffers, by default everything is
+     *  updated.
+     */
+    virtual void updatePositions();
+    /** Uploads the channels of the vector field after they changed.
+     *  Renderers using channels bind their vertex array object and call
+     *  bindChannelData.
+     */
+    virtual void updateChannels() {}
 
 private:
+    struct SharedBuffers;
+
+    virtual void sharedGpuMemoryUsage(std::map<const void*, std::size_t>& shared_memory_usage) const override;
+    bool hasHalfFloatPositions() const;
+
     const VectorField& m_vf;
+    std::shared_ptr<SharedBuffers> m_shared_buffers;
     unsigned long m_geometry_update_id = 0;
+    unsigned long m_positions_update_id = 0;
     unsigned long m_vectors_update_id = 0;
+    mutable VectorField::DirectionEncoding m_direction_encoding = VectorField::DirectionEncoding::FLOAT;
+    mutable VectorField::PositionEncoding m_position_encoding = VectorField::PositionEncoding::FLOAT;
+    int m_direction_magnitude_scale_location = -1;
+    int m_position_brick_centers_location = -1;
+    // brick centers of derived positions, the shared ones are used otherwise
+    mutable std::unique_ptr<Utilities::GpuBuffer> m_position_brick_centers_buffer;
+    mutable unsigned int m_position_brick_centers_texture = 0;
+    unsigned long m_channels_update_id = 0;
+    mutable unsigned long m_channels_layout_id = 0;
+    mutable unsigned int m_num_channel_attributes = 0;
+    mutable Geometry::index_type m_num_channel_points = 0;
 };
 
 }
@@ -17,22 +17,29 @@ public:
     virtual ~VectorSphereRenderer();
     virtual void draw(float aspect_ratio) override;
     virtual void optionsHaveChanged(const std::vector<int>& changed_options) override;
+    virtual std::size_t gpuMemoryUsage() const override;
 
 protected:
     virtual void update(bool keep_geometry) override;
+    virtual void updatePositions() override;
 
 private:
     void updateShaderProgram();
+    void updateChannels() override;
     void initialize();
     
     bool m_is_initialized = false;
     unsigned int m_sphere_points_program = 0;
+    int m_point_size_range_location = -1;
+    int m_points_aspect_ratio_location = -1;
+    int m_points_inner_sphere_radius_location = -1;
+    int m_use_fake_perspective_location = -1;
     unsigned int m_sphere_points_vao = 0;
-    unsigned int m_sphere_points_positions_vbo = 0;
-    unsigned int m_sphere_points_directions_vbo = 0;
     unsigned int m_sphere_background_program = 0;
+    int m_background_aspect_ratio_location = -1;
+    int m_background_inner_sphere_radius_location = -1;
     unsigned int m_sphere_background_vao = 0;
-    unsigned int m_sphere_background_vbo = 0;
+    std::unique_ptr<Utilities::GpuBuffer> m_sphere_background_vbo;
     unsigned int m_num_instances = 0;
 };
 
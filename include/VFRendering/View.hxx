@@ -2,7 +2,9 @@
 #define VFRENDERING_VIEW_HXX
 
 #include <array>
+#include <cstdint>
 #include <memory>
+#include <vector>
 
 #include <glm/glm.hpp>
 
@@ -14,6 +16,11 @@
 namespace VFRendering {
 class RendererBase;
 
+namespace Utilities {
+class GpuBuffer;
+struct ProgramCache;
+}
+
 enum class CameraMovementModes {
     TRANSLATE,
     ROTATE_BOUNDED,
@@ -31,7 +38,8 @@ public:
         CAMERA_POSITION,
         CENTER_POSITION,
         UP_VECTOR,
-        CLEAR
+        CLEAR,
+        COLORMAP_Z_RANGE
     };
 
     View();
@@ -55,17 +63,40 @@ public:
     void renderers(const std::vector<std::pair<std::shared_ptr<RendererBase>, std::array<float, 4>>>& renderers, bool update_renderer_options=true);
     
 private:
+    // renderers bind the camera uniform block of the viewport being drawn
+    friend class RendererBase;
+    // vector field renderers share their buffers per view id
+    friend class VectorFieldRenderer;
+    friend unsigned int Utilities::createProgram(const View& view, const std::string& vertex_shader_source, const std::string& fragment_shader_source, const std::vector<std::string>& attributes);
+    friend void Utilities::releaseProgram(const View& view, unsigned int program);
+
     void setCamera(glm::vec3 camera_position, glm::vec3 center_position, glm::vec3 up_vector);
     void optionsHaveChanged(const std::vector<int>& changed_options);
+    void updateCameraBlocks();
     void initialize();
 
     bool m_is_initialized = false;
+    // unlike the address of a view, its id is never reused
+    const std::uint64_t m_id;
+    // declared before the renderers, so that it is destroyed after them
+    std::unique_ptr<Utilities::ProgramCache> m_program_cache;
     std::vector<std::pair<std::shared_ptr<RendererBase>, std::array<float, 4>>> m_renderers;
     Utilities::FPSCounter m_fps_counter;
     glm::vec2 m_framebuffer_size;
     bool m_is_centered = false;
 
     Options m_options;
+
+    // camera uniform blocks, one per distinct viewport aspect ratio, which
+    // are only uploaded when they changed
+    std::unique_ptr<Utilities::GpuBuffer> m_camera_buffer;
+    std::vector<char> m_camera_blocks;
+    std::size_t m_camera_block_stride = 0;
+    // index of the camera block of each renderer's viewport
+    std::vector<std::size_t> m_camera_block_indices;
+    bool m_is_drawing = false;
+    std::size_t m_camera_block_index = 0;
+    float m_viewport_aspect_ratio = 0;
 };
 
 template<int index>
@@ -132,6 +163,14 @@ template<>
 struct Options::Option<View::Option::CLEAR> {
     bool default_value = true;
 };
+
+/** Option to set the range of z components spanned by colormaps from
+ *  Utilities::getRangedColormapImplementation.
+ */
+template<>
+struct Options::Option<View::Option::COLORMAP_Z_RANGE> {
+    glm::vec2 default_value = {-1, 1};
+};
 }
 }
 
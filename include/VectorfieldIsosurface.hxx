@@ -16,6 +16,7 @@ public:
     std::vector<glm::vec3> normals;
     std::vector<int> triangle_indices;
     static VectorfieldIsosurface calculate(const std::vector<glm::vec3>&, const std::vector<glm::vec3>& directions, const std::vector<float>& values, float isovalue, const std::vector<std::array<Geometry::index_type, 4>>& tetrahedra);
+    static VectorfieldIsosurface calculate(const Geometry& geometry, const std::vector<glm::vec3>& directions, const std::vector<float>& values, float isovalue);
 };
 }
 
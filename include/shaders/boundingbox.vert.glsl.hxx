@@ -3,10 +3,8 @@
 
 #include "shader_header.hxx"
 
-static const std::string BOUNDINGBOX_VERT_GLSL = VERT_SHADER_HEADER + R"LITERAL(
+static const std::string BOUNDINGBOX_VERT_GLSL = VERT_SHADER_HEADER + CAMERA_UNIFORMS + R"LITERAL(
 
-uniform mat4 uProjectionMatrix;
-uniform mat4 uModelviewMatrix;
 in vec3 ivPosition;
 in float ivDashingValue;
 out float vfDashingValue;
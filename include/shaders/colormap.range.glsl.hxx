@@ -0,0 +1,21 @@
+#ifndef COLORMAP_RANGE_GLSL_HXX
+#define COLORMAP_RANGE_GLSL_HXX
+
+static const std::string COLORMAP_RANGE_GLSL = R"LITERAL(
+uniform vec2 uColormapZRange;
+vec3 colormapOfDirection(vec3 direction);
+vec3 colormap(vec3 direction) {
+    // a single value is mapped to the center of the colormap
+    float z = 0.0;
+    if (uColormapZRange.y > uColormapZRange.x) {
+        z = clamp((direction.z - uColormapZRange.x) / (uColormapZRange.y - uColormapZRange.x), 0.0, 1.0) * 2.0 - 1.0;
+    }
+    vec2 xy = direction.xy;
+    if (length(xy) > 0.0) {
+        xy = normalize(xy);
+    }
+    return colormapOfDirection(vec3(xy * sqrt(1.0 - z * z), z));
+}
+)LITERAL";
+
+#endif
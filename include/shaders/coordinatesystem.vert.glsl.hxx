@@ -3,10 +3,8 @@
 
 #include "shader_header.hxx"
 
-static const std::string COORDINATESYSTEM_VERT_GLSL = VERT_SHADER_HEADER + R"LITERAL(
+static const std::string COORDINATESYSTEM_VERT_GLSL = VERT_SHADER_HEADER + CAMERA_UNIFORMS + R"LITERAL(
 
-uniform mat4 uProjectionMatrix;
-uniform mat4 uModelviewMatrix;
 uniform vec3 uOrigin;
 in vec3 ivPosition;
 in vec3 ivNormal;
@@ -0,0 +1,39 @@
+#ifndef DIRECTION_DECODING_GLSL_HXX
+#define DIRECTION_DECODING_GLSL_HXX
+
+static const std::string DIRECTION_DECODING_FLOAT_GLSL = R"LITERAL(
+vec3 decodeDirection(vec3 direction) {
+  return direction;
+}
+)LITERAL";
+
+static const std::string DIRECTION_DECODING_OCTAHEDRAL_GLSL = R"LITERAL(
+vec3 decodeDirection(vec3 direction) {
+  // the code (0, 0) is reserved for zero vectors; some implementations map
+  // the normalized integer 0 to a small positive value instead of zero
+  if (all(greaterThanEqual(direction.xy, vec2(0.0))) && all(lessThan(direction.xy, vec2(0.75/32767.0)))) {
+    return vec3(0.0);
+  }
+  vec3 n = vec3(direction.xy, 1.0 - abs(direction.x) - abs(direction.y));
+  float t = max(-n.z, 0.0);
+  n.x += (n.x >= 0.0) ? -t : t;
+  n.y += (n.y >= 0.0) ? -t : t;
+  return normalize(n);
+}
+)LITERAL";
+
+static const std::string DIRECTION_DECODING_OCTAHEDRAL_WITH_MAGNITUDE_GLSL = R"LITERAL(
+uniform float uDirectionMagnitudeScale;
+
+vec3 decodeDirection(vec3 direction) {
+  vec3 n = vec3(direction.xy, 1.0 - abs(direction.x) - abs(direction.y));
+  float t = max(-n.z, 0.0);
+  n.x += (n.x >= 0.0) ? -t : t;
+  n.y += (n.y >= 0.0) ? -t : t;
+  // some implementations never map a normalized integer to exactly zero
+  float magnitude = (direction.z < 0.5/32767.0) ? 0.0 : direction.z;
+  return normalize(n) * magnitude * uDirectionMagnitudeScale;
+}
+)LITERAL";
+
+#endif
@@ -3,10 +3,8 @@
 
 #include "shader_header.hxx"
 
-static const std::string DOT_VERT_GLSL = VERT_SHADER_HEADER + R"LITERAL(
+static const std::string DOT_VERT_GLSL = VERT_SHADER_HEADER + CAMERA_UNIFORMS + R"LITERAL(
 
-uniform mat4 uProjectionMatrix;
-uniform mat4 uModelviewMatrix;
 uniform float uDotRadius;
 
 in vec3 ivDotCoordinates;
@@ -15,14 +13,23 @@ out vec3 vfColor;
 
 vec3 colormap(vec3 direction);
 
+vec3 decodeDirection(vec3 direction);
+
+vec3 decodePosition(vec3 position, int index);
+
 bool is_visible(vec3 position, vec3 direction);
 
+void loadChannels();
+
 void main(void) {
-  float direction_length = length( ivDotDirection );
+  loadChannels();
+  vec3 direction = decodeDirection( ivDotDirection );
+  vec3 position = decodePosition( ivDotCoordinates, VERTEX_INDEX );
+  float direction_length = length( direction );
   
-  if ( is_visible( ivDotCoordinates, ivDotDirection ) && direction_length > 0.0) {
-    vfColor = colormap( normalize( ivDotDirection ) );
-    vec3 vfPosition = ( uModelviewMatrix * vec4( ivDotCoordinates, 1.0 ) ).xyz;
+  if ( is_visible( position, direction ) && direction_length > 0.0) {
+    vfColor = colormap( normalize( direction ) );
+    vec3 vfPosition = ( uModelviewMatrix * vec4( position, 1.0 ) ).xyz;
     gl_Position = uProjectionMatrix * vec4( vfPosition, 1.0 );
   } else {
     gl_Position = vec4(2.0, 2.0, 2.0, 0.0);
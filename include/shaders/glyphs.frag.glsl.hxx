@@ -3,8 +3,7 @@
 
 #include "shader_header.hxx"
 
-static const std::string GLYPHS_FRAG_GLSL = FRAG_SHADER_HEADER + R"LITERAL(
-uniform vec3 uLightPosition;
+static const std::string GLYPHS_FRAG_GLSL = FRAG_SHADER_HEADER + CAMERA_UNIFORMS + R"LITERAL(
 in vec3 vfPosition;
 in vec3 vfNormal;
 in vec3 vfColor;
@@ -3,9 +3,7 @@
 
 #include "shader_header.hxx"
 
-static const std::string GLYPHS_ROTATED_VERT_GLSL = VERT_SHADER_HEADER + R"LITERAL(
-uniform mat4 uProjectionMatrix;
-uniform mat4 uModelviewMatrix;
+static const std::string GLYPHS_ROTATED_VERT_GLSL = VERT_SHADER_HEADER + CAMERA_UNIFORMS + R"LITERAL(
 uniform vec2 uZRange;
 in vec3 ivPosition;
 in vec3 ivNormal;
@@ -38,15 +36,24 @@ mat3 matrixFromDirection(vec3 direction) {
 
 vec3 colormap(vec3 direction);
 
+vec3 decodeDirection(vec3 direction);
+
+vec3 decodePosition(vec3 position, int index);
+
 bool is_visible(vec3 position, vec3 direction);
 
+void loadChannels();
+
 void main(void) {
-  float direction_length = length(ivInstanceDirection);
-  if (is_visible(ivInstanceOffset, ivInstanceDirection) && direction_length > 0.0) {
-    vfColor = colormap(normalize(ivInstanceDirection));
-    mat3 instanceMatrix = direction_length * matrixFromDirection(ivInstanceDirection/direction_length);
+  loadChannels();
+  vec3 direction = decodeDirection(ivInstanceDirection);
+  vec3 offset = decodePosition(ivInstanceOffset, INSTANCE_INDEX);
+  float direction_length = length(direction);
+  if (is_visible(offset, direction) && direction_length > 0.0) {
+    vfColor = colormap(normalize(direction));
+    mat3 instanceMatrix = direction_length * matrixFromDirection(direction/direction_length);
     vfNormal = (uModelviewMatrix * vec4(instanceMatrix*ivNormal, 0.0)).xyz;
-    vfPosition = (uModelviewMatrix * vec4(instanceMatrix*ivPosition+ivInstanceOffset, 1.0)).xyz;
+    vfPosition = (uModelviewMatrix * vec4(instanceMatrix*ivPosition+offset, 1.0)).xyz;
     gl_Position = uProjectionMatrix * vec4(vfPosition, 1.0);
   } else {
     gl_Position = vec4(2.0, 2.0, 2.0, 0.0);
@@ -54,9 +61,7 @@ void main(void) {
 }
 )LITERAL";
 
-static const std::string GLYPHS_UNROTATED_VERT_GLSL = VERT_SHADER_HEADER + R"LITERAL(
-uniform mat4 uProjectionMatrix;
-uniform mat4 uModelviewMatrix;
+static const std::string GLYPHS_UNROTATED_VERT_GLSL = VERT_SHADER_HEADER + CAMERA_UNIFORMS + R"LITERAL(
 uniform vec2 uZRange;
 in vec3 ivPosition;
 in vec3 ivNormal;
@@ -68,15 +73,24 @@ out vec3 vfColor;
 
 vec3 colormap(vec3 direction);
 
+vec3 decodeDirection(vec3 direction);
+
+vec3 decodePosition(vec3 position, int index);
+
 bool is_visible(vec3 position, vec3 direction);
 
+void loadChannels();
+
 void main(void) {
-  float direction_length = length(ivInstanceDirection);
-  if (is_visible(ivInstanceOffset, ivInstanceDirection) && direction_length > 0.0) {
-    vfColor = colormap(normalize(ivInstanceDirection));
+  loadChannels();
+  vec3 direction = decodeDirection(ivInstanceDirection);
+  vec3 offset = decodePosition(ivInstanceOffset, INSTANCE_INDEX);
+  float direction_length = length(direction);
+  if (is_visible(offset, direction) && direction_length > 0.0) {
+    vfColor = colormap(normalize(direction));
     mat3 instanceMatrix = mat3(direction_length);
     vfNormal = (uModelviewMatrix * vec4(instanceMatrix*ivNormal, 0.0)).xyz;
-    vfPosition = (uModelviewMatrix * vec4(instanceMatrix*ivPosition+ivInstanceOffset, 1.0)).xyz;
+    vfPosition = (uModelviewMatrix * vec4(instanceMatrix*ivPosition+offset, 1.0)).xyz;
     gl_Position = uProjectionMatrix * vec4(vfPosition, 1.0);
   } else {
     gl_Position = vec4(2.0, 2.0, 2.0, 0.0);
@@ -3,7 +3,7 @@
 
 #include "shader_header.hxx"
 
-static const std::string ISOSURFACE_FRAG_GLSL = FRAG_SHADER_HEADER + R"LITERAL(
+static const std::string ISOSURFACE_FRAG_GLSL = FRAG_SHADER_HEADER + CAMERA_UNIFORMS + R"LITERAL(
 
 in vec3 vfPosition;
 in vec3 vfDirection;
@@ -13,7 +13,10 @@ vec3 colormap(vec3 direction);
 bool is_visible(vec3 position, vec3 direction);
 float lighting(vec3 position, vec3 normal);
 
+void loadChannels();
+
 void main(void) {
+  loadChannels();
   if (is_visible(vfPosition, vfDirection)) {
     vec3 color = colormap(normalize(vfDirection));
     fo_FragColor = vec4(color * lighting(vfPosition, normalize(vfNormal)), 1.0);
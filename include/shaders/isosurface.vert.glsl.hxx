@@ -3,10 +3,8 @@
 
 #include "shader_header.hxx"
 
-static const std::string ISOSURFACE_VERT_GLSL = VERT_SHADER_HEADER + R"LITERAL(
+static const std::string ISOSURFACE_VERT_GLSL = VERT_SHADER_HEADER + CAMERA_UNIFORMS + R"LITERAL(
 
-uniform mat4 uProjectionMatrix;
-uniform mat4 uModelviewMatrix;
 uniform float uFlipNormals;
 in vec3 ivPosition;
 in vec3 ivDirection;
@@ -15,13 +13,17 @@ out vec3 vfPosition;
 out vec3 vfDirection;
 out vec3 vfNormal;
 
+vec3 decodePosition(vec3 position, int index);
+
+void loadChannels();
 
 void main(void) {
-    vfPosition = ivPosition;
+    loadChannels();
+    vfPosition = decodePosition(ivPosition, VERTEX_INDEX);
     vfDirection = normalize(ivDirection);
     vfNormal = normalize((uModelviewMatrix * vec4(ivNormal, 0.0)).xyz);
     vfNormal *= uFlipNormals;
-    gl_Position = uProjectionMatrix * (uModelviewMatrix * vec4(ivPosition, 1.0));
+    gl_Position = uProjectionMatrix * (uModelviewMatrix * vec4(vfPosition, 1.0));
 }
 )LITERAL";
 
@@ -0,0 +1,19 @@
+#ifndef POSITION_DECODING_GLSL_HXX
+#define POSITION_DECODING_GLSL_HXX
+
+static const std::string POSITION_DECODING_FLOAT_GLSL = R"LITERAL(
+vec3 decodePosition(vec3 position, int index) {
+  return position;
+}
+)LITERAL";
+
+// requires POSITION_BRICK_SIZE to be defined
+static const std::string POSITION_DECODING_HALF_FLOAT_GLSL = R"LITERAL(
+uniform samplerBuffer uPositionBrickCenters;
+
+vec3 decodePosition(vec3 position, int index) {
+  return position + texelFetch(uPositionBrickCenters, index / POSITION_BRICK_SIZE).xyz;
+}
+)LITERAL";
+
+#endif
@@ -1,11 +1,13 @@
 #ifndef SHADER_HEADER
 
 #ifdef __EMSCRIPTEN__
-#define VERT_SHADER_HEADER std::string("#version 100\nprecision highp float;\n#define in attribute\n#define out varying\n")
+#define VERT_SHADER_HEADER std::string("#version 100\nprecision highp float;\n#define in attribute\n#define out varying\n#define VERTEX_INDEX 0\n#define INSTANCE_INDEX 0\n")
 #define FRAG_SHADER_HEADER std::string("#version 100\nprecision highp float;\n#define in varying\n#define fo_FragColor gl_FragColor")
+#define CAMERA_UNIFORMS std::string("\nuniform mat4 uProjectionMatrix;\nuniform mat4 uModelviewMatrix;\nuniform vec3 uLightPosition;\n")
 #else
-#define VERT_SHADER_HEADER std::string("#version 330\n")
+#define VERT_SHADER_HEADER std::string("#version 330\n#define VERTEX_INDEX gl_VertexID\n#define INSTANCE_INDEX gl_InstanceID\n")
 #define FRAG_SHADER_HEADER std::string("#version 330\nout vec4 fo_FragColor;\n")
+#define CAMERA_UNIFORMS std::string("\nlayout(std140) uniform CameraBlock {\n  mat4 uProjectionMatrix;\n  mat4 uModelviewMatrix;\n  vec3 uLightPosition;\n};\n")
 #endif
 
 #endif
\ No newline at end of file
@@ -12,7 +12,10 @@ vec3 colormap(vec3 direction);
 
 bool is_visible(vec3 position, vec3 direction);
 
+void loadChannels();
+
 void main(void) {
+  loadChannels();
   if (is_visible(vfPosition, vfDirection)) {
     vec3 color = colormap(normalize(vfDirection));
     fo_FragColor = vec4(color, 1.0);
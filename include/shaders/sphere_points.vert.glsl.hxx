@@ -3,10 +3,8 @@
 
 #include "shader_header.hxx"
 
-static const std::string SPHERE_POINTS_VERT_GLSL = VERT_SHADER_HEADER + R"LITERAL(
+static const std::string SPHERE_POINTS_VERT_GLSL = VERT_SHADER_HEADER + CAMERA_UNIFORMS + R"LITERAL(
 
-uniform mat4 uProjectionMatrix;
-uniform mat4 uModelviewMatrix;
 uniform vec2 uPointSizeRange;
 uniform float uAspectRatio;
 uniform float uInnerSphereRadius;
@@ -16,9 +14,16 @@ in vec3 ivDirection;
 out vec3 vfDirection;
 out vec3 vfPosition;
 
+vec3 decodeDirection(vec3 direction);
+
+vec3 decodePosition(vec3 position, int index);
+
+void loadChannels();
+
 void main(void) {
-  vfPosition = ivPosition;
-  vfDirection = normalize(ivDirection);
+  loadChannels();
+  vfPosition = decodePosition(ivPosition, VERTEX_INDEX);
+  vfDirection = normalize(decodeDirection(ivDirection));
   gl_Position = uProjectionMatrix * uModelviewMatrix * vec4(vfDirection*0.99, 1.0);
   vec2 clipPosition;
   if (uAspectRatio > 1.0) {
@@ -3,20 +3,24 @@
 
 #include "shader_header.hxx"
 
-static const std::string SURFACE_VERT_GLSL = VERT_SHADER_HEADER + R"LITERAL(
+static const std::string SURFACE_VERT_GLSL = VERT_SHADER_HEADER + CAMERA_UNIFORMS + R"LITERAL(
 
-uniform mat4 uProjectionMatrix;
-uniform mat4 uModelviewMatrix;
 in vec3 ivPosition;
 in vec3 ivDirection;
 out vec3 vfPosition;
 out vec3 vfDirection;
 
+vec3 decodeDirection(vec3 direction);
+
+vec3 decodePosition(vec3 position, int index);
+
+void loadChannels();
 
 void main(void) {
-    vfPosition = ivPosition;
-  vfDirection = normalize(ivDirection);
-  gl_Position = uProjectionMatrix * (uModelviewMatrix * vec4(ivPosition, 1.0));
+  loadChannels();
+  vfPosition = decodePosition(ivPosition, VERTEX_INDEX);
+  vfDirection = normalize(decodeDirection(ivDirection));
+  gl_Position = uProjectionMatrix * (uModelviewMatrix * vec4(vfPosition, 1.0));
 }
 )LITERAL";
 
@@ -18,6 +18,7 @@
 #include <VFRendering/IsosurfaceRenderer.hxx>
 #include <VFRendering/VectorSphereRenderer.hxx>
 #include <VFRendering/Options.hxx>
+#include <VFRendering/SnapshotSequence.hxx>
 
 #include <memory>
 
@@ -43,6 +44,16 @@ PYBIND11_MODULE(pyVFRendering, m)
     // Module functions
     m.def("getColormapImplementation", &Utilities::getColormapImplementation,
         "Get a Colormap implementation from the Colormap enum");
+    m.def("getRangedColormapImplementation", &Utilities::getRangedColormapImplementation,
+        "Get a Colormap implementation from the Colormap enum, spanning the range of z components set with setColormapZRange");
+    m.def("setCacheDirectory", &Utilities::setCacheDirectory,
+        "Set the directory for persistent caches, an empty string disables caching");
+    m.def("getCacheDirectory", &Utilities::getCacheDirectory,
+        "Get the directory for persistent caches");
+    m.def("setCacheSizeLimit", &Utilities::setCacheSizeLimit,
+        "Set the maximum total size of the cache files in bytes, removing the least recently used ones when it is exceeded");
+    m.def("getCacheSizeLimit", &Utilities::getCacheSizeLimit,
+        "Get the maximum total size of the cache files in bytes");
 
 
     // Geometry class
@@ -56,6 +67,8 @@ PYBIND11_MODULE(pyVFRendering, m)
             "Create a geometry corresponding to a cartesian grid")
         .def("rectilinearGeometry", &Geometry::rectilinearGeometry,
             "Create a geometry corresponding to a rectilinear grid")
+        .def("bravaisLatticeGeometry", &Geometry::bravaisLatticeGeometry,
+            "Create a geometry corresponding to a Bravais lattice with a basis of atoms")
         .def("positions", &Geometry::positions,
             "Retrieve the positions given by the geometry")
         .def("min", &Geometry::min,
@@ -67,7 +80,13 @@ PYBIND11_MODULE(pyVFRendering, m)
         .def("volumeIndices", &Geometry::volumeIndices,
             "Retrieve the tetrahedra indices of a 3D volume")
         .def("is2d", &Geometry::is2d,
-            "Returns true if the geometry is planar");
+            "Returns true if the geometry is planar")
+        .def("withPositions", static_cast<Geometry (Geometry::*)(const std::vector<glm::vec3>&) const>(&Geometry::withPositions),
+            "Returns a geometry with the given positions and the topology of this geometry")
+        .def("hasSameTopology", &Geometry::hasSameTopology,
+            "Returns true if both geometries share their surface triangles and volume tetrahedra")
+        .def("contentHash", &Geometry::contentHash,
+            "Retrieve a hash of the data this geometry was created from");
 
     // VectorField
     py::class_<VectorField>(m, "VectorField",
@@ -77,8 +96,22 @@ PYBIND11_MODULE(pyVFRendering, m)
             "Update the geometry and directions of this VectorField")
         .def("updateGeometry", &VectorField::updateGeometry,
             "Update the geometry")
-        .def("updateVectors", &VectorField::updateVectors,
+        .def("updatePositions", static_cast<void (VectorField::*)(const std::vector<glm::vec3>&)>(&VectorField::updatePositions),
+            "Move the positions while keeping the topology of the geometry")
+        .def("updateVectors", static_cast<void (VectorField::*)(const std::vector<glm::vec3>&)>(&VectorField::updateVectors),
             "Update the direction vectors")
+        .def("setDirectionEncoding", &VectorField::setDirectionEncoding,
+            "Set how the directions are stored and uploaded to the GPU")
+        .def("setPositionEncoding", &VectorField::setPositionEncoding,
+            "Set how the positions are uploaded to the GPU")
+        .def("updateChannel", static_cast<void (VectorField::*)(const std::string&, const std::vector<float>&)>(&VectorField::updateChannel),
+            "Set a named channel of per-point scalar values")
+        .def("updateChannel", static_cast<void (VectorField::*)(const std::string&, const std::vector<glm::vec3>&)>(&VectorField::updateChannel),
+            "Set a named channel of per-point vectors")
+        .def("removeChannel", &VectorField::removeChannel,
+            "Remove a named channel")
+        .def("getChannelNames", &VectorField::channelNames,
+            "Get the names of the channels")
         .def("getPositions", &VectorField::positions,
             "Get the positions stored in the VectorField")
         .def("getDirections", &VectorField::directions,
@@ -86,7 +119,55 @@ PYBIND11_MODULE(pyVFRendering, m)
         .def("getSurfaceIndices", &VectorField::surfaceIndices,
             "Get the surface indices stored in the VectorField")
         .def("getVolumeIndices", &VectorField::volumeIndices,
-            "Get the volume indices stored in the VectorField");
+            "Get the volume indices stored in the VectorField")
+        .def("getStatistics", &VectorField::statistics, py::return_value_policy::copy,
+            "Get statistics of the directions, e.g. their sum and range");
+
+    py::class_<VectorField::Statistics>(m, "VectorFieldStatistics",
+        "Statistics of the directions of a VectorField.")
+        .def_readonly("num_vectors", &VectorField::Statistics::num_vectors)
+        .def_readonly("sum", &VectorField::Statistics::sum)
+        .def_readonly("min", &VectorField::Statistics::min)
+        .def_readonly("max", &VectorField::Statistics::max)
+        .def_readonly("min_length", &VectorField::Statistics::min_length)
+        .def_readonly("max_length", &VectorField::Statistics::max_length)
+        .def_readonly("z_histogram", &VectorField::Statistics::z_histogram)
+        .def_readonly("azimuth_histogram", &VectorField::Statistics::azimuth_histogram)
+        .def("mean", &VectorField::Statistics::mean);
+
+    // SnapshotSequence
+    py::class_<SnapshotSequence>(m, "SnapshotSequence",
+        "This class plays back a memory-mapped sequence of vector snapshots in a VectorField.")
+        .def(py::init<VectorField&, const std::string&, std::size_t>(), py::keep_alive<1, 2>(),
+            py::arg("vf"), py::arg("path"), py::arg("num_prefetched_frames") = 8)
+        .def("isValid", &SnapshotSequence::isValid)
+        .def("numFrames", &SnapshotSequence::numFrames)
+        .def("currentFrame", &SnapshotSequence::currentFrame)
+        .def("seek", &SnapshotSequence::seek,
+            "Show the given frame")
+        .def("play", &SnapshotSequence::play,
+            "Start playing at the given number of frames per second",
+            py::arg("frames_per_second"), py::arg("is_looping") = true)
+        .def("pause", &SnapshotSequence::pause)
+        .def("isPlaying", &SnapshotSequence::isPlaying)
+        .def("update", &SnapshotSequence::update,
+            "Show the frame that is due, call this before drawing");
+
+    py::class_<SnapshotSequenceWriter>(m, "SnapshotSequenceWriter",
+        "This class writes sequences of vector snapshots for SnapshotSequence.")
+        .def(py::init<const std::string&, Geometry::index_type, bool>(),
+            py::arg("path"), py::arg("num_vectors"), py::arg("is_double_precision") = false)
+        .def("isValid", &SnapshotSequenceWriter::isValid)
+        .def("appendFrame", static_cast<bool (SnapshotSequenceWriter::*)(const std::vector<glm::vec3>&)>(&SnapshotSequenceWriter::appendFrame),
+            "Append a frame of vectors");
+
+    py::class_<CompressedSnapshotSequenceWriter>(m, "CompressedSnapshotSequenceWriter",
+        "This class writes quantized and delta-compressed sequences of vector snapshots for SnapshotSequence.")
+        .def(py::init<const std::string&, Geometry::index_type, float, std::size_t>(),
+            py::arg("path"), py::arg("num_vectors"), py::arg("quantization_step") = 1e-4f, py::arg("keyframe_interval") = 64)
+        .def("isValid", &CompressedSnapshotSequenceWriter::isValid)
+        .def("appendFrame", static_cast<bool (CompressedSnapshotSequenceWriter::*)(const std::vector<glm::vec3>&)>(&CompressedSnapshotSequenceWriter::appendFrame),
+            "Append a frame of vectors");
 
     // View
     py::class_<View>(m, "View",
@@ -128,6 +209,8 @@ PYBIND11_MODULE(pyVFRendering, m)
             "Set the background color of the View")
         .def("setColormapImplementation",  &View::setOption<View::Option::COLORMAP_IMPLEMENTATION>,
             "Set the implementation of the colormap")
+        .def("setColormapZRange",          &View::setOption<View::Option::COLORMAP_Z_RANGE>,
+            "Set the range of z components spanned by a ranged colormap")
         // Filters set
         .def("setIsVisibleImplementation", &View::setOption<View::Option::IS_VISIBLE_IMPLEMENTATION>,
             "Set a filter for the visibility of objects");
@@ -168,6 +251,8 @@ PYBIND11_MODULE(pyVFRendering, m)
             "Set the background color of the View")
         .def("setColormapImplementation",  &Options::set<View::Option::COLORMAP_IMPLEMENTATION>,
             "Set the implementation of the colormap")
+        .def("setColormapZRange",          &Options::set<View::Option::COLORMAP_Z_RANGE>,
+            "Set the range of z components spanned by a ranged colormap")
         // Filters set
         .def("setIsVisibleImplementation", &Options::set<View::Option::IS_VISIBLE_IMPLEMENTATION>,
             "Set a filter for the visibility of objects");
@@ -190,6 +275,22 @@ PYBIND11_MODULE(pyVFRendering, m)
         .value("translate",      CameraMovementModes::TRANSLATE)
         .export_values();
 
+
+    // Storage formats of the directions of a VectorField
+    py::enum_<VectorField::DirectionEncoding>(m, "DirectionEncoding")
+        .value("float",                     VectorField::DirectionEncoding::FLOAT)
+        .value("octahedral",                VectorField::DirectionEncoding::OCTAHEDRAL)
+        .value("octahedral_with_magnitude", VectorField::DirectionEncoding::OCTAHEDRAL_WITH_MAGNITUDE)
+        .value("half_float",                VectorField::DirectionEncoding::HALF_FLOAT)
+        .export_values();
+
+
+    // Upload formats of the positions of a VectorField, not exported to the
+    // module as their names are already used by DirectionEncoding
+    py::enum_<VectorField::PositionEncoding>(m, "PositionEncoding")
+        .value("float",      VectorField::PositionEncoding::FLOAT)
+        .value("half_float", VectorField::PositionEncoding::HALF_FLOAT);
+
     
     // Styles of the dot drawn by the DotRenderer
     py::enum_<DotRenderer::DotStyle>(m, "DotRendererStyle")
@@ -199,7 +300,9 @@ PYBIND11_MODULE(pyVFRendering, m)
 
 
     // Renderer base class
-    py::class_<RendererBase, std::shared_ptr<RendererBase>>(m, "RendererBase", "Renderer base class");
+    py::class_<RendererBase, std::shared_ptr<RendererBase>>(m, "RendererBase", "Renderer base class")
+        .def("getGpuMemoryUsage", &RendererBase::gpuMemoryUsage,
+            "Get the number of bytes of GPU buffer storage used by the renderer");
 
 
     // Combined renderer
@@ -11,6 +11,7 @@
 
 #include "VFRendering/View.hxx"
 #include "VFRendering/Utilities.hxx"
+#include "GpuBuffer.hxx"
 
 #include "shaders/boundingbox.vert.glsl.hxx"
 #include "shaders/boundingbox.frag.glsl.hxx"
@@ -22,6 +23,8 @@ BoundingBoxRenderer::BoundingBoxRenderer(const View& view, const std::vector<glm
     }
 }
 
+BoundingBoxRenderer::BoundingBoxRenderer(const BoundingBoxRenderer& other) : RendererBase(other), m_vertices(other.m_vertices), m_dashing_values(other.m_dashing_values) {}
+
 void BoundingBoxRenderer::initialize() {
     if (m_is_initialized) {
         return;
@@ -31,13 +34,13 @@ void BoundingBoxRenderer::initialize() {
     glGenVertexArrays(1, &m_vao);
     glBindVertexArray(m_vao);
 
-    glGenBuffers(1, &m_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    m_vbo.reset(new Utilities::GpuBuffer(GL_ARRAY_BUFFER));
+    m_vbo->bind();
     glVertexAttribPointer(0, 3, GL_FLOAT, false, 0, nullptr);
     glEnableVertexAttribArray(0);
 
-    glGenBuffers(1, &m_dash_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, m_dash_vbo);
+    m_dash_vbo.reset(new Utilities::GpuBuffer(GL_ARRAY_BUFFER));
+    m_dash_vbo->bind();
     glVertexAttribPointer(1, 1, GL_FLOAT, false, 0, nullptr);
     glEnableVertexAttribArray(1);
 
@@ -45,7 +48,8 @@ void BoundingBoxRenderer::initialize() {
 
     std::string vertex_shader_source = BOUNDINGBOX_VERT_GLSL;
     std::string fragment_shader_source = BOUNDINGBOX_FRAG_GLSL;
-    m_program = Utilities::createProgram(vertex_shader_source, fragment_shader_source, {"ivPosition", "ivDashingValue"});
+    m_program = Utilities::createProgram(m_view, vertex_shader_source, fragment_shader_source, {"ivPosition", "ivDashingValue"});
+    m_color_location = glGetUniformLocation(m_program, "uColor");
 }
 
 BoundingBoxRenderer::~BoundingBoxRenderer() {
@@ -53,19 +57,15 @@ BoundingBoxRenderer::~BoundingBoxRenderer() {
         return;
     }
     glDeleteVertexArrays(1, &m_vao);
-    glDeleteBuffers(1, &m_vbo);
-    glDeleteBuffers(1, &m_dash_vbo);
-    glDeleteProgram(m_program);
+    Utilities::releaseProgram(m_view, m_program);
 }
 
 void BoundingBoxRenderer::updateVertexData() {
     float line_width = options().get<Option::LINE_WIDTH>();
 
     if (line_width <= 0.0) {
-        glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * m_vertices.size(), m_vertices.data(), GL_STATIC_DRAW);
-        glBindBuffer(GL_ARRAY_BUFFER, m_dash_vbo);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(float) * m_dashing_values.size(), m_dashing_values.data(), GL_STATIC_DRAW);
+        m_vbo->upload(m_vertices);
+        m_dash_vbo->upload(m_dashing_values);
     } else {
         float radius = line_width * 0.5;
         int level_of_detail = options().get<Option::LEVEL_OF_DETAIL>();
@@ -136,10 +136,8 @@ void BoundingBoxRenderer::updateVertexData() {
 
         num_vertices = cylinder_vertices.size();
 
-        glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * cylinder_vertices.size(), cylinder_vertices.data(), GL_STATIC_DRAW);
-        glBindBuffer(GL_ARRAY_BUFFER, m_dash_vbo);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(float) * cylinder_dashing_values.size(), cylinder_dashing_values.data(), GL_STATIC_DRAW);
+        m_vbo->upload(cylinder_vertices);
+        m_dash_vbo->upload(cylinder_dashing_values);
     }
 }
 
@@ -166,6 +164,13 @@ void BoundingBoxRenderer::update(bool keep_geometry) {
     (void)keep_geometry;
 }
 
+std::size_t BoundingBoxRenderer::gpuMemoryUsage() const {
+    if (!m_is_initialized) {
+        return 0;
+    }
+    return RendererBase::gpuMemoryUsage() + m_vbo->capacity() + m_dash_vbo->capacity();
+}
+
 void BoundingBoxRenderer::draw(float aspect_ratio) {
     initialize();
 
@@ -176,14 +181,10 @@ void BoundingBoxRenderer::draw(float aspect_ratio) {
     glUseProgram(m_program);
     glBindVertexArray(m_vao);
 
-    auto matrices = Utilities::getMatrices(options(), aspect_ratio);
-    auto model_view_matrix = matrices.first;
-    auto projection_matrix = matrices.second;
     glm::vec3 color = options().get<Option::COLOR>();
 
-    glUniformMatrix4fv(glGetUniformLocation(m_program, "uProjectionMatrix"), 1, false, glm::value_ptr(projection_matrix));
-    glUniformMatrix4fv(glGetUniformLocation(m_program, "uModelviewMatrix"), 1, false, glm::value_ptr(model_view_matrix));
-    glUniform3f(glGetUniformLocation(m_program, "uColor"), color.r, color.g, color.b);
+    useCamera(m_program, aspect_ratio);
+    glUniform3f(m_color_location, color.r, color.g, color.b);
 
     glDisable(GL_CULL_FACE);
     if (options().get<Option::LINE_WIDTH>() <= 0.0) {
@@ -0,0 +1,393 @@
+#include "BravaisLattice.hxx"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <tuple>
+
+#include "ThreadPool.hxx"
+#include "Triangulation.hxx"
+
+namespace VFRendering {
+// Larger bases are unlikely to be crystal structures, and tetrahedralizing
+// their periodic patch would not be much faster than QHull on all positions.
+static const BravaisLattice::index_type max_detected_cell_atoms = 64;
+
+BravaisLattice::BravaisLattice() : BravaisLattice({{glm::vec3(1, 0, 0), glm::vec3(0, 1, 0), glm::vec3(0, 0, 1)}}, {glm::vec3(0, 0, 0)}, {0, 0, 0}) {}
+
+BravaisLattice::BravaisLattice(const std::array<glm::vec3, 3>& basis_vectors, const std::vector<glm::vec3>& cell_atoms, const glm::ivec3& n_cells) : BravaisLattice(basis_vectors, cell_atoms, n_cells, 1, {{index_type(cell_atoms.size()), index_type(cell_atoms.size() * n_cells.x), index_type(cell_atoms.size() * n_cells.x * n_cells.y)}}) {}
+
+BravaisLattice::BravaisLattice(const std::array<glm::vec3, 3>& basis_vectors, const std::vector<glm::vec3>& cell_atoms, const glm::ivec3& n_cells, index_type atom_stride, const std::array<index_type, 3>& cell_strides) : m_basis_vectors(basis_vectors), m_cell_atoms(cell_atoms), m_n_cells(n_cells), m_atom_stride(atom_stride), m_cell_strides(cell_strides), m_index_digits(indexDigits(basis_vectors, cell_atoms, n_cells, atom_stride, cell_strides)), m_num_tetrahedra(0) {
+    findCellTetrahedra();
+}
+
+const std::array<glm::vec3, 3>& BravaisLattice::basisVectors() const {
+    return m_basis_vectors;
+}
+
+const std::vector<glm::vec3>& BravaisLattice::cellAtoms() const {
+    return m_cell_atoms;
+}
+
+const glm::ivec3& BravaisLattice::numCells() const {
+    return m_n_cells;
+}
+
+BravaisLattice::index_type BravaisLattice::atomStride() const {
+    return m_atom_stride;
+}
+
+const std::array<BravaisLattice::index_type, 3>& BravaisLattice::cellStrides() const {
+    return m_cell_strides;
+}
+
+BravaisLattice::index_type BravaisLattice::numPositions() const {
+    return m_cell_atoms.size() * m_n_cells.x * m_n_cells.y * m_n_cells.z;
+}
+
+// Returns the digits of a lattice index, from the slowest to the fastest one,
+// leaving out those that are always zero.
+std::vector<BravaisLattice::IndexDigit> BravaisLattice::indexDigits(const std::array<glm::vec3, 3>& basis_vectors, const std::vector<glm::vec3>& cell_atoms, const glm::ivec3& n_cells, index_type atom_stride, const std::array<index_type, 3>& cell_strides) {
+    std::vector<IndexDigit> digits;
+    if (cell_atoms.size() > 1) {
+        digits.push_back({atom_stride, glm::vec3(0, 0, 0), true});
+    }
+    for (int i = 0; i < 3; i++) {
+        if (n_cells[i] > 1) {
+            digits.push_back({cell_strides[i], basis_vectors[i], false});
+        }
+    }
+    std::sort(digits.begin(), digits.end(), [](const IndexDigit& a, const IndexDigit& b) {
+        return a.stride > b.stride;
+    });
+    return digits;
+}
+
+glm::vec3 BravaisLattice::digitsPosition(const std::vector<IndexDigit>& digits, const std::vector<glm::vec3>& cell_atoms, index_type index) {
+    glm::vec3 position = cell_atoms.size() > 1 ? glm::vec3(0, 0, 0) : cell_atoms[0];
+    for (const auto& digit : digits) {
+        index_type value = index / digit.stride;
+        index %= digit.stride;
+        if (digit.is_atom) {
+            position += cell_atoms[value];
+        } else {
+            position += float(value) * digit.offset;
+        }
+    }
+    return position;
+}
+
+glm::vec3 BravaisLattice::position(index_type index) const {
+    return digitsPosition(m_index_digits, m_cell_atoms, index);
+}
+
+void BravaisLattice::copyPositions(index_type first, index_type count, glm::vec3* destination) const {
+    for (index_type i = 0; i < count; i++) {
+        destination[i] = digitsPosition(m_index_digits, m_cell_atoms, first + i);
+    }
+}
+
+static std::vector<BravaisLattice::index_type> divisors(BravaisLattice::index_type n) {
+    std::vector<BravaisLattice::index_type> small_divisors;
+    std::vector<BravaisLattice::index_type> large_divisors;
+    for (BravaisLattice::index_type i = 1; i * i <= n; i++) {
+        if (n % i == 0) {
+            small_divisors.push_back(i);
+            if (i * i != n) {
+                large_divisors.push_back(n / i);
+            }
+        }
+    }
+    small_divisors.insert(small_divisors.end(), large_divisors.rbegin(), large_divisors.rend());
+    return small_divisors;
+}
+
+// Checks whether the positions are the lattice with the given number of atoms
+// and cells, with the digits of the index in the given order.
+bool BravaisLattice::matchesLattice(const std::vector<glm::vec3>& positions, index_type num_atoms, const glm::ivec3& n_cells, int atom_digit, BravaisLattice& lattice) {
+    index_type atom_stride = 0;
+    std::array<index_type, 3> cell_strides;
+    index_type stride = 1;
+    for (int digit = 0, axis = 0; digit < 4; digit++) {
+        if (digit == atom_digit) {
+            atom_stride = stride;
+            stride *= num_atoms;
+        } else {
+            cell_strides[axis] = stride;
+            stride *= n_cells[axis];
+            axis++;
+        }
+    }
+
+    // estimate the basis vectors from the last cell along each axis, to
+    // reduce the error accumulated over many cells
+    std::array<glm::vec3, 3> basis_vectors;
+    float min_length = -1;
+    for (int axis = 0; axis < 3; axis++) {
+        if (n_cells[axis] > 1) {
+            basis_vectors[axis] = (positions[(n_cells[axis] - 1) * cell_strides[axis]] - positions[0]) / float(n_cells[axis] - 1);
+            float length = glm::length(basis_vectors[axis]);
+            if (min_length < 0 || length < min_length) {
+                min_length = length;
+            }
+        } else {
+            basis_vectors[axis] = glm::vec3(0, 0, 0);
+        }
+    }
+    if (min_length <= 0) {
+        return false;
+    }
+    std::vector<glm::vec3> cell_atoms(num_atoms);
+    for (index_type atom = 0; atom < num_atoms; atom++) {
+        cell_atoms[atom] = positions[atom * atom_stride];
+    }
+    float max_coordinate = 0;
+    for (const auto& position : {positions.front(), positions.back()}) {
+        max_coordinate = std::max(max_coordinate, glm::max(glm::abs(position.x), glm::max(glm::abs(position.y), glm::abs(position.z))));
+    }
+    const float tolerance = std::max(1e-3f * min_length, 1e-5f * max_coordinate);
+
+    auto digits = indexDigits(basis_vectors, cell_atoms, n_cells, atom_stride, cell_strides);
+    auto matches = [&](index_type index) {
+        glm::vec3 difference = glm::abs(positions[index] - digitsPosition(digits, cell_atoms, index));
+        return difference.x <= tolerance && difference.y <= tolerance && difference.z <= tolerance;
+    };
+
+    // reject most candidates using a few pseudo-randomly chosen positions
+    if (!matches(positions.size() - 1)) {
+        return false;
+    }
+    std::uint64_t random_state = 1;
+    for (int i = 0; i < 32; i++) {
+        random_state = random_state * 6364136223846793005ULL + 1442695040888963407ULL;
+        if (!matches((random_state >> 33) % positions.size())) {
+            return false;
+        }
+    }
+
+    std::atomic<bool> all_match(true);
+    Utilities::parallelFor(0, positions.size(), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end && all_match; i++) {
+            if (!matches(i)) {
+                all_match = false;
+            }
+        }
+    });
+    if (!all_match) {
+        return false;
+    }
+    lattice = BravaisLattice(basis_vectors, cell_atoms, n_cells, atom_stride, cell_strides);
+    return true;
+}
+
+bool BravaisLattice::detect(const std::vector<glm::vec3>& positions, BravaisLattice& lattice) {
+    const index_type num_positions = positions.size();
+    if (num_positions < 8) {
+        return false;
+    }
+    // Prefer the smallest basis, as a lattice with a single atom per cell
+    // could also be described with several atoms per (larger) cell.
+    for (index_type num_atoms : divisors(num_positions)) {
+        if (num_atoms > max_detected_cell_atoms || num_atoms == num_positions) {
+            break;
+        }
+        const index_type num_cells = num_positions / num_atoms;
+        for (int atom_digit = 0; atom_digit < (num_atoms > 1 ? 4 : 1); atom_digit++) {
+            for (index_type nx : divisors(num_cells)) {
+                for (index_type ny : divisors(num_cells / nx)) {
+                    index_type nz = num_cells / nx / ny;
+                    if (matchesLattice(positions, num_atoms, glm::ivec3(nx, ny, nz), atom_digit, lattice)) {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+    return false;
+}
+
+bool BravaisLattice::hasCellTetrahedra() const {
+    return !m_cell_tetrahedra.empty();
+}
+
+BravaisLattice::index_type BravaisLattice::numTetrahedra() const {
+    return m_num_tetrahedra;
+}
+
+void BravaisLattice::copyTetrahedra(index_type first, index_type count, std::array<index_type, 4>* destination) const {
+    if (count == 0) {
+        return;
+    }
+    auto cell_tetrahedron = std::upper_bound(m_cell_tetrahedra.begin(), m_cell_tetrahedra.end(), first, [](index_type index, const CellTetrahedron& t) {
+        return index < t.first_tetrahedron;
+    }) - 1;
+    for (index_type i = 0; i < count; i++) {
+        index_type index = first + i;
+        while (index >= cell_tetrahedron->first_tetrahedron + cell_tetrahedron->num_cells.x * cell_tetrahedron->num_cells.y * cell_tetrahedron->num_cells.z) {
+            ++cell_tetrahedron;
+        }
+        const glm::ivec3& n = cell_tetrahedron->num_cells;
+        index_type cell_index = index - cell_tetrahedron->first_tetrahedron;
+        glm::ivec3 cell = cell_tetrahedron->first_cell + glm::ivec3(cell_index % n.x, (cell_index / n.x) % n.y, cell_index / n.x / n.y);
+        for (int j = 0; j < 4; j++) {
+            glm::ivec3 vertex_cell = cell + cell_tetrahedron->cell_offsets[j];
+            destination[i][j] = cell_tetrahedron->atoms[j] * m_atom_stride + vertex_cell.x * m_cell_strides[0] + vertex_cell.y * m_cell_strides[1] + vertex_cell.z * m_cell_strides[2];
+        }
+    }
+}
+
+void BravaisLattice::findCellTetrahedra() {
+    m_cell_tetrahedra.clear();
+    m_num_tetrahedra = 0;
+    if (m_cell_atoms.empty() || m_n_cells.x < 2 || m_n_cells.y < 2 || m_n_cells.z < 2) {
+        return;
+    }
+    float volume = glm::abs(glm::determinant(glm::mat3(m_basis_vectors[0], m_basis_vectors[1], m_basis_vectors[2])));
+    if (!(volume > 1e-6f * glm::length(m_basis_vectors[0]) * glm::length(m_basis_vectors[1]) * glm::length(m_basis_vectors[2]))) {
+        // the basis vectors do not span a volume
+        return;
+    }
+
+    if (m_cell_atoms.size() == 1) {
+        // the same decomposition into six tetrahedra as for rectilinear grids
+        static const glm::ivec3 corners[] = {
+            {0, 0, 0}, {1, 0, 0}, {1, 1, 0}, {0, 1, 0},
+            {0, 0, 1}, {1, 0, 1}, {1, 1, 1}, {0, 1, 1}
+        };
+        static const int cell_indices[] = {
+            0, 1, 5, 3,
+            1, 3, 2, 5,
+            3, 2, 5, 6,
+            7, 6, 5, 3,
+            4, 7, 5, 3,
+            0, 4, 3, 5
+        };
+        for (int i = 0; i < 6; i++) {
+            CellTetrahedron cell_tetrahedron;
+            for (int j = 0; j < 4; j++) {
+                cell_tetrahedron.cell_offsets[j] = corners[cell_indices[4 * i + j]];
+                cell_tetrahedron.atoms[j] = 0;
+            }
+            m_cell_tetrahedra.push_back(cell_tetrahedron);
+        }
+    } else {
+        findMultiAtomCellTetrahedra();
+    }
+
+    // tetrahedra are enumerated per cell tetrahedron, for all cells in which
+    // all of their vertices exist
+    for (auto it = m_cell_tetrahedra.begin(); it != m_cell_tetrahedra.end();) {
+        glm::ivec3 min_offset = it->cell_offsets[0];
+        glm::ivec3 max_offset = it->cell_offsets[0];
+        for (const auto& cell_offset : it->cell_offsets) {
+            min_offset = glm::min(min_offset, cell_offset);
+            max_offset = glm::max(max_offset, cell_offset);
+        }
+        it->first_cell = -min_offset;
+        it->num_cells = m_n_cells - (max_offset - min_offset);
+        if (it->num_cells.x <= 0 || it->num_cells.y <= 0 || it->num_cells.z <= 0) {
+            it = m_cell_tetrahedra.erase(it);
+            continue;
+        }
+        it->first_tetrahedron = m_num_tetrahedra;
+        m_num_tetrahedra += it->num_cells.x * it->num_cells.y * it->num_cells.z;
+        ++it;
+    }
+}
+
+void BravaisLattice::findMultiAtomCellTetrahedra() {
+    const glm::mat3 basis(m_basis_vectors[0], m_basis_vectors[1], m_basis_vectors[2]);
+    const glm::mat3 inverse_basis = glm::inverse(basis);
+    const float cell_volume = glm::abs(glm::determinant(basis));
+    const index_type num_atoms = m_cell_atoms.size();
+
+    // The Delaunay tetrahedralization of a lattice is often degenerate, e.g.
+    // for the octahedra of fcc lattices. A perturbation that is the same for
+    // an atom in every cell makes it unique and thereby periodic. Its effect
+    // on the circumspheres is only quadratic, so it has to be rather large to
+    // stay above the single precision rounding errors.
+    float min_length = std::min(glm::length(m_basis_vectors[0]), std::min(glm::length(m_basis_vectors[1]), glm::length(m_basis_vectors[2])));
+    std::vector<glm::vec3> perturbed_atoms(num_atoms);
+    std::uint32_t random_state = 12345;
+    for (index_type atom = 0; atom < num_atoms; atom++) {
+        glm::vec3 perturbation;
+        for (int i = 0; i < 3; i++) {
+            random_state = random_state * 1664525u + 1013904223u;
+            perturbation[i] = (random_state >> 8) / float(1 << 24) - 0.5f;
+        }
+        perturbed_atoms[atom] = m_cell_atoms[atom] - m_cell_atoms[0] + 1e-2f * min_length * perturbation;
+    }
+
+    // tetrahedralize the cell and its neighbors
+    std::vector<glm::vec3> patch_positions;
+    std::vector<std::pair<glm::ivec3, index_type>> patch_vertices;
+    for (int k = -1; k <= 1; k++) {
+        for (int j = -1; j <= 1; j++) {
+            for (int i = -1; i <= 1; i++) {
+                for (index_type atom = 0; atom < num_atoms; atom++) {
+                    patch_positions.push_back(basis * glm::vec3(i, j, k) + perturbed_atoms[atom]);
+                    patch_vertices.push_back({glm::ivec3(i, j, k), atom});
+                }
+            }
+        }
+    }
+    auto patch_tetrahedra = Triangulation::delaunayTetrahedra(patch_positions);
+
+    // Keep the tetrahedra with their centroid in the central cell. Copies of
+    // one tetrahedron in other cells are shifted by whole basis vectors, so
+    // exactly one of them is kept.
+    float total_volume = 0;
+    for (const auto& patch_tetrahedron : patch_tetrahedra) {
+        glm::vec3 centroid(0, 0, 0);
+        for (auto index : patch_tetrahedron) {
+            centroid += patch_positions[index] / 4.0f;
+        }
+        glm::vec3 fractional_centroid = inverse_basis * centroid;
+        if (glm::any(glm::lessThan(fractional_centroid, glm::vec3(0, 0, 0))) || glm::any(glm::greaterThanEqual(fractional_centroid, glm::vec3(1, 1, 1)))) {
+            continue;
+        }
+        CellTetrahedron cell_tetrahedron;
+        for (int j = 0; j < 4; j++) {
+            cell_tetrahedron.cell_offsets[j] = patch_vertices[patch_tetrahedron[j]].first;
+            cell_tetrahedron.atoms[j] = patch_vertices[patch_tetrahedron[j]].second;
+        }
+        const glm::vec3& p0 = patch_positions[patch_tetrahedron[0]];
+        total_volume += glm::abs(glm::determinant(glm::mat3(patch_positions[patch_tetrahedron[1]] - p0, patch_positions[patch_tetrahedron[2]] - p0, patch_positions[patch_tetrahedron[3]] - p0))) / 6;
+        m_cell_tetrahedra.push_back(cell_tetrahedron);
+    }
+
+    // The repeated tetrahedra must fill space without overlaps: their volume
+    // has to match the cell volume and, up to translations, every face has to
+    // be shared by exactly two tetrahedra.
+    typedef std::tuple<int, int, int, index_type> vertex_type;
+    std::map<std::array<vertex_type, 3>, int> face_counts;
+    for (const auto& cell_tetrahedron : m_cell_tetrahedra) {
+        for (int opposite = 0; opposite < 4; opposite++) {
+            std::array<vertex_type, 3> face;
+            for (int j = 0, k = 0; j < 4; j++) {
+                if (j != opposite) {
+                    const glm::ivec3& offset = cell_tetrahedron.cell_offsets[j];
+                    face[k++] = vertex_type(offset.x, offset.y, offset.z, cell_tetrahedron.atoms[j]);
+                }
+            }
+            std::sort(face.begin(), face.end());
+            for (int j = 2; j >= 0; j--) {
+                std::get<0>(face[j]) -= std::get<0>(face[0]);
+                std::get<1>(face[j]) -= std::get<1>(face[0]);
+                std::get<2>(face[j]) -= std::get<2>(face[0]);
+            }
+            face_counts[face]++;
+        }
+    }
+    bool is_valid = glm::abs(total_volume - cell_volume) <= 1e-3f * cell_volume;
+    for (const auto& face_count : face_counts) {
+        if (face_count.second != 2) {
+            is_valid = false;
+        }
+    }
+    if (!is_valid) {
+        m_cell_tetrahedra.clear();
+    }
+}
+}
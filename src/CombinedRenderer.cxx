@@ -39,4 +39,27 @@ void CombinedRenderer::updateOptions(const Options& options) {
         renderer->updateOptions(options);
     }
 }
+
+std::size_t CombinedRenderer::gpuMemoryUsage() const {
+    std::size_t memory_usage = 0;
+    // buffers shared by several of the renderers are only counted once
+    std::map<const void*, std::size_t> shared_memory_usage;
+    for (auto renderer : m_renderers) {
+        memory_usage += renderer->gpuMemoryUsage();
+        std::map<const void*, std::size_t> renderer_shared_memory_usage;
+        renderer->sharedGpuMemoryUsage(renderer_shared_memory_usage);
+        for (const auto& shared_buffers : renderer_shared_memory_usage) {
+            if (!shared_memory_usage.insert(shared_buffers).second) {
+                memory_usage -= shared_buffers.second;
+            }
+        }
+    }
+    return memory_usage;
+}
+
+void CombinedRenderer::sharedGpuMemoryUsage(std::map<const void*, std::size_t>& shared_memory_usage) const {
+    for (auto renderer : m_renderers) {
+        renderer->sharedGpuMemoryUsage(shared_memory_usage);
+    }
+}
 }
@@ -12,6 +12,7 @@
 #include <glm/gtx/rotate_vector.hpp>
 
 #include "VFRendering/Utilities.hxx"
+#include "GpuBuffer.hxx"
 
 #include "shaders/coordinatesystem.vert.glsl.hxx"
 #include "shaders/coordinatesystem.frag.glsl.hxx"
@@ -27,8 +28,8 @@ void CoordinateSystemRenderer::initialize() {
 
     glGenVertexArrays(1, &m_vao);
     glBindVertexArray(m_vao);
-    glGenBuffers(1, &m_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    m_vbo.reset(new Utilities::GpuBuffer(GL_ARRAY_BUFFER));
+    m_vbo->bind();
     glVertexAttribPointer(0, 3, GL_FLOAT, false, 4 * 3 * 3, nullptr);
     glVertexAttribPointer(1, 3, GL_FLOAT, false, 4 * 3 * 3, (void*)(4 * 3));
     glVertexAttribPointer(2, 3, GL_FLOAT, false, 4 * 3 * 3, (void*)(4 * 3 * 2));
@@ -45,8 +46,7 @@ CoordinateSystemRenderer::~CoordinateSystemRenderer() {
         return;
     }
     glDeleteVertexArrays(1, &m_vao);
-    glDeleteBuffers(1, &m_vbo);
-    glDeleteProgram(m_program);
+    Utilities::releaseProgram(m_view, m_program);
 }
 
 void CoordinateSystemRenderer::optionsHaveChanged(const std::vector<int>& changed_options) {
@@ -79,6 +79,13 @@ void CoordinateSystemRenderer::optionsHaveChanged(const std::vector<int>& change
     }
 }
 
+std::size_t CoordinateSystemRenderer::gpuMemoryUsage() const {
+    if (!m_is_initialized) {
+        return 0;
+    }
+    return RendererBase::gpuMemoryUsage() + m_vbo->capacity();
+}
+
 void CoordinateSystemRenderer::update(bool keep_geometry) {
     (void)keep_geometry;
 }
@@ -90,17 +97,17 @@ void CoordinateSystemRenderer::draw(float aspect_ratio) {
         return;
     }
 
-    glm::vec3 camera_position = options().get<View::Option::CAMERA_POSITION>();
-    glm::vec3 center_position = options().get<View::Option::CENTER_POSITION>();
-    glm::vec3 up_vector = options().get<View::Option::UP_VECTOR>();
     glm::vec3 origin = options().get<Option::ORIGIN>();
 
-
-    auto matrices = Utilities::getMatrices(options(), aspect_ratio);
-    auto modelview_matrix = matrices.first;
-    auto projection_matrix = matrices.second;
+    glUseProgram(m_program);
+    glBindVertexArray(m_vao);
 
     if (options().get<Option::NORMALIZE>()) {
+        // only the orientation of the camera is used
+        glm::vec3 camera_position = options().get<View::Option::CAMERA_POSITION>();
+        glm::vec3 center_position = options().get<View::Option::CENTER_POSITION>();
+        glm::vec3 up_vector = options().get<View::Option::UP_VECTOR>();
+        auto projection_matrix = Utilities::getMatrices(options(), aspect_ratio).second;
         if (options().get<View::Option::VERTICAL_FIELD_OF_VIEW>() == 0) {
             if (aspect_ratio > 1) {
                 projection_matrix = glm::ortho(-0.5f*aspect_ratio, 0.5f*aspect_ratio, -0.5f, 0.5f, -10.0f, 10.0f);
@@ -108,15 +115,13 @@ void CoordinateSystemRenderer::draw(float aspect_ratio) {
                 projection_matrix = glm::ortho(-0.5f, 0.5f, -0.5f/aspect_ratio, 0.5f/aspect_ratio, -10.0f, 10.0f);
             }
         }
-        modelview_matrix = glm::lookAt(glm::normalize(camera_position - center_position), glm::vec3(0.0, 0.0, 0.0), up_vector);
+        auto modelview_matrix = glm::lookAt(glm::normalize(camera_position - center_position), glm::vec3(0.0, 0.0, 0.0), up_vector);
+        useCamera(m_program, projection_matrix, modelview_matrix, glm::vec3(modelview_matrix * glm::vec4(camera_position, 1.0f)));
+    } else {
+        useCamera(m_program, aspect_ratio);
     }
-
-    glUseProgram(m_program);
-    glBindVertexArray(m_vao);
-
-    glUniformMatrix4fv(glGetUniformLocation(m_program, "uProjectionMatrix"), 1, false, glm::value_ptr(projection_matrix));
-    glUniformMatrix4fv(glGetUniformLocation(m_program, "uModelviewMatrix"), 1, false, glm::value_ptr(modelview_matrix));
-    glUniform3f(glGetUniformLocation(m_program, "uOrigin"), origin.x, origin.y, origin.z);
+    glUniform3f(m_origin_location, origin.x, origin.y, origin.z);
+    setColormapUniforms();
 
     glDisable(GL_CULL_FACE);
     glDrawArrays(GL_TRIANGLES, 0, m_num_vertices);
@@ -358,7 +363,7 @@ void CoordinateSystemRenderer::updateVertexData() {
             vertices.push_back(normal);
         }
     }
-    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
+    m_vbo->upload(vertices);
     m_num_vertices = vertices.size()/3;
 }
 
@@ -367,13 +372,15 @@ void CoordinateSystemRenderer::updateShaderProgram() {
         return;
     }
     if (m_program) {
-        glDeleteProgram(m_program);
+        Utilities::releaseProgram(m_view, m_program);
+        m_program = 0;
     }
-    m_program = 0;
 
     std::string vertex_shader_source = COORDINATESYSTEM_VERT_GLSL;
     vertex_shader_source += options().get<View::Option::COLORMAP_IMPLEMENTATION>();
     std::string fragment_shader_source = COORDINATESYSTEM_FRAG_GLSL;
-    m_program = Utilities::createProgram(vertex_shader_source, fragment_shader_source, {"ivPosition", "ivDirection"});
+    m_program = Utilities::createProgram(m_view, vertex_shader_source, fragment_shader_source, {"ivPosition", "ivDirection"});
+    m_origin_location = glGetUniformLocation(m_program, "uOrigin");
+    resolveColormapUniforms(m_program);
 }
 }
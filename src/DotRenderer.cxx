@@ -31,22 +31,15 @@ void DotRenderer::initialize()
     glGenVertexArrays(1, &m_vao);
     glBindVertexArray(m_vao);
    
-    // Instance positions VBO
-    glGenBuffers(1, &m_instance_position_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, m_instance_position_vbo);
-    glVertexAttribPointer(0, 3, GL_FLOAT, false, 0, nullptr);
+    // Instance positions and directions, bound in update()
     glEnableVertexAttribArray(0);
-  
-    // Instance direction VBO
-    glGenBuffers(1, &m_instance_direction_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, m_instance_direction_vbo);
-    glVertexAttribPointer(1, 3, GL_FLOAT, false, 0, nullptr);
     glEnableVertexAttribArray(1);
     
     m_num_instances = 0;
     updateShaderProgram(); 
 
     update( false );
+    updateChannels();
 }
 
 DotRenderer::~DotRenderer() 
@@ -54,9 +47,7 @@ DotRenderer::~DotRenderer()
     if ( !m_is_initialized ) return;
 
     glDeleteVertexArrays(1, &m_vao);
-    glDeleteBuffers(1, &m_instance_position_vbo);
-    glDeleteBuffers(1, &m_instance_direction_vbo);
-    glDeleteProgram(m_program);
+    Utilities::releaseProgram(m_view, m_program);
 }
 
 void DotRenderer::optionsHaveChanged( const std::vector<int>& changed_options )
@@ -85,19 +76,24 @@ void DotRenderer::update( bool keep_geometry )
     }
     glBindVertexArray( m_vao );
    
-    // If geometry is changed copy the new data into position's VBO
+    // If geometry is changed bind the new positions
     if ( !keep_geometry ) {
-        glBindBuffer( GL_ARRAY_BUFFER, m_instance_position_vbo );
-        glBufferData( GL_ARRAY_BUFFER, sizeof(glm::vec3) * positions().size(), 
-            positions().data(), GL_STREAM_DRAW );
+        bindPositionData(0);
     }
    
-    // New data into direction's VBO
-    glBindBuffer( GL_ARRAY_BUFFER, m_instance_direction_vbo );
-    glBufferData( GL_ARRAY_BUFFER, sizeof(glm::vec3) * directions().size(), 
-        directions().data(), GL_STREAM_DRAW );
+    // Bind the new directions
+    bindDirectionData(1);
 
-    m_num_instances = std::min( positions().size(), directions().size() );
+    m_num_instances = std::min<std::size_t>( geometry().numPositions(), numDirections() );
+}
+
+void DotRenderer::updatePositions()
+{
+    if (!m_is_initialized) {
+        return;
+    }
+    glBindVertexArray( m_vao );
+    bindPositionData(0);
 }
 
 void DotRenderer::draw( float aspect_ratio )
@@ -108,20 +104,15 @@ void DotRenderer::draw( float aspect_ratio )
     glBindVertexArray( m_vao );
     glUseProgram( m_program );
 
-    auto matrices = Utilities::getMatrices( options(), aspect_ratio );
-    auto model_view_matrix = matrices.first;
-    auto projection_matrix = matrices.second;
-    
     float dot_radius = options().get<DotRenderer::Option::DOT_RADIUS>();
     glm::vec2 frame_size = m_view.getFramebufferSize();
     dot_radius *= std::min( frame_size[0], frame_size[1] ) / 1000;
 
     // Set shader's uniforms
-    glUniformMatrix4fv( glGetUniformLocation( m_program, "uProjectionMatrix" ), 
-        1, false, glm::value_ptr(projection_matrix));
-    glUniformMatrix4fv( glGetUniformLocation( m_program, "uModelviewMatrix" ), 
-        1, false, glm::value_ptr(model_view_matrix));
-    glUniform1f( glGetUniformLocation( m_program, "uDotRadius" ), dot_radius);
+    useCamera( m_program, aspect_ratio );
+    glUniform1f( m_dot_radius_location, dot_radius );
+    setColormapUniforms();
+    setDecodingUniforms();
 
     glDisable( GL_CULL_FACE );
 #ifndef __EMSCRIPTEN__
@@ -135,21 +126,42 @@ void DotRenderer::updateShaderProgram()
 {
     if ( !m_is_initialized ) return;
 
-    if ( m_program ) glDeleteProgram( m_program );
+    if ( m_program ) {
+        Utilities::releaseProgram( m_view, m_program );
+        m_program = 0;
+    }
 
     // Vertex shader options
     std::string vertex_shader_source = DOT_VERT_GLSL; 
+    vertex_shader_source += channelsImplementation( ChannelSource::ATTRIBUTES );
     vertex_shader_source += 
         options().get<View::Option::COLORMAP_IMPLEMENTATION>();
     vertex_shader_source +=
         options().get<View::Option::IS_VISIBLE_IMPLEMENTATION>();
+    vertex_shader_source += directionDecodingImplementation();
+    vertex_shader_source += positionDecodingImplementation();
 
     // Fragment shader options 
     std::string fragment_shader_source = getDotStyle(options().get<DotRenderer::Option::DOT_STYLE>());
     
     // Compile & link shader Program. Pass uniforms. 
-    m_program = Utilities::createProgram( vertex_shader_source, 
-        fragment_shader_source, { "ivDotCoordinates", "ivDotDirection" } );
+    std::vector<std::string> attributes = { "ivDotCoordinates", "ivDotDirection" };
+    for ( const auto& attribute : channelAttributes() ) {
+        attributes.push_back( attribute );
+    }
+    m_program = Utilities::createProgram( m_view, vertex_shader_source, 
+        fragment_shader_source, attributes );
+    m_dot_radius_location = glGetUniformLocation( m_program, "uDotRadius" );
+    resolveColormapUniforms( m_program );
+    resolveDecodingUniforms( m_program );
+}
+
+void DotRenderer::updateChannels()
+{
+    if ( !m_is_initialized ) return;
+
+    glBindVertexArray( m_vao );
+    bindChannelData( 2, 0 );
 }
 
 std::string DotRenderer::getDotStyle(const DotStyle& dotstyle)
@@ -0,0 +1,316 @@
+#include "FileCache.hxx"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+#if defined(_WIN32)
+#include <direct.h>
+#include <io.h>
+#include <sys/utime.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#include <utime.h>
+#if !defined(__EMSCRIPTEN__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#define VFRENDERING_HAS_MMAP
+#endif
+#endif
+
+#include "VFRendering/Utilities.hxx"
+
+namespace VFRendering {
+namespace Utilities {
+static std::string defaultCacheDirectory() {
+    const char* directory = std::getenv("VFRENDERING_CACHE_DIR");
+    if (directory) {
+        return directory;
+    }
+#if defined(_WIN32)
+    directory = std::getenv("LOCALAPPDATA");
+    if (directory && *directory) {
+        return std::string(directory) + "\\VFRendering";
+    }
+#elif !defined(__EMSCRIPTEN__)
+    directory = std::getenv("XDG_CACHE_HOME");
+    if (directory && *directory) {
+        return std::string(directory) + "/vfrendering";
+    }
+    directory = std::getenv("HOME");
+    if (directory && *directory) {
+        return std::string(directory) + "/.cache/vfrendering";
+    }
+#endif
+    // without a persistent file system, caching is disabled by default
+    return "";
+}
+
+static std::mutex cache_directory_mutex;
+static std::string cache_directory = defaultCacheDirectory();
+static bool cache_directory_exists = false;
+static std::size_t cache_size_limit = std::size_t(1) << 30;
+
+// Only files with these prefixes are removed to limit the size of the cache
+// directory, as it may be shared with other data.
+static const char* const cache_file_prefixes[] = {"program-", "tetrahedra-"};
+static const char cache_file_suffix[] = ".bin";
+
+static void createDirectory(const std::string& path) {
+#if defined(_WIN32)
+    _mkdir(path.c_str());
+#else
+    mkdir(path.c_str(), 0755);
+#endif
+}
+
+void setCacheDirectory(const std::string& directory) {
+    std::lock_guard<std::mutex> lock(cache_directory_mutex);
+    cache_directory = directory;
+    cache_directory_exists = false;
+}
+
+std::string getCacheDirectory() {
+    std::lock_guard<std::mutex> lock(cache_directory_mutex);
+    return cache_directory;
+}
+
+void setCacheSizeLimit(std::size_t size_limit) {
+    std::lock_guard<std::mutex> lock(cache_directory_mutex);
+    cache_size_limit = size_limit;
+}
+
+std::size_t getCacheSizeLimit() {
+    std::lock_guard<std::mutex> lock(cache_directory_mutex);
+    return cache_size_limit;
+}
+
+std::string cacheFilePath(const std::string& name) {
+    std::lock_guard<std::mutex> lock(cache_directory_mutex);
+    if (cache_directory.empty()) {
+        return "";
+    }
+    if (!cache_directory_exists) {
+        // create all missing parent directories, ignoring errors for the
+        // ones that exist already
+        for (std::size_t i = 1; i < cache_directory.size(); i++) {
+            if (cache_directory[i] == '/' || cache_directory[i] == '\\') {
+                createDirectory(cache_directory.substr(0, i));
+            }
+        }
+        createDirectory(cache_directory);
+        cache_directory_exists = true;
+    }
+    return cache_directory + "/" + name;
+}
+
+static bool isCacheFileName(const std::string& name) {
+    const std::size_t suffix_size = sizeof(cache_file_suffix) - 1;
+    if (name.size() < suffix_size || name.compare(name.size() - suffix_size, suffix_size, cache_file_suffix) != 0) {
+        return false;
+    }
+    for (const char* prefix : cache_file_prefixes) {
+        if (name.compare(0, std::strlen(prefix), prefix) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+namespace {
+struct CacheFileInfo {
+    std::string path;
+    std::uint64_t size;
+    std::int64_t time;
+};
+}
+
+static std::vector<CacheFileInfo> listCacheFiles(const std::string& directory) {
+    std::vector<CacheFileInfo> files;
+#if defined(_WIN32)
+    struct _finddata64_t file_data;
+    intptr_t handle = _findfirst64((directory + "\\*").c_str(), &file_data);
+    if (handle == -1) {
+        return files;
+    }
+    do {
+        if (!(file_data.attrib & _A_SUBDIR) && isCacheFileName(file_data.name)) {
+            files.push_back({directory + "/" + file_data.name, static_cast<std::uint64_t>(file_data.size), static_cast<std::int64_t>(file_data.time_write)});
+        }
+    } while (_findnext64(handle, &file_data) == 0);
+    _findclose(handle);
+#else
+    DIR* dir = opendir(directory.c_str());
+    if (!dir) {
+        return files;
+    }
+    while (struct dirent* entry = readdir(dir)) {
+        if (!isCacheFileName(entry->d_name)) {
+            continue;
+        }
+        std::string path = directory + "/" + entry->d_name;
+        struct stat file_stat;
+        if (stat(path.c_str(), &file_stat) == 0 && S_ISREG(file_stat.st_mode)) {
+            files.push_back({path, static_cast<std::uint64_t>(file_stat.st_size), static_cast<std::int64_t>(file_stat.st_mtime)});
+        }
+    }
+    closedir(dir);
+#endif
+    return files;
+}
+
+static void limitCacheSize(const std::string& written_path) {
+    // several threads may write cache files at the same time
+    static std::mutex limit_mutex;
+    std::lock_guard<std::mutex> limit_lock(limit_mutex);
+    const std::uint64_t size_limit = getCacheSizeLimit();
+    std::vector<CacheFileInfo> files = listCacheFiles(written_path.substr(0, written_path.find_last_of("/\\")));
+    std::uint64_t total_size = 0;
+    for (auto& file : files) {
+        total_size += file.size;
+        // modification times have a resolution of seconds on some file
+        // systems, so the file that was just written is removed last
+        if (file.path == written_path) {
+            file.time = std::numeric_limits<std::int64_t>::max();
+        }
+    }
+    if (total_size <= size_limit) {
+        return;
+    }
+    std::sort(files.begin(), files.end(), [](const CacheFileInfo& a, const CacheFileInfo& b) {
+        return a.time < b.time;
+    });
+    for (const auto& file : files) {
+        if (total_size <= size_limit) {
+            break;
+        }
+        // files that are in use by other processes may not be removable
+        if (std::remove(file.path.c_str()) == 0) {
+            total_size -= file.size;
+        }
+    }
+}
+
+bool writeCacheFile(const std::string& path, const void* header, std::size_t header_size, const void* data, std::size_t data_size) {
+    std::string temporary_path = path + "." + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + ".tmp";
+    {
+        std::ofstream file(temporary_path, std::ios::binary);
+        file.write(static_cast<const char*>(header), header_size);
+        file.write(static_cast<const char*>(data), data_size);
+        if (!file) {
+            file.close();
+            std::remove(temporary_path.c_str());
+            return false;
+        }
+    }
+    if (std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+        std::remove(temporary_path.c_str());
+        return false;
+    }
+    limitCacheSize(path);
+    return true;
+}
+
+void touchCacheFile(const std::string& path) {
+    // the modification time is used as the time of the last use, as access
+    // times are often not updated
+#if defined(_WIN32)
+    _utime(path.c_str(), nullptr);
+#else
+    utime(path.c_str(), nullptr);
+#endif
+}
+
+MappedFile::MappedFile(const std::string& path) {
+#ifdef VFRENDERING_HAS_MMAP
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0) {
+        void* mapping = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) {
+            m_data = static_cast<const char*>(mapping);
+            m_size = file_stat.st_size;
+            m_is_mapped = true;
+        }
+    }
+    close(fd);
+#else
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return;
+    }
+    std::streamoff size = file.tellg();
+    if (size <= 0) {
+        return;
+    }
+    char* buffer = new char[size];
+    file.seekg(0);
+    if (!file.read(buffer, size)) {
+        delete[] buffer;
+        return;
+    }
+    m_data = buffer;
+    m_size = size;
+#endif
+}
+
+MappedFile::~MappedFile() {
+    if (!m_data) {
+        return;
+    }
+#ifdef VFRENDERING_HAS_MMAP
+    if (m_is_mapped) {
+        munmap(const_cast<char*>(m_data), m_size);
+        return;
+    }
+#endif
+    delete[] m_data;
+}
+
+bool MappedFile::isValid() const {
+    return m_data != nullptr;
+}
+
+const char* MappedFile::data() const {
+    return m_data;
+}
+
+std::size_t MappedFile::size() const {
+    return m_size;
+}
+
+void MappedFile::prefetch(std::size_t offset, std::size_t size) const {
+#ifdef VFRENDERING_HAS_MMAP
+    if (!m_is_mapped || offset >= m_size) {
+        return;
+    }
+    size = std::min(size, m_size - offset);
+    const std::size_t page_size = sysconf(_SC_PAGESIZE);
+    const std::size_t first_page = offset / page_size * page_size;
+    madvise(const_cast<char*>(m_data) + first_page, offset + size - first_page, MADV_WILLNEED);
+    // touching every page waits for the read-ahead to finish
+    volatile char sum = 0;
+    for (std::size_t page = first_page; page < offset + size; page += page_size) {
+        sum += m_data[page];
+    }
+    (void)sum;
+#else
+    // the file has been read completely already
+    (void)offset;
+    (void)size;
+#endif
+}
+}
+}
@@ -1,91 +1,238 @@
 #include "VFRendering/Geometry.hxx"
 
-#ifndef NO_QHULL
-#include "Qhull.h"
-#include "QhullFacetList.h"
-#include "QhullVertexSet.h"
-#endif
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+#include "BravaisLattice.hxx"
+#include "Hash.hxx"
+#include "ThreadPool.hxx"
+#include "Triangulation.hxx"
 
 namespace VFRendering {
-Geometry::Geometry() {}
+// the number of positions per block of bounds, which are calculated again as
+// a whole if any of their positions changed
+static const Geometry::index_type bounds_block_size = 16384;
+
+// The data shared by all copies of a geometry. Everything that is calculated
+// lazily is guarded by mutex, as copies may be used from several threads.
+struct Geometry::Data {
+    std::vector<glm::vec3> positions;
+    std::vector<std::array<index_type, 3>> surface_indices;
+    std::vector<std::array<index_type, 4>> volume_indices;
+    // whether the indices were passed to the constructor, as opposed to
+    // being calculated later on
+    bool has_given_surface_indices = false;
+    bool has_given_volume_indices = false;
+    // whether the volume indices were given or calculated, as there may be
+    // no tetrahedra at all, e.g. for coplanar positions
+    bool has_volume_indices = false;
+    bool is_2d = false;
+    bool bounds_min_set = false;
+    glm::vec3 bounds_min;
+    bool bounds_max_set = false;
+    glm::vec3 bounds_max;
+    // minimum and maximum of each block of explicit positions
+    std::vector<std::array<glm::vec3, 2>> block_bounds;
+    // for geometries created by withPositions, the data of the geometry whose
+    // surface and volume indices are used
+    std::shared_ptr<Data> topology;
+    std::shared_future<void> volume_indices_ready;
+    std::shared_ptr<std::vector<std::array<index_type, 4>>> pending_volume_indices;
+    bool is_implicit = false;
+    std::vector<float> xs;
+    std::vector<float> ys;
+    std::vector<float> zs;
+    std::shared_ptr<const BravaisLattice> lattice;
+    bool content_hash_set = false;
+    std::uint64_t content_hash = 0;
+    std::recursive_mutex mutex;
+};
+
+Geometry::Geometry() : m_data(std::make_shared<Data>()) {}
 
-Geometry::Geometry(const std::vector<glm::vec3>& positions, const std::vector<std::array<Geometry::index_type, 3>>& surface_indices, const std::vector<std::array<Geometry::index_type, 4>>& volume_indices, const bool& is_2d) : m_positions(positions), m_surface_indices(surface_indices), m_volume_indices(volume_indices), m_is_2d(is_2d) {}
+Geometry::Geometry(const std::vector<glm::vec3>& positions, const std::vector<std::array<Geometry::index_type, 3>>& surface_indices, const std::vector<std::array<Geometry::index_type, 4>>& volume_indices, const bool& is_2d) : m_data(std::make_shared<Data>()) {
+    m_data->positions = positions;
+    m_data->surface_indices = surface_indices;
+    m_data->volume_indices = volume_indices;
+    m_data->has_given_surface_indices = !surface_indices.empty();
+    m_data->has_given_volume_indices = !volume_indices.empty();
+    m_data->has_volume_indices = m_data->has_given_volume_indices;
+    m_data->is_2d = is_2d;
+}
 
 const std::vector<glm::vec3>& Geometry::positions() const {
-    return m_positions;
+    std::lock_guard<std::recursive_mutex> lock(m_data->mutex);
+    if (m_data->is_implicit && m_data->positions.empty()) {
+        m_data->positions.resize(numPositions());
+        Utilities::parallelFor(0, m_data->positions.size(), [this](std::size_t begin, std::size_t end) {
+            copyPositions(begin, end - begin, m_data->positions.data() + begin);
+        });
+    }
+    return m_data->positions;
 }
 
 const std::vector<std::array<Geometry::index_type, 3>>& Geometry::surfaceIndices() const {
-    if (m_surface_indices.empty() && m_positions.size() >= 3) {
-        // TODO: calculate surface triangulation
-        std::cerr << "surface indices calculation for arbitrary geometry is not implemented yet" << std::endl;
+    if (m_data->topology) {
+        return topology().surfaceIndices();
+    }
+    std::lock_guard<std::recursive_mutex> lock(m_data->mutex);
+    if (hasImplicitSurfaceIndices()) {
+        if (m_data->surface_indices.empty()) {
+            m_data->surface_indices.resize(numSurfaceTriangles());
+            Utilities::parallelFor(0, m_data->surface_indices.size(), [this](std::size_t begin, std::size_t end) {
+                copySurfaceIndices(begin, end - begin, m_data->surface_indices.data() + begin);
+            });
+        }
+    } else if (m_data->surface_indices.empty() && numPositions() >= 3) {
+        if (is2d()) {
+            m_data->surface_indices = Triangulation::planarDelaunayTriangles(positions());
+        } else {
+            // the surface of a volume is the boundary of its tetrahedralization
+            m_data->surface_indices = Triangulation::boundaryTriangles(positions(), volumeIndices());
+        }
     }
-    return m_surface_indices;
+    return m_data->surface_indices;
 }
 
 const bool& Geometry::is2d() const {
-    return m_is_2d;
+    return m_data->is_2d;
 }
 
 const glm::vec3& Geometry::min() const {
-    if (!m_bounds_min_set) {
-        m_bounds_min_set = true;
-        if (positions().size() > 0) {
-            glm::vec3 m_bounds_min = positions()[0];
-            for (const auto& position : positions()) {
-                m_bounds_min = glm::min(m_bounds_min, position);
-            }
-        } else {
-            // origin as fallback
-            m_bounds_min = glm::vec3(0, 0, 0);
-        }
+    std::lock_guard<std::recursive_mutex> lock(m_data->mutex);
+    if (!m_data->bounds_min_set) {
+        calculateBounds();
     }
-    return m_bounds_min;
+    return m_data->bounds_min;
 }
 
 const glm::vec3& Geometry::max() const {
-    if (!m_bounds_max_set) {
-        m_bounds_max_set = true;
-        if (positions().size() > 0) {
-            glm::vec3 m_bounds_max = positions()[0];
-            for (const auto& position : positions()) {
-                m_bounds_max = glm::max(m_bounds_max, position);
+    std::lock_guard<std::recursive_mutex> lock(m_data->mutex);
+    if (!m_data->bounds_max_set) {
+        calculateBounds();
+    }
+    return m_data->bounds_max;
+}
+
+// calculates the bounds of the blocks from first_block to last_block
+static void calculateBlockBounds(const std::vector<glm::vec3>& positions, std::size_t first_block, std::size_t last_block, std::vector<std::array<glm::vec3, 2>>& block_bounds) {
+    Utilities::parallelFor(first_block, last_block, [&positions, &block_bounds](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) {
+            auto first = positions.begin() + i * bounds_block_size;
+            auto last = positions.begin() + std::min<std::size_t>(positions.size(), (i + 1) * bounds_block_size);
+            std::array<glm::vec3, 2> bounds = {{*first, *first}};
+            for (auto position = first; position != last; ++position) {
+                bounds[0] = glm::min(bounds[0], *position);
+                bounds[1] = glm::max(bounds[1], *position);
             }
-        } else {
-            // origin as fallback
-            m_bounds_max = glm::vec3(0, 0, 0);
+            block_bounds[i] = bounds;
         }
+    }, 1);
+}
+
+void Geometry::calculateBounds() const {
+    std::lock_guard<std::recursive_mutex> lock(m_data->mutex);
+    const auto& positions = this->positions();
+    const std::size_t num_blocks = (positions.size() + bounds_block_size - 1) / bounds_block_size;
+    if (m_data->block_bounds.size() != num_blocks) {
+        m_data->block_bounds.resize(num_blocks);
+        calculateBlockBounds(positions, 0, num_blocks, m_data->block_bounds);
     }
-    return m_bounds_max;
+    if (num_blocks > 0) {
+        m_data->bounds_min = m_data->block_bounds[0][0];
+        m_data->bounds_max = m_data->block_bounds[0][1];
+        for (const auto& bounds : m_data->block_bounds) {
+            m_data->bounds_min = glm::min(m_data->bounds_min, bounds[0]);
+            m_data->bounds_max = glm::max(m_data->bounds_max, bounds[1]);
+        }
+    } else {
+        // origin as fallback
+        m_data->bounds_min = glm::vec3(0, 0, 0);
+        m_data->bounds_max = glm::vec3(0, 0, 0);
+    }
+    m_data->bounds_min_set = true;
+    m_data->bounds_max_set = true;
 }
 
 const std::vector<std::array<Geometry::index_type, 4>>& Geometry::volumeIndices() const {
-    if (m_volume_indices.empty() && m_positions.size() >= 4 && !is2d()) {
-        // calculate the volume indices using QHull
+    if (m_data->topology) {
+        return topology().volumeIndices();
+    }
+    std::lock_guard<std::recursive_mutex> lock(m_data->mutex);
+    if (m_data->has_volume_indices) {
+        return m_data->volume_indices;
+    }
+    if (hasImplicitVolumeIndices()) {
+        m_data->volume_indices.resize(numVolumeTetrahedra());
+        Utilities::parallelFor(0, m_data->volume_indices.size(), [this](std::size_t begin, std::size_t end) {
+            copyVolumeIndices(begin, end - begin, m_data->volume_indices.data() + begin);
+        });
+    } else if (numPositions() >= 4 && !is2d()) {
+        if (m_data->pending_volume_indices) {
+            // wait for the background calculation, rethrowing its exceptions
+            auto pending_volume_indices = m_data->pending_volume_indices;
+            m_data->pending_volume_indices.reset();
+            m_data->volume_indices_ready.get();
+            if (pending_volume_indices.use_count() == 1) {
+                m_data->volume_indices.swap(*pending_volume_indices);
+            } else {
+                m_data->volume_indices = *pending_volume_indices;
+            }
+        } else {
+            // calculate the volume indices analytically for lattices and
+            // using QHull otherwise
+            m_data->volume_indices = Triangulation::tetrahedra(positions());
+        }
+    }
+    m_data->has_volume_indices = true;
+    return m_data->volume_indices;
+}
 
-#ifdef NO_QHULL
-        std::cerr << "volume indices calculation for arbitrary geometry required QHull" << std::endl;
+std::shared_future<void> Geometry::prepareVolumeIndices() const {
+    if (m_data->topology) {
+        return topology().prepareVolumeIndices();
+    }
+    std::lock_guard<std::recursive_mutex> lock(m_data->mutex);
+    if (m_data->pending_volume_indices) {
+        return m_data->volume_indices_ready;
+    }
+    std::promise<void> promise;
+    std::shared_future<void> ready = promise.get_future().share();
+#ifdef VFRENDERING_NO_THREADS
+    volumeIndices();
+    promise.set_value();
 #else
-        // QHull requires double precision floating point numbers
-        const std::vector<glm::dvec3> dpositions(m_positions.cbegin(), m_positions.cend());
-
-        ::orgQhull::Qhull qhull;
-        qhull.runQhull("", 3, dpositions.size(), &(dpositions[0].x), "qhull d Qt Qbb Qz");
-
-        // copy results
-        for (auto facet : qhull.facetList()) {
-            if (!facet.isUpperDelaunay()) {
-                std::array<Geometry::index_type, 4> tetrahedron;
-                auto vertices = facet.vertices();
-                for (int i = 0; i < 4; i++) {
-                    tetrahedron[i] = vertices[i].point().id();
-                }
-                m_volume_indices.push_back(tetrahedron);
-            }
+    if (hasImplicitVolumeIndices() || m_data->has_volume_indices || numPositions() < 4 || is2d()) {
+        // nothing to calculate, or generating the indices is fast anyway
+        promise.set_value();
+        return ready;
+    }
+    // The task holds the data of this geometry, so that destroying the
+    // geometry does not have to wait for it. The positions of implicit
+    // geometries are generated here, under the lock, as the task reads them
+    // without it. Once generated, they never change.
+    positions();
+    auto data = m_data;
+    auto pending_volume_indices = std::make_shared<std::vector<std::array<index_type, 4>>>();
+    auto shared_promise = std::make_shared<std::promise<void>>(std::move(promise));
+    Utilities::runInBackground([data, pending_volume_indices, shared_promise]() mutable {
+        try {
+            *pending_volume_indices = Triangulation::tetrahedra(data->positions);
+            // only volumeIndices() may still use the indices, so that it can
+            // take them without copying
+            data.reset();
+            pending_volume_indices.reset();
+            shared_promise->set_value();
+        } catch (...) {
+            shared_promise->set_exception(std::current_exception());
         }
+    });
+    m_data->pending_volume_indices = pending_volume_indices;
+    m_data->volume_indices_ready = ready;
 #endif
-    }
-    return m_volume_indices;
+    return ready;
 }
 
 Geometry Geometry::cartesianGeometry(glm::ivec3 n, glm::vec3 bounds_min, glm::vec3 bounds_max) {
@@ -95,10 +242,10 @@ Geometry Geometry::cartesianGeometry(glm::ivec3 n, glm::vec3 bounds_min, glm::ve
     for (int i = 0; i < n.x; i++) {
         xs[i] = i / (n.x - 1.0) * (bounds_max.x - bounds_min.x) + bounds_min.x;
     }
-    for (int i = 0; i < n.x; i++) {
+    for (int i = 0; i < n.y; i++) {
         ys[i] = i / (n.y - 1.0) * (bounds_max.y - bounds_min.y) + bounds_min.y;
     }
-    for (int i = 0; i < n.x; i++) {
+    for (int i = 0; i < n.z; i++) {
         zs[i] = i / (n.z - 1.0) * (bounds_max.z - bounds_min.z) + bounds_min.z;
     }
     return Geometry::rectilinearGeometry(xs, ys, zs);
@@ -111,179 +258,448 @@ Geometry Geometry::rectilinearGeometry(const std::vector<float>& xs, const std::
         return Geometry({}, {}, {}, false);
     }
 
-    bool is_2d = (n.x == 1 || n.y == 1 || n.z == 1);
+    Geometry result;
+    result.m_data->is_implicit = true;
+    result.m_data->xs = xs;
+    result.m_data->ys = ys;
+    result.m_data->zs = zs;
+    result.m_data->is_2d = (n.x == 1 || n.y == 1 || n.z == 1);
+    result.m_data->bounds_min = {xs[0], ys[0], zs[0]};
+    result.m_data->bounds_min_set = true;
+    result.m_data->bounds_max = {xs[n.x - 1], ys[n.y - 1], zs[n.z - 1]};
+    result.m_data->bounds_max_set = true;
+    return result;
+}
 
-    // TODO: allow different offsets
-    Geometry::index_type x_offset = 1;
-    Geometry::index_type y_offset = n.x;
-    Geometry::index_type z_offset = n.x * n.y;
+Geometry Geometry::bravaisLatticeGeometry(const std::array<glm::vec3, 3>& basis_vectors, const std::vector<glm::vec3>& cell_atoms, glm::ivec3 n_cells) {
+    if (cell_atoms.empty() || n_cells.x < 1 || n_cells.y < 1 || n_cells.z < 1) {
+        return Geometry({}, {}, {}, false);
+    }
 
-    std::vector<glm::vec3> positions;
-    positions.reserve(n.x * n.y * n.z);
-    for (int iz = 0; iz < n.z; iz++) {
-        for (int iy = 0; iy < n.y; iy++) {
-            for (int ix = 0; ix < n.x; ix++) {
-                positions.push_back({xs[ix], ys[iy], zs[iz]});
+    Geometry result;
+    result.m_data->is_implicit = true;
+    result.m_data->lattice = std::make_shared<BravaisLattice>(basis_vectors, cell_atoms, n_cells);
+
+    // the lattice is 2d if the directions it extends in span a plane at most
+    std::vector<glm::vec3> directions;
+    for (int i = 0; i < 3; i++) {
+        if (n_cells[i] > 1) {
+            directions.push_back(basis_vectors[i]);
+        }
+    }
+    for (const auto& cell_atom : cell_atoms) {
+        directions.push_back(cell_atom - cell_atoms[0]);
+    }
+    float max_length = 0;
+    for (const auto& direction : directions) {
+        max_length = std::max(max_length, glm::length(direction));
+    }
+    result.m_data->is_2d = true;
+    for (std::size_t i = 0; i < directions.size() && result.m_data->is_2d; i++) {
+        for (std::size_t j = i + 1; j < directions.size() && result.m_data->is_2d; j++) {
+            for (std::size_t k = j + 1; k < directions.size() && result.m_data->is_2d; k++) {
+                float volume = std::abs(glm::dot(directions[i], glm::cross(directions[j], directions[k])));
+                if (volume > 1e-5f * max_length * max_length * max_length) {
+                    result.m_data->is_2d = false;
+                }
             }
         }
     }
 
-    std::vector<std::array<Geometry::index_type, 3>> surface_indices;
-    if (is_2d) {
-        Geometry::index_type offsets[] = {
-            0, x_offset, y_offset, y_offset, x_offset, x_offset + y_offset
-        };
-        for (int ix = 0; ix < n.x - 1; ix++) {
-            for (int iy = 0; iy < n.y - 1; iy++) {
-                Geometry::index_type base_index = ix * x_offset + iy * y_offset;
-                std::array<Geometry::index_type, 3> left_triangle = {
-                    {base_index + offsets[0], base_index + offsets[1], base_index + offsets[2]}
-                };
-                surface_indices.push_back(left_triangle);
-                std::array<Geometry::index_type, 3> right_triangle = {
-                    {base_index + offsets[3], base_index + offsets[4], base_index + offsets[5]}
-                };
-                surface_indices.push_back(right_triangle);
-            }
+    // the bounds are reached by the atoms of the corner cells
+    glm::vec3 last_cell = glm::vec3(n_cells - 1);
+    result.m_data->bounds_min = cell_atoms[0];
+    result.m_data->bounds_max = cell_atoms[0];
+    for (int corner = 0; corner < 8; corner++) {
+        glm::vec3 cell_offset = basis_vectors[0] * ((corner & 1) ? last_cell.x : 0.0f) + basis_vectors[1] * ((corner & 2) ? last_cell.y : 0.0f) + basis_vectors[2] * ((corner & 4) ? last_cell.z : 0.0f);
+        for (const auto& cell_atom : cell_atoms) {
+            result.m_data->bounds_min = glm::min(result.m_data->bounds_min, cell_atom + cell_offset);
+            result.m_data->bounds_max = glm::max(result.m_data->bounds_max, cell_atom + cell_offset);
         }
+    }
+    result.m_data->bounds_min_set = true;
+    result.m_data->bounds_max_set = true;
+    return result;
+}
+
+std::uint64_t Geometry::contentHash() const {
+    std::lock_guard<std::recursive_mutex> lock(m_data->mutex);
+    if (m_data->content_hash_set) {
+        return m_data->content_hash;
+    }
+    const Data& data = *m_data;
+    std::uint64_t hash = Utilities::hash(&data.is_2d, sizeof(data.is_2d), data.is_implicit ? 1 : 0);
+    if (data.lattice) {
+        // lattices are defined by their basis vectors, atoms and size
+        const auto& basis_vectors = data.lattice->basisVectors();
+        const auto& cell_atoms = data.lattice->cellAtoms();
+        const auto& num_cells = data.lattice->numCells();
+        hash = Utilities::hash(basis_vectors.data(), sizeof(basis_vectors), hash);
+        hash = Utilities::hash(cell_atoms.data(), cell_atoms.size() * sizeof(glm::vec3), hash);
+        hash = Utilities::hash(&num_cells, sizeof(num_cells), hash);
+    } else if (data.is_implicit) {
+        hash = Utilities::hash(data.xs.data(), data.xs.size() * sizeof(float), hash);
+        hash = Utilities::hash(data.ys.data(), data.ys.size() * sizeof(float), hash ^ data.xs.size());
+        hash = Utilities::hash(data.zs.data(), data.zs.size() * sizeof(float), hash ^ data.ys.size());
+    } else if (data.topology) {
+        hash = Utilities::hash(data.positions.data(), data.positions.size() * sizeof(glm::vec3), topology().contentHash());
     } else {
-        // bottom and top
-        {
-            Geometry::index_type offsets[] = {
-                0, x_offset, y_offset, y_offset, x_offset, x_offset + y_offset
-            };
-            for (int ix = 0; ix < n.x - 1; ix++) {
-                for (int iy = 0; iy < n.y - 1; iy++) {
-                    Geometry::index_type base_index = ix * x_offset + iy * y_offset;
-                    std::array<Geometry::index_type, 3> left_triangle = {
-                        {base_index + offsets[0], base_index + offsets[1], base_index + offsets[2]}
-                    };
-                    surface_indices.push_back(left_triangle);
-                    std::array<Geometry::index_type, 3> right_triangle = {
-                        {base_index + offsets[3], base_index + offsets[4], base_index + offsets[5]}
-                    };
-                    surface_indices.push_back(right_triangle);
-                }
-            }
-            for (int ix = 0; ix < n.x - 1; ix++) {
-                for (int iy = 0; iy < n.y - 1; iy++) {
-                    Geometry::index_type base_index = ix * x_offset + iy * y_offset + (n.z - 1) * z_offset;
-                    std::array<Geometry::index_type, 3> left_triangle = {
-                        {base_index + offsets[0], base_index + offsets[1], base_index + offsets[2]}
-                    };
-                    surface_indices.push_back(left_triangle);
-                    std::array<Geometry::index_type, 3> right_triangle = {
-                        {base_index + offsets[3], base_index + offsets[4], base_index + offsets[5]}
-                    };
-                    surface_indices.push_back(right_triangle);
-                }
-            }
+        hash = Utilities::hash(data.positions.data(), data.positions.size() * sizeof(glm::vec3), hash);
+        if (data.has_given_surface_indices) {
+            hash = Utilities::hash(data.surface_indices.data(), data.surface_indices.size() * sizeof(data.surface_indices[0]), hash ^ 3);
         }
-        // front and back
-        {
-            Geometry::index_type offsets[] = {
-                0, x_offset, z_offset, z_offset, x_offset, x_offset + z_offset
-            };
-            for (int ix = 0; ix < n.x - 1; ix++) {
-                for (int iz = 0; iz < n.z - 1; iz++) {
-                    Geometry::index_type base_index = ix * x_offset + iz * z_offset;
-                    std::array<Geometry::index_type, 3> left_triangle = {
-                        {base_index + offsets[0], base_index + offsets[1], base_index + offsets[2]}
-                    };
-                    surface_indices.push_back(left_triangle);
-                    std::array<Geometry::index_type, 3> right_triangle = {
-                        {base_index + offsets[3], base_index + offsets[4], base_index + offsets[5]}
-                    };
-                    surface_indices.push_back(right_triangle);
-                }
-            }
-            for (int ix = 0; ix < n.x - 1; ix++) {
-                for (int iz = 0; iz < n.z - 1; iz++) {
-                    Geometry::index_type base_index = ix * x_offset + (n.y - 1) * y_offset + iz * z_offset;
-                    std::array<Geometry::index_type, 3> left_triangle = {
-                        {base_index + offsets[0], base_index + offsets[1], base_index + offsets[2]}
-                    };
-                    surface_indices.push_back(left_triangle);
-                    std::array<Geometry::index_type, 3> right_triangle = {
-                        {base_index + offsets[3], base_index + offsets[4], base_index + offsets[5]}
-                    };
-                    surface_indices.push_back(right_triangle);
-                }
-            }
+        if (data.has_given_volume_indices) {
+            hash = Utilities::hash(data.volume_indices.data(), data.volume_indices.size() * sizeof(data.volume_indices[0]), hash ^ 4);
         }
-        // left and right
-        {
-            Geometry::index_type offsets[] = {
-                0, y_offset, z_offset, z_offset, y_offset, y_offset + z_offset
-            };
-            for (int iy = 0; iy < n.y - 1; iy++) {
-                for (int iz = 0; iz < n.z - 1; iz++) {
-                    Geometry::index_type base_index = iy * y_offset + iz * z_offset;
-                    std::array<Geometry::index_type, 3> left_triangle = {
-                        {base_index + offsets[0], base_index + offsets[1], base_index + offsets[2]}
-                    };
-                    surface_indices.push_back(left_triangle);
-                    std::array<Geometry::index_type, 3> right_triangle = {
-                        {base_index + offsets[3], base_index + offsets[4], base_index + offsets[5]}
-                    };
-                    surface_indices.push_back(right_triangle);
-                }
+    }
+    m_data->content_hash = hash;
+    m_data->content_hash_set = true;
+    return hash;
+}
+
+template<typename T>
+static bool sameBytes(const std::vector<T>& a, const std::vector<T>& b) {
+    return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+}
+
+bool Geometry::operator==(const Geometry& other) const {
+    if (m_data == other.m_data) {
+        return true;
+    }
+    if (contentHash() != other.contentHash()) {
+        return false;
+    }
+    Data& a = *m_data;
+    Data& b = *other.m_data;
+    std::lock(a.mutex, b.mutex);
+    std::lock_guard<std::recursive_mutex> lock_a(a.mutex, std::adopt_lock);
+    std::lock_guard<std::recursive_mutex> lock_b(b.mutex, std::adopt_lock);
+    if (a.is_implicit != b.is_implicit || a.is_2d != b.is_2d || bool(a.lattice) != bool(b.lattice) || bool(a.topology) != bool(b.topology)) {
+        return false;
+    }
+    if (a.topology) {
+        return topology() == other.topology() && sameBytes(a.positions, b.positions);
+    }
+    if (a.lattice) {
+        return a.lattice->basisVectors() == b.lattice->basisVectors() && sameBytes(a.lattice->cellAtoms(), b.lattice->cellAtoms()) && a.lattice->numCells() == b.lattice->numCells();
+    }
+    if (a.is_implicit) {
+        return sameBytes(a.xs, b.xs) && sameBytes(a.ys, b.ys) && sameBytes(a.zs, b.zs);
+    }
+    if (a.has_given_surface_indices != b.has_given_surface_indices || a.has_given_volume_indices != b.has_given_volume_indices) {
+        return false;
+    }
+    return sameBytes(a.positions, b.positions) && (!a.has_given_surface_indices || sameBytes(a.surface_indices, b.surface_indices)) && (!a.has_given_volume_indices || sameBytes(a.volume_indices, b.volume_indices));
+}
+
+bool Geometry::operator!=(const Geometry& other) const {
+    return !(*this == other);
+}
+
+Geometry Geometry::shared(const Geometry& geometry) {
+    static std::mutex registry_mutex;
+    static std::unordered_multimap<std::uint64_t, std::weak_ptr<Data>> registry;
+
+    // number of entries after the last purge of the whole registry
+    static std::size_t purged_registry_size = 0;
+
+    std::uint64_t hash = geometry.contentHash();
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    // expired entries with other hashes are only purged once the registry
+    // has doubled in size, so that sharing does not scan all of them
+    if (registry.size() >= 2 * std::max<std::size_t>(purged_registry_size, 16)) {
+        for (auto it = registry.begin(); it != registry.end();) {
+            if (it->second.expired()) {
+                it = registry.erase(it);
+            } else {
+                ++it;
             }
-            for (int iy = 0; iy < n.y - 1; iy++) {
-                for (int iz = 0; iz < n.z - 1; iz++) {
-                    Geometry::index_type base_index = (n.x - 1) * x_offset + iy * y_offset + iz * z_offset;
-                    std::array<Geometry::index_type, 3> left_triangle = {
-                        {base_index + offsets[0], base_index + offsets[1], base_index + offsets[2]}
-                    };
-                    surface_indices.push_back(left_triangle);
-                    std::array<Geometry::index_type, 3> right_triangle = {
-                        {base_index + offsets[3], base_index + offsets[4], base_index + offsets[5]}
-                    };
-                    surface_indices.push_back(right_triangle);
-                }
+        }
+        purged_registry_size = registry.size();
+    }
+    auto range = registry.equal_range(hash);
+    for (auto it = range.first; it != range.second;) {
+        Geometry registered;
+        registered.m_data = it->second.lock();
+        if (!registered.m_data) {
+            it = registry.erase(it);
+        } else if (registered == geometry) {
+            return registered;
+        } else {
+            ++it;
+        }
+    }
+    registry.emplace(hash, geometry.m_data);
+    return geometry;
+}
+
+Geometry Geometry::withPositions(const std::vector<glm::vec3>& positions) const {
+    if (positions.size() != numPositions()) {
+        return Geometry(positions, {}, {}, is2d());
+    }
+    return withPositions(0, positions.size(), positions.data());
+}
+
+Geometry Geometry::withPositions(index_type first, index_type count, const glm::vec3* positions) const {
+    const index_type num_positions = numPositions();
+    first = std::min(first, num_positions);
+    count = std::min(count, num_positions - first);
+    Geometry result;
+    Data& data = *result.m_data;
+    data.topology = topology().m_data;
+    data.is_2d = is2d();
+    data.positions.resize(num_positions);
+    Utilities::parallelFor(0, num_positions, [this, &data](std::size_t begin, std::size_t end) {
+        copyPositions(begin, end - begin, data.positions.data() + begin);
+    });
+    std::copy(positions, positions + count, data.positions.begin() + first);
+    // keep the bounds of unchanged blocks, so that only those of the changed
+    // ones need to be calculated
+    const std::size_t num_blocks = (num_positions + bounds_block_size - 1) / bounds_block_size;
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_data->mutex);
+        if (m_data->block_bounds.size() == num_blocks) {
+            data.block_bounds = m_data->block_bounds;
+        }
+    }
+    if (data.block_bounds.size() == num_blocks && count > 0) {
+        calculateBlockBounds(data.positions, first / bounds_block_size, (first + count - 1) / bounds_block_size + 1, data.block_bounds);
+    }
+    result.calculateBounds();
+    return result;
+}
+
+bool Geometry::hasSameTopology(const Geometry& other) const {
+    return topology().m_data == other.topology().m_data;
+}
+
+Geometry Geometry::topology() const {
+    Geometry result;
+    if (m_data->topology) {
+        result.m_data = m_data->topology;
+    } else {
+        result.m_data = m_data;
+    }
+    return result;
+}
+
+bool Geometry::isImplicit() const {
+    return m_data->is_implicit;
+}
+
+bool Geometry::hasImplicitSurfaceIndices() const {
+    if (!m_data->is_implicit) {
+        return false;
+    }
+    if (!m_data->lattice) {
+        return true;
+    }
+    // single-atom lattices are topologically equal to rectilinear grids,
+    // other lattices use the boundary of their tetrahedralization
+    return m_data->lattice->cellAtoms().size() == 1 && (!m_data->is_2d || m_data->lattice->numCells().z == 1);
+}
+
+bool Geometry::hasImplicitVolumeIndices() const {
+    if (!m_data->is_implicit) {
+        return false;
+    }
+    return !m_data->lattice || m_data->is_2d || m_data->lattice->hasCellTetrahedra();
+}
+
+glm::ivec3 Geometry::gridSize() const {
+    if (m_data->lattice) {
+        return m_data->lattice->numCells();
+    }
+    return glm::ivec3(m_data->xs.size(), m_data->ys.size(), m_data->zs.size());
+}
+
+Geometry::index_type Geometry::numPositions() const {
+    if (m_data->lattice) {
+        return m_data->lattice->numPositions();
+    }
+    if (m_data->is_implicit) {
+        return m_data->xs.size() * m_data->ys.size() * m_data->zs.size();
+    }
+    return m_data->positions.size();
+}
+
+glm::vec3 Geometry::position(index_type index) const {
+    if (m_data->lattice) {
+        return m_data->lattice->position(index);
+    }
+    if (m_data->is_implicit) {
+        index_type nx = m_data->xs.size();
+        index_type ny = m_data->ys.size();
+        return {m_data->xs[index % nx], m_data->ys[(index / nx) % ny], m_data->zs[index / nx / ny]};
+    }
+    return m_data->positions[index];
+}
+
+void Geometry::copyPositions(index_type first, index_type count, glm::vec3* destination) const {
+    if (!m_data->is_implicit) {
+        std::copy(m_data->positions.begin() + first, m_data->positions.begin() + first + count, destination);
+        return;
+    }
+    if (m_data->lattice) {
+        m_data->lattice->copyPositions(first, count, destination);
+        return;
+    }
+    index_type nx = m_data->xs.size();
+    index_type ny = m_data->ys.size();
+    index_type ix = first % nx;
+    index_type iy = (first / nx) % ny;
+    index_type iz = first / nx / ny;
+    for (index_type i = 0; i < count; i++) {
+        destination[i] = {m_data->xs[ix], m_data->ys[iy], m_data->zs[iz]};
+        ix++;
+        if (ix == nx) {
+            ix = 0;
+            iy++;
+            if (iy == ny) {
+                iy = 0;
+                iz++;
             }
         }
     }
+}
 
-    std::vector<std::array<Geometry::index_type, 4>> volume_indices;
+namespace {
+// A boundary face of a rectilinear grid, triangulated with two triangles per
+// quad. The quads are enumerated with the outer axis as the slower index.
+struct GridFace {
+    Geometry::index_type base_index;
+    Geometry::index_type outer_offset;
+    Geometry::index_type inner_offset;
+    Geometry::index_type num_outer;
+    Geometry::index_type num_inner;
+};
+}
+
+static std::vector<GridFace> gridFaces(const glm::ivec3& n, bool is_2d) {
+    Geometry::index_type x_offset = 1;
+    Geometry::index_type y_offset = n.x;
+    Geometry::index_type z_offset = n.x * n.y;
+    Geometry::index_type cx = n.x - 1;
+    Geometry::index_type cy = n.y - 1;
+    Geometry::index_type cz = n.z - 1;
     if (is_2d) {
-        // 2d geometry has no volume, so volume_indices should be empty
-    } else {
-        int cell_indices[] = {
-            0, 1, 5, 3,
-            1, 3, 2, 5,
-            3, 2, 5, 6,
-            7, 6, 5, 3,
-            4, 7, 5, 3,
-            0, 4, 3, 5
+        return {
+            {0, x_offset, y_offset, cx, cy}
         };
+    }
+    return {
+        // bottom and top
+        {0, x_offset, y_offset, cx, cy},
+        {cz * z_offset, x_offset, y_offset, cx, cy},
+        // front and back
+        {0, x_offset, z_offset, cx, cz},
+        {cy * y_offset, x_offset, z_offset, cx, cz},
+        // left and right
+        {0, y_offset, z_offset, cy, cz},
+        {cx * x_offset, y_offset, z_offset, cy, cz}
+    };
+}
 
-        Geometry::index_type offsets[] = {
-            0, x_offset, x_offset + y_offset, y_offset,
-            z_offset, x_offset + z_offset, x_offset + y_offset + z_offset, y_offset + z_offset
-        };
+Geometry::index_type Geometry::numSurfaceTriangles() const {
+    if (m_data->topology) {
+        return topology().numSurfaceTriangles();
+    }
+    if (!hasImplicitSurfaceIndices()) {
+        return surfaceIndices().size();
+    }
+    glm::ivec3 n = gridSize();
+    index_type num_triangles = 0;
+    for (const auto& face : gridFaces(n, m_data->is_2d)) {
+        num_triangles += 2 * face.num_outer * face.num_inner;
+    }
+    return num_triangles;
+}
 
-        for (int ix = 0; ix < n.x - 1; ix++) {
-            for (int iy = 0; iy < n.y - 1; iy++) {
-                for (int iz = 0; iz < n.z - 1; iz++) {
-                    Geometry::index_type base_index = ix * x_offset + iy * y_offset + iz * z_offset;
-                    for (int j = 0; j < 6; j++) {
-                        std::array<Geometry::index_type, 4> tetrahedron;
-                        for (int k = 0; k < 4; k++) {
-                            Geometry::index_type index = base_index + offsets[cell_indices[j * 4 + k]];
-                            tetrahedron[k] = index;
-                        }
-                        volume_indices.push_back(tetrahedron);
-                    }
-                }
+void Geometry::copySurfaceIndices(index_type first, index_type count, std::array<index_type, 3>* destination) const {
+    if (m_data->topology) {
+        topology().copySurfaceIndices(first, count, destination);
+        return;
+    }
+    if (!hasImplicitSurfaceIndices()) {
+        const auto& surface_indices = surfaceIndices();
+        std::copy(surface_indices.begin() + first, surface_indices.begin() + first + count, destination);
+        return;
+    }
+    glm::ivec3 n = gridSize();
+    index_type face_first = 0;
+    for (const auto& face : gridFaces(n, m_data->is_2d)) {
+        index_type face_count = 2 * face.num_outer * face.num_inner;
+        for (index_type i = std::max(first, face_first); i < std::min(first + count, face_first + face_count); i++) {
+            index_type quad = (i - face_first) / 2;
+            index_type base_index = face.base_index + (quad / face.num_inner) * face.outer_offset + (quad % face.num_inner) * face.inner_offset;
+            if ((i - face_first) % 2 == 0) {
+                destination[i - first] = {{base_index, base_index + face.outer_offset, base_index + face.inner_offset}};
+            } else {
+                destination[i - first] = {{base_index + face.inner_offset, base_index + face.outer_offset, base_index + face.outer_offset + face.inner_offset}};
             }
         }
+        face_first += face_count;
+    }
+}
+
+Geometry::index_type Geometry::numVolumeTetrahedra() const {
+    if (m_data->topology) {
+        return topology().numVolumeTetrahedra();
+    }
+    if (!hasImplicitVolumeIndices()) {
+        return volumeIndices().size();
+    }
+    if (m_data->is_2d) {
+        // 2d geometry has no volume
+        return 0;
+    }
+    if (m_data->lattice) {
+        return m_data->lattice->numTetrahedra();
+    }
+    return 6 * (m_data->xs.size() - 1) * (m_data->ys.size() - 1) * (m_data->zs.size() - 1);
+}
+
+void Geometry::copyVolumeIndices(index_type first, index_type count, std::array<index_type, 4>* destination) const {
+    if (m_data->topology) {
+        topology().copyVolumeIndices(first, count, destination);
+        return;
+    }
+    if (!hasImplicitVolumeIndices()) {
+        const auto& volume_indices = volumeIndices();
+        std::copy(volume_indices.begin() + first, volume_indices.begin() + first + count, destination);
+        return;
+    }
+    if (m_data->lattice) {
+        m_data->lattice->copyTetrahedra(first, count, destination);
+        return;
+    }
+    static const int cell_indices[] = {
+        0, 1, 5, 3,
+        1, 3, 2, 5,
+        3, 2, 5, 6,
+        7, 6, 5, 3,
+        4, 7, 5, 3,
+        0, 4, 3, 5
+    };
+
+    index_type x_offset = 1;
+    index_type y_offset = m_data->xs.size();
+    index_type z_offset = m_data->xs.size() * m_data->ys.size();
+    const index_type offsets[] = {
+        0, x_offset, x_offset + y_offset, y_offset,
+        z_offset, x_offset + z_offset, x_offset + y_offset + z_offset, y_offset + z_offset
+    };
+
+    // cells are enumerated with x as the slowest and z as the fastest index
+    index_type cy = m_data->ys.size() - 1;
+    index_type cz = m_data->zs.size() - 1;
+    for (index_type i = 0; i < count; i++) {
+        index_type cell = (first + i) / 6;
+        int j = (first + i) % 6;
+        index_type base_index = (cell / cz / cy) * x_offset + ((cell / cz) % cy) * y_offset + (cell % cz) * z_offset;
+        for (int k = 0; k < 4; k++) {
+            destination[i][k] = base_index + offsets[cell_indices[j * 4 + k]];
+        }
     }
-    Geometry result = Geometry(positions, surface_indices, volume_indices, is_2d);
-    result.m_bounds_min = {xs[0], ys[0], zs[0]};
-    result.m_bounds_min_set = true;
-    result.m_bounds_max = {xs[n.x - 1], ys[n.y - 1], zs[n.z - 1]};
-    result.m_bounds_max_set = true;
-    return result;
 }
 }
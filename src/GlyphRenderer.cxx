@@ -10,6 +10,7 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include "VFRendering/Utilities.hxx"
+#include "GpuBuffer.hxx"
 
 #include "shaders/glyphs.vert.glsl.hxx"
 #include "shaders/glyphs.frag.glsl.hxx"
@@ -25,31 +26,26 @@ void GlyphRenderer::initialize() {
 
     glGenVertexArrays(1, &m_vao);
     glBindVertexArray(m_vao);
-    glGenBuffers(1, &m_position_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, m_position_vbo);
+    m_position_vbo.reset(new Utilities::GpuBuffer(GL_ARRAY_BUFFER));
+    m_position_vbo->bind();
     glVertexAttribPointer(0, 3, GL_FLOAT, false, 0, nullptr);
     glEnableVertexAttribArray(0);
     glVertexAttribDivisor(0, 0);
 
-    glGenBuffers(1, &m_normal_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, m_normal_vbo);
+    m_normal_vbo.reset(new Utilities::GpuBuffer(GL_ARRAY_BUFFER));
+    m_normal_vbo->bind();
     glVertexAttribPointer(1, 3, GL_FLOAT, false, 0, nullptr);
     glEnableVertexAttribArray(1);
     glVertexAttribDivisor(1, 0);
 
-    glGenBuffers(1, &m_ibo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ibo);
+    m_ibo.reset(new Utilities::GpuBuffer(GL_ELEMENT_ARRAY_BUFFER));
+    m_ibo->bind();
     m_num_indices = 0;
 
-    glGenBuffers(1, &m_instance_position_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, m_instance_position_vbo);
-    glVertexAttribPointer(2, 3, GL_FLOAT, false, 0, nullptr);
+    // the instance positions and directions are bound in update
     glEnableVertexAttribArray(2);
     glVertexAttribDivisor(2, 1);
 
-    glGenBuffers(1, &m_instance_direction_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, m_instance_direction_vbo);
-    glVertexAttribPointer(3, 3, GL_FLOAT, false, 0, nullptr);
     glEnableVertexAttribArray(3);
     glVertexAttribDivisor(3, 1);
 
@@ -59,6 +55,7 @@ void GlyphRenderer::initialize() {
         setGlyph(m_positions, m_normals, m_indices);
     }
     update(false);
+    updateChannels();
 }
 
 GlyphRenderer::~GlyphRenderer() {
@@ -66,12 +63,7 @@ GlyphRenderer::~GlyphRenderer() {
         return;
     }
     glDeleteVertexArrays(1, &m_vao);
-    glDeleteBuffers(1, &m_position_vbo);
-    glDeleteBuffers(1, &m_normal_vbo);
-    glDeleteBuffers(1, &m_ibo);
-    glDeleteBuffers(1, &m_instance_position_vbo);
-    glDeleteBuffers(1, &m_instance_direction_vbo);
-    glDeleteProgram(m_program);
+    Utilities::releaseProgram(m_view, m_program);
 }
 
 void GlyphRenderer::optionsHaveChanged(const std::vector<int>& changed_options) {
@@ -93,19 +85,33 @@ void GlyphRenderer::optionsHaveChanged(const std::vector<int>& changed_options)
     }
 }
 
+std::size_t GlyphRenderer::gpuMemoryUsage() const {
+    std::size_t memory_usage = VectorFieldRenderer::gpuMemoryUsage();
+    if (m_is_initialized) {
+        memory_usage += m_position_vbo->capacity() + m_normal_vbo->capacity() + m_ibo->capacity();
+    }
+    return memory_usage;
+}
+
 void GlyphRenderer::update(bool keep_geometry) {
     if (!m_is_initialized) {
         return;
     }
     glBindVertexArray(m_vao);
     if (!keep_geometry) {
-        glBindBuffer(GL_ARRAY_BUFFER, m_instance_position_vbo);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * positions().size(), positions().data(), GL_STREAM_DRAW);
+        bindPositionData(2);
     }
-    glBindBuffer(GL_ARRAY_BUFFER, m_instance_direction_vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * directions().size(), directions().data(), GL_STREAM_DRAW);
+    bindDirectionData(3);
 
-    m_num_instances = std::min(positions().size(), directions().size());
+    m_num_instances = std::min<std::size_t>(geometry().numPositions(), numDirections());
+}
+
+void GlyphRenderer::updatePositions() {
+    if (!m_is_initialized) {
+        return;
+    }
+    glBindVertexArray(m_vao);
+    bindPositionData(2);
 }
 
 void GlyphRenderer::draw(float aspect_ratio) {
@@ -116,15 +122,9 @@ void GlyphRenderer::draw(float aspect_ratio) {
     glBindVertexArray(m_vao);
     glUseProgram(m_program);
 
-    auto matrices = Utilities::getMatrices(options(), aspect_ratio);
-    auto model_view_matrix = matrices.first;
-    auto projection_matrix = matrices.second;
-    glm::vec3 camera_position = options().get<View::Option::CAMERA_POSITION>();
-    glm::vec4 light_position = model_view_matrix * glm::vec4(camera_position, 1.0);
-
-    glUniformMatrix4fv(glGetUniformLocation(m_program, "uProjectionMatrix"), 1, false, glm::value_ptr(projection_matrix));
-    glUniformMatrix4fv(glGetUniformLocation(m_program, "uModelviewMatrix"), 1, false, glm::value_ptr(model_view_matrix));
-    glUniform3f(glGetUniformLocation(m_program, "uLightPosition"), light_position[0], light_position[1], light_position[2]);
+    useCamera(m_program, aspect_ratio);
+    setColormapUniforms();
+    setDecodingUniforms();
 
     glDisable(GL_CULL_FACE);
     glDrawElementsInstanced(GL_TRIANGLES, m_num_indices, GL_UNSIGNED_SHORT, nullptr, m_num_instances);
@@ -136,7 +136,8 @@ void GlyphRenderer::updateShaderProgram() {
         return;
     }
     if (m_program) {
-        glDeleteProgram(m_program);
+        Utilities::releaseProgram(m_view, m_program);
+        m_program = 0;
     }
     std::string vertex_shader_source;
     if (options().get<GlyphRenderer::Option::ROTATE_GLYPHS>()) {
@@ -144,10 +145,27 @@ void GlyphRenderer::updateShaderProgram() {
     } else {
         vertex_shader_source = GLYPHS_UNROTATED_VERT_GLSL;
     }
+    vertex_shader_source += channelsImplementation(ChannelSource::ATTRIBUTES);
     vertex_shader_source += options().get<View::Option::COLORMAP_IMPLEMENTATION>();
     vertex_shader_source += options().get<View::Option::IS_VISIBLE_IMPLEMENTATION>();
+    vertex_shader_source += directionDecodingImplementation();
+    vertex_shader_source += positionDecodingImplementation();
     std::string fragment_shader_source = GLYPHS_FRAG_GLSL;
-    m_program = Utilities::createProgram(vertex_shader_source, fragment_shader_source, {"ivPosition", "ivNormal", "ivInstanceOffset", "ivInstanceDirection"});
+    std::vector<std::string> attributes = {"ivPosition", "ivNormal", "ivInstanceOffset", "ivInstanceDirection"};
+    for (const auto& attribute : channelAttributes()) {
+        attributes.push_back(attribute);
+    }
+    m_program = Utilities::createProgram(m_view, vertex_shader_source, fragment_shader_source, attributes);
+    resolveColormapUniforms(m_program);
+    resolveDecodingUniforms(m_program);
+}
+
+void GlyphRenderer::updateChannels() {
+    if (!m_is_initialized) {
+        return;
+    }
+    glBindVertexArray(m_vao);
+    bindChannelData(4, 1);
 }
 
 void GlyphRenderer::setGlyph(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals, const std::vector<std::uint16_t>& indices) {
@@ -158,12 +176,9 @@ void GlyphRenderer::setGlyph(const std::vector<glm::vec3>& positions, const std:
         return;
     }
     glBindVertexArray(m_vao);
-    glBindBuffer(GL_ARRAY_BUFFER, m_position_vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * positions.size(), positions.data(), GL_STATIC_DRAW);
-    glBindBuffer(GL_ARRAY_BUFFER, m_normal_vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * normals.size(), normals.data(), GL_STATIC_DRAW);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ibo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLushort) * indices.size(), indices.data(), GL_STATIC_DRAW);
+    m_position_vbo->upload(positions);
+    m_normal_vbo->upload(normals);
+    m_ibo->upload(indices);
     m_num_indices = indices.size();
 
     // Clear glyph data that might have been stored before OpenGL was ready
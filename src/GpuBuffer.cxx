@@ -0,0 +1,63 @@
+#include "GpuBuffer.hxx"
+
+#include <algorithm>
+
+#ifndef __EMSCRIPTEN__
+#include <glad/glad.h>
+#else
+#include <GLES3/gl3.h>
+#endif
+
+namespace VFRendering {
+namespace Utilities {
+GpuBuffer::GpuBuffer(unsigned int target) : m_target(target) {
+    glGenBuffers(1, &m_buffer);
+}
+
+GpuBuffer::~GpuBuffer() {
+    glDeleteBuffers(1, &m_buffer);
+}
+
+void GpuBuffer::bind() const {
+    glBindBuffer(m_target, m_buffer);
+}
+
+void GpuBuffer::upload(const void* data, std::size_t size) {
+    resize(size);
+    if (size > 0) {
+        update(0, size, data);
+    }
+}
+
+void GpuBuffer::resize(std::size_t size) {
+    bind();
+    // storage that is much larger than needed is released again, so that a
+    // single large upload does not waste memory for the buffer's lifetime
+    if (size > m_capacity || size < m_capacity / 4) {
+        std::size_t capacity = size;
+        if (size > m_capacity) {
+            capacity = std::max(size, m_capacity + m_capacity / 2);
+        }
+        glBufferData(m_target, capacity, nullptr, GL_DYNAMIC_DRAW);
+        m_capacity = capacity;
+    }
+    m_size = size;
+}
+
+void GpuBuffer::update(std::size_t offset, std::size_t size, const void* data) {
+    glBufferSubData(m_target, offset, size, data);
+}
+
+unsigned int GpuBuffer::id() const {
+    return m_buffer;
+}
+
+std::size_t GpuBuffer::size() const {
+    return m_size;
+}
+
+std::size_t GpuBuffer::capacity() const {
+    return m_capacity;
+}
+}
+}
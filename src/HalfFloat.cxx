@@ -0,0 +1,122 @@
+#include "HalfFloat.hxx"
+
+#include <cstring>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__)) && !defined(__EMSCRIPTEN__)
+#define VFRENDERING_F16C_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace VFRendering {
+namespace Utilities {
+// Portable conversions, rounding to nearest even like the F16C instructions.
+static std::uint16_t floatToHalf(float value) {
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const std::uint32_t sign = bits & 0x80000000u;
+    bits ^= sign;
+    std::uint32_t half;
+    if (bits >= 0x47800000u) {
+        // too large for a half float, infinite or NaN
+        half = (bits > 0x7f800000u) ? 0x7e00 : 0x7c00;
+    } else if (bits < 0x38800000u) {
+        // subnormal half float or zero, let the float addition round
+        const std::uint32_t denormal_magic_bits = 0x3f000000u;
+        float denormal_magic;
+        std::memcpy(&denormal_magic, &denormal_magic_bits, sizeof(denormal_magic));
+        float f;
+        std::memcpy(&f, &bits, sizeof(f));
+        f += denormal_magic;
+        std::memcpy(&bits, &f, sizeof(bits));
+        half = bits - denormal_magic_bits;
+    } else {
+        const std::uint32_t is_mantissa_odd = (bits >> 13) & 1;
+        bits += 0xc8000fffu + is_mantissa_odd;
+        half = bits >> 13;
+    }
+    return static_cast<std::uint16_t>(half | (sign >> 16));
+}
+
+static float halfToFloat(std::uint16_t half) {
+    const std::uint32_t shifted_exponent = 0x7c00u << 13;
+    std::uint32_t bits = (half & 0x7fffu) << 13;
+    const std::uint32_t exponent = bits & shifted_exponent;
+    bits += (127 - 15) << 23;
+    float value;
+    if (exponent == shifted_exponent) {
+        // infinite or NaN
+        bits += (128 - 16) << 23;
+        std::memcpy(&value, &bits, sizeof(value));
+    } else if (exponent == 0) {
+        // subnormal or zero, renormalize with a float subtraction
+        const std::uint32_t magic_bits = 113u << 23;
+        float magic;
+        std::memcpy(&magic, &magic_bits, sizeof(magic));
+        bits += 1 << 23;
+        std::memcpy(&value, &bits, sizeof(value));
+        value -= magic;
+    } else {
+        std::memcpy(&value, &bits, sizeof(value));
+    }
+    std::uint32_t sign = static_cast<std::uint32_t>(half & 0x8000u) << 16;
+    std::memcpy(&bits, &value, sizeof(bits));
+    bits |= sign;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+#ifdef VFRENDERING_F16C_DISPATCH
+// The F16C code paths are compiled for processors supporting the instruction
+// set extension regardless of the compiler flags, and only chosen if the
+// processor running the code supports it.
+static bool hasF16C() {
+    static const bool has_f16c = __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c");
+    return has_f16c;
+}
+
+__attribute__((target("avx,f16c")))
+static std::size_t floatsToHalfsF16C(const float* source, std::size_t count, std::uint16_t* destination) {
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i halfs = _mm256_cvtps_ph(_mm256_loadu_ps(source + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), halfs);
+    }
+    return i;
+}
+
+__attribute__((target("avx,f16c")))
+static std::size_t halfsToFloatsF16C(const std::uint16_t* source, std::size_t count, float* destination) {
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i halfs = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+        _mm256_storeu_ps(destination + i, _mm256_cvtph_ps(halfs));
+    }
+    return i;
+}
+#endif
+
+void floatsToHalfs(const float* source, std::size_t count, std::uint16_t* destination) {
+    std::size_t i = 0;
+#ifdef VFRENDERING_F16C_DISPATCH
+    if (hasF16C()) {
+        i = floatsToHalfsF16C(source, count, destination);
+    }
+#endif
+    for (; i < count; i++) {
+        destination[i] = floatToHalf(source[i]);
+    }
+}
+
+void halfsToFloats(const std::uint16_t* source, std::size_t count, float* destination) {
+    std::size_t i = 0;
+#ifdef VFRENDERING_F16C_DISPATCH
+    if (hasF16C()) {
+        i = halfsToFloatsF16C(source, count, destination);
+    }
+#endif
+    for (; i < count; i++) {
+        destination[i] = halfToFloat(source[i]);
+    }
+}
+}
+}
@@ -0,0 +1,57 @@
+#include "Hash.hxx"
+
+#include <cstring>
+
+namespace VFRendering {
+namespace Utilities {
+static std::uint64_t mix(std::uint64_t x) {
+    // finalizer of the splitmix64 generator
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+std::uint64_t hash(const void* data, std::size_t size, std::uint64_t seed) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    std::uint64_t h = mix(seed ^ (0x9e3779b97f4a7c15ULL * (size + 1)));
+    std::size_t i = 0;
+    // four independent lanes allow the multiplications to overlap
+    std::uint64_t lanes[4] = {h, h + 1, h + 2, h + 3};
+    for (; i + 32 <= size; i += 32) {
+        for (int j = 0; j < 4; j++) {
+            std::uint64_t word;
+            std::memcpy(&word, bytes + i + 8 * j, sizeof(word));
+            lanes[j] = (lanes[j] ^ mix(word)) * 0x9fb21c651e98df25ULL;
+            lanes[j] = (lanes[j] << 29) | (lanes[j] >> 35);
+        }
+    }
+    for (int j = 0; j < 4; j++) {
+        h = mix(h ^ lanes[j]);
+    }
+    for (; i + 8 <= size; i += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, bytes + i, sizeof(word));
+        h = mix(h ^ word);
+    }
+    if (i < size) {
+        std::uint64_t word = 0;
+        std::memcpy(&word, bytes + i, size - i);
+        h = mix(h ^ word);
+    }
+    return h;
+}
+
+std::string hashToString(std::uint64_t hash) {
+    static const char digits[] = "0123456789abcdef";
+    std::string result(16, '0');
+    for (int i = 15; i >= 0; i--) {
+        result[i] = digits[hash & 0xf];
+        hash >>= 4;
+    }
+    return result;
+}
+}
+}
@@ -6,12 +6,16 @@
 #include <GLES3/gl3.h>
 #endif
 
+#include <chrono>
+
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
 #include "VFRendering/View.hxx"
 #include "VFRendering/Utilities.hxx"
 
+#include "GpuBuffer.hxx"
+#include "StreamingBuffer.hxx"
 #include "VectorfieldIsosurface.hxx"
 #include "shaders/isosurface.vert.glsl.hxx"
 #include "shaders/isosurface.frag.glsl.hxx"
@@ -28,23 +32,16 @@ void IsosurfaceRenderer::initialize() {
     glGenVertexArrays(1, &m_vao);
     glBindVertexArray(m_vao);
 
-    glGenBuffers(1, &m_ibo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ibo);
+    m_ibo.reset(new Utilities::GpuBuffer(GL_ELEMENT_ARRAY_BUFFER));
+    m_ibo->bind();
     m_num_indices = 0;
 
-    glGenBuffers(1, &m_position_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, m_position_vbo);
-    glVertexAttribPointer(0, 3, GL_FLOAT, false, 0, nullptr);
+    // the isosurface changes with the vectors, so its vertex data is streamed
+    m_position_buffer.reset(new Utilities::StreamingBuffer());
     glEnableVertexAttribArray(0);
-
-    glGenBuffers(1, &m_direction_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, m_direction_vbo);
-    glVertexAttribPointer(1, 3, GL_FLOAT, false, 0, nullptr);
+    m_direction_buffer.reset(new Utilities::StreamingBuffer());
     glEnableVertexAttribArray(1);
-
-    glGenBuffers(1, &m_normal_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, m_normal_vbo);
-    glVertexAttribPointer(2, 3, GL_FLOAT, false, 0, nullptr);
+    m_normal_buffer.reset(new Utilities::StreamingBuffer());
     glEnableVertexAttribArray(2);
 
     updateShaderProgram();
@@ -56,11 +53,15 @@ IsosurfaceRenderer::~IsosurfaceRenderer() {
         return;
     }
     glDeleteVertexArrays(1, &m_vao);
-    glDeleteBuffers(1, &m_ibo);
-    glDeleteBuffers(1, &m_position_vbo);
-    glDeleteBuffers(1, &m_direction_vbo);
-    glDeleteBuffers(1, &m_normal_vbo);
-    glDeleteProgram(m_program);
+    Utilities::releaseProgram(m_view, m_program);
+}
+
+std::size_t IsosurfaceRenderer::gpuMemoryUsage() const {
+    std::size_t memory_usage = VectorFieldRenderer::gpuMemoryUsage();
+    if (m_is_initialized) {
+        memory_usage += m_ibo->capacity() + m_position_buffer->capacity() + m_direction_buffer->capacity() + m_normal_buffer->capacity();
+    }
+    return memory_usage;
 }
 
 void IsosurfaceRenderer::optionsHaveChanged(const std::vector<int>& changed_options) {
@@ -95,9 +96,16 @@ void IsosurfaceRenderer::update(bool keep_geometry) {
     updateIsosurfaceIndices();
 }
 
+void IsosurfaceRenderer::updatePositions() {
+    // The isosurface depends on the positions, but the tetrahedralization
+    // can be kept. It is recalculated when drawing, so that it is calculated
+    // only once if the vectors changed as well.
+    m_positions_changed = true;
+}
+
 void IsosurfaceRenderer::draw(float aspect_ratio) {
     initialize();
-    if (m_value_function_changed || m_isovalue_changed) {
+    if (m_value_function_changed || m_isovalue_changed || m_positions_changed || m_is_waiting_for_volume_indices) {
         updateIsosurfaceIndices();
     }
     if (m_num_indices <= 0) {
@@ -109,22 +117,15 @@ void IsosurfaceRenderer::draw(float aspect_ratio) {
     // Disable z-Filtering, that's what the isosurface is for, after all.
     glm::vec2 z_range = {-2, 2};
 
-    auto matrices = Utilities::getMatrices(options(), aspect_ratio);
-    auto model_view_matrix = matrices.first;
-    auto projection_matrix = matrices.second;
-
-    glm::vec3 camera_position = options().get<View::Option::CAMERA_POSITION>();
-    glm::vec4 light_position = model_view_matrix * glm::vec4(camera_position, 1.0f);
-
-    glUniformMatrix4fv(glGetUniformLocation(m_program, "uProjectionMatrix"), 1, false, glm::value_ptr(projection_matrix));
-    glUniformMatrix4fv(glGetUniformLocation(m_program, "uModelviewMatrix"), 1, false, glm::value_ptr(model_view_matrix));
-    glUniform3f(glGetUniformLocation(m_program, "uLightPosition"), light_position[0], light_position[1], light_position[2]);
-    glUniform2f(glGetUniformLocation(m_program, "uZRange"), z_range[0], z_range[1]);
+    useCamera(m_program, aspect_ratio);
+    glUniform2f(m_z_range_location, z_range[0], z_range[1]);
     if (options().get<IsosurfaceRenderer::Option::FLIP_NORMALS>()) {
-        glUniform1f(glGetUniformLocation(m_program, "uFlipNormals"), -1.0);
+        glUniform1f(m_flip_normals_location, -1.0);
     } else {
-        glUniform1f(glGetUniformLocation(m_program, "uFlipNormals"), 1.0);
+        glUniform1f(m_flip_normals_location, 1.0);
     }
+    setColormapUniforms();
+    setDecodingUniforms();
 
     glDisable(GL_CULL_FACE);
     glDrawElements(GL_TRIANGLES, m_num_indices, GL_UNSIGNED_INT, nullptr);
@@ -136,15 +137,23 @@ void IsosurfaceRenderer::updateShaderProgram() {
         return;
     }
     if (m_program) {
-        glDeleteProgram(m_program);
+        Utilities::releaseProgram(m_view, m_program);
+        m_program = 0;
     }
     std::string vertex_shader_source = ISOSURFACE_VERT_GLSL;
+    vertex_shader_source += channelsImplementation(ChannelSource::NONE);
     vertex_shader_source += options().get<View::Option::COLORMAP_IMPLEMENTATION>();
+    vertex_shader_source += positionDecodingImplementation();
     std::string fragment_shader_source = ISOSURFACE_FRAG_GLSL;
+    fragment_shader_source += channelsImplementation(ChannelSource::NONE);
     fragment_shader_source += options().get<View::Option::COLORMAP_IMPLEMENTATION>();
     fragment_shader_source += options().get<View::Option::IS_VISIBLE_IMPLEMENTATION>();
     fragment_shader_source += options().get<Option::LIGHTING_IMPLEMENTATION>();
-    m_program = Utilities::createProgram(vertex_shader_source, fragment_shader_source, {"ivPosition", "ivDirection", "ivNormal"});
+    m_program = Utilities::createProgram(m_view, vertex_shader_source, fragment_shader_source, {"ivPosition", "ivDirection", "ivNormal"});
+    m_z_range_location = glGetUniformLocation(m_program, "uZRange");
+    m_flip_normals_location = glGetUniformLocation(m_program, "uFlipNormals");
+    resolveColormapUniforms(m_program);
+    resolveDecodingUniforms(m_program);
 }
 
 void IsosurfaceRenderer::updateIsosurfaceIndices() {
@@ -153,41 +162,49 @@ void IsosurfaceRenderer::updateIsosurfaceIndices() {
     }
     m_value_function_changed = false;
     m_isovalue_changed = false;
+    m_positions_changed = false;
 
     auto value_function = options().get<Option::VALUE_FUNCTION>();
     auto isovalue = options().get<Option::ISOVALUE>();
 
-    const auto& volume_indices = volumeIndices();
+    if (!value_function) {
+        m_num_indices = 0;
+        return;
+    }
 
-    if (volume_indices.size() == 0) {
+    // Arbitrary geometries are tetrahedralized in the background, so that
+    // drawing does not block. Until then, the isosurface is left out.
+    auto volume_indices_ready = geometry().prepareVolumeIndices();
+    m_is_waiting_for_volume_indices = (volume_indices_ready.wait_for(std::chrono::seconds(0)) != std::future_status::ready);
+    if (m_is_waiting_for_volume_indices) {
         m_num_indices = 0;
         return;
-    } else if (positions().size() < 4) {
+    }
+
+    if (geometry().numVolumeTetrahedra() == 0) {
         m_num_indices = 0;
         return;
-    } else if (!value_function) {
+    } else if (geometry().numPositions() < 4) {
         m_num_indices = 0;
         return;
     }
 
     std::vector<float> values;
-    for (Geometry::index_type i = 0; i < positions().size(); i++) {
-        const glm::vec3& position = positions()[i];
+    values.reserve(geometry().numPositions());
+    for (Geometry::index_type i = 0; i < geometry().numPositions(); i++) {
+        const glm::vec3 position = geometry().position(i);
         const glm::vec3& direction = directions()[i];
         values.push_back(value_function(position, direction));
     }
 
-    VectorfieldIsosurface isosurface(VectorfieldIsosurface::calculate(positions(), directions(), values, isovalue, volume_indices));
+    VectorfieldIsosurface isosurface(VectorfieldIsosurface::calculate(geometry(), directions(), values, isovalue));
 
     const std::vector<GLuint> surface_indices(isosurface.triangle_indices.begin(), isosurface.triangle_indices.end());
 
     glBindVertexArray(m_vao);
-    glBindBuffer(GL_ARRAY_BUFFER, m_position_vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * isosurface.positions.size(), isosurface.positions.data(), GL_STREAM_DRAW);
-    glBindBuffer(GL_ARRAY_BUFFER, m_direction_vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * isosurface.directions.size(), isosurface.directions.data(), GL_STREAM_DRAW);
-    glBindBuffer(GL_ARRAY_BUFFER, m_normal_vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * isosurface.normals.size(), isosurface.normals.data(), GL_STREAM_DRAW);
+    streamPositionData(*m_position_buffer, 0, isosurface.positions);
+    streamVectorData(*m_direction_buffer, 1, isosurface.directions);
+    streamVectorData(*m_normal_buffer, 2, isosurface.normals);
 
     // Enforce valid range
     if (surface_indices.size() < 3) {
@@ -195,8 +212,7 @@ void IsosurfaceRenderer::updateIsosurfaceIndices() {
         return;
     }
     glBindVertexArray(m_vao);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ibo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * surface_indices.size(), surface_indices.data(), GL_STREAM_DRAW);
+    m_ibo->upload(surface_indices);
     m_num_indices = surface_indices.size();
 }
 }
@@ -1,8 +1,25 @@
 #include "VFRendering/RendererBase.hxx"
 
+#include <algorithm>
+
+#ifndef __EMSCRIPTEN__
+#include <glad/glad.h>
+#else
+#include <GLES3/gl3.h>
+#endif
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include "CameraBlock.hxx"
+#include "GpuBuffer.hxx"
+
 namespace VFRendering {
 RendererBase::RendererBase(const View& view) : m_view(view), m_options(m_view.options()) {}
 
+RendererBase::RendererBase(const RendererBase& other) : m_view(other.m_view), m_options(other.m_options) {}
+
+RendererBase::~RendererBase() {}
+
 const Options& RendererBase::options() const {
     return m_options;
 }
@@ -26,4 +43,67 @@ void RendererBase::updateOptions(const Options& options) {
 
 void RendererBase::updateIfNecessary() { }
 
+std::size_t RendererBase::gpuMemoryUsage() const {
+    if (!m_camera_buffer) {
+        return 0;
+    }
+    return m_camera_buffer->capacity();
+}
+
+void RendererBase::sharedGpuMemoryUsage(std::map<const void*, std::size_t>& shared_memory_usage) const {
+    (void)shared_memory_usage;
+}
+
+void RendererBase::useCamera(unsigned int program, float aspect_ratio) const {
+#ifndef __EMSCRIPTEN__
+    if (m_view.m_is_drawing && aspect_ratio == m_view.m_viewport_aspect_ratio && Utilities::hasSameCamera(options(), m_view.options())) {
+        glBindBufferRange(GL_UNIFORM_BUFFER, Utilities::camera_block_binding, m_view.m_camera_buffer->id(), m_view.m_camera_block_index * m_view.m_camera_block_stride, sizeof(Utilities::CameraBlock));
+        return;
+    }
+#endif
+    useCamera(program, Utilities::getCameraBlock(options(), aspect_ratio));
+}
+
+void RendererBase::useCamera(unsigned int program, const glm::mat4& projection_matrix, const glm::mat4& modelview_matrix, const glm::vec3& light_position) const {
+    Utilities::CameraBlock camera_block;
+    camera_block.projection_matrix = projection_matrix;
+    camera_block.modelview_matrix = modelview_matrix;
+    camera_block.light_position = glm::vec4(light_position, 1.0f);
+    useCamera(program, camera_block);
+}
+
+void RendererBase::resolveColormapUniforms(unsigned int program) {
+    // colormaps without a range do not declare the uniform
+    m_colormap_z_range_location = glGetUniformLocation(program, "uColormapZRange");
+}
+
+void RendererBase::setColormapUniforms() const {
+    if (m_colormap_z_range_location < 0) {
+        return;
+    }
+    glm::vec2 z_range = options().get<View::Option::COLORMAP_Z_RANGE>();
+    glUniform2f(m_colormap_z_range_location, z_range[0], z_range[1]);
+}
+
+void RendererBase::useCamera(unsigned int program, const Utilities::CameraBlock& camera_block) const {
+#ifndef __EMSCRIPTEN__
+    (void)program;
+    if (!m_camera_buffer) {
+        m_camera_buffer.reset(new Utilities::GpuBuffer(GL_UNIFORM_BUFFER));
+    }
+    // the block is only uploaded when the renderer's camera changed
+    const char* camera_block_data = reinterpret_cast<const char*>(&camera_block);
+    if (m_camera_block.size() != sizeof(camera_block) || !std::equal(m_camera_block.begin(), m_camera_block.end(), camera_block_data)) {
+        m_camera_block.assign(camera_block_data, camera_block_data + sizeof(camera_block));
+        m_camera_buffer->upload(m_camera_block);
+    }
+    glBindBufferRange(GL_UNIFORM_BUFFER, Utilities::camera_block_binding, m_camera_buffer->id(), 0, sizeof(camera_block));
+#else
+    // GLSL ES 1.00 has no uniform blocks
+    glUniformMatrix4fv(glGetUniformLocation(program, "uProjectionMatrix"), 1, false, glm::value_ptr(camera_block.projection_matrix));
+    glUniformMatrix4fv(glGetUniformLocation(program, "uModelviewMatrix"), 1, false, glm::value_ptr(camera_block.modelview_matrix));
+    glUniform3fv(glGetUniformLocation(program, "uLightPosition"), 1, glm::value_ptr(camera_block.light_position));
+#endif
+}
+
 }
@@ -0,0 +1,169 @@
+#include "RiceCoding.hxx"
+
+#include <algorithm>
+
+namespace VFRendering {
+namespace Utilities {
+// Quotients from this value on are escaped and followed by the raw value, so
+// that outliers do not produce excessively long unary codes.
+static const unsigned int escape_quotient = 32;
+static const unsigned int max_rice_parameter = 24;
+
+static std::uint32_t zigzagEncode(std::int32_t value) {
+    return (static_cast<std::uint32_t>(value) << 1) ^ static_cast<std::uint32_t>(value >> 31);
+}
+
+static std::int32_t zigzagDecode(std::uint32_t value) {
+    return static_cast<std::int32_t>((value >> 1) ^ (~(value & 1) + 1));
+}
+
+namespace {
+class BitWriter {
+public:
+    BitWriter(std::vector<unsigned char>& output) : m_output(output) {}
+
+    void write(std::uint64_t bits, unsigned int num_bits) {
+        m_buffer |= bits << m_num_buffered_bits;
+        m_num_buffered_bits += num_bits;
+        while (m_num_buffered_bits >= 8) {
+            m_output.push_back(static_cast<unsigned char>(m_buffer));
+            m_buffer >>= 8;
+            m_num_buffered_bits -= 8;
+        }
+    }
+
+    void flush() {
+        if (m_num_buffered_bits > 0) {
+            m_output.push_back(static_cast<unsigned char>(m_buffer));
+        }
+        m_buffer = 0;
+        m_num_buffered_bits = 0;
+    }
+
+private:
+    std::vector<unsigned char>& m_output;
+    std::uint64_t m_buffer = 0;
+    unsigned int m_num_buffered_bits = 0;
+};
+
+class BitReader {
+public:
+    BitReader(const unsigned char* input, std::size_t size) : m_input(input), m_size(size) {}
+
+    std::uint32_t read(unsigned int num_bits) {
+        refill();
+        std::uint32_t bits = static_cast<std::uint32_t>(m_buffer & ((std::uint64_t(1) << num_bits) - 1));
+        consume(num_bits);
+        return bits;
+    }
+
+    // reads up to max_count set bits followed by a cleared bit
+    unsigned int readUnary(unsigned int max_count) {
+        unsigned int count = 0;
+        while (count < max_count) {
+            refill();
+            if (!(m_buffer & 1)) {
+                consume(1);
+                return count;
+            }
+            consume(1);
+            count++;
+        }
+        return count;
+    }
+
+    bool isValid() const {
+        return m_num_buffered_bits >= 0;
+    }
+
+    // returns the number of bytes with consumed bits, which may be less than
+    // the number of bytes read into the buffer
+    std::size_t bytesRead() const {
+        return (8 * m_position - m_num_buffered_bits + 7) / 8;
+    }
+
+private:
+    void refill() {
+        while (m_num_buffered_bits <= 56 && m_position < m_size) {
+            m_buffer |= std::uint64_t(m_input[m_position++]) << m_num_buffered_bits;
+            m_num_buffered_bits += 8;
+        }
+    }
+
+    void consume(unsigned int num_bits) {
+        m_buffer >>= num_bits;
+        // becomes negative if bits beyond the end of the input were read
+        m_num_buffered_bits -= num_bits;
+    }
+
+    const unsigned char* m_input;
+    std::size_t m_size;
+    std::size_t m_position = 0;
+    std::uint64_t m_buffer = 0;
+    int m_num_buffered_bits = 0;
+};
+}
+
+void riceEncode(const std::int32_t* values, std::size_t count, std::size_t stride, std::vector<unsigned char>& output) {
+    std::vector<std::uint32_t> encoded_values(count);
+    for (std::size_t i = 0; i < count; i++) {
+        encoded_values[i] = zigzagEncode(values[i * stride]);
+    }
+    // the size of the codes for parameter k is the sum of the quotients plus
+    // k + 1 bits for each value
+    unsigned int rice_parameter = 0;
+    std::uint64_t min_num_bits = ~std::uint64_t(0);
+    for (unsigned int k = 0; k <= max_rice_parameter; k++) {
+        std::uint64_t num_bits = std::uint64_t(k + 1) * count;
+        for (auto value : encoded_values) {
+            std::uint32_t quotient = value >> k;
+            num_bits += (quotient < escape_quotient) ? quotient : escape_quotient + 32;
+        }
+        if (num_bits < min_num_bits) {
+            min_num_bits = num_bits;
+            rice_parameter = k;
+        }
+    }
+    output.push_back(static_cast<unsigned char>(rice_parameter));
+    BitWriter writer(output);
+    for (auto value : encoded_values) {
+        std::uint32_t quotient = value >> rice_parameter;
+        if (quotient < escape_quotient) {
+            writer.write((std::uint64_t(1) << quotient) - 1, quotient + 1);
+            writer.write(value & ((std::uint32_t(1) << rice_parameter) - 1), rice_parameter);
+        } else {
+            writer.write((std::uint64_t(1) << escape_quotient) - 1, escape_quotient);
+            writer.write(value, 32);
+        }
+    }
+    writer.flush();
+}
+
+std::size_t riceDecode(const unsigned char* input, std::size_t size, std::size_t count, std::int32_t* values, std::size_t stride, bool add) {
+    if (size < 1 || input[0] > max_rice_parameter) {
+        return 0;
+    }
+    const unsigned int rice_parameter = input[0];
+    BitReader reader(input + 1, size - 1);
+    for (std::size_t i = 0; i < count; i++) {
+        unsigned int quotient = reader.readUnary(escape_quotient);
+        std::uint32_t value;
+        if (quotient < escape_quotient) {
+            value = (std::uint32_t(quotient) << rice_parameter) | reader.read(rice_parameter);
+        } else {
+            value = reader.read(32);
+        }
+        std::int32_t decoded_value = zigzagDecode(value);
+        if (add) {
+            values[i * stride] = static_cast<std::int32_t>(static_cast<std::uint32_t>(values[i * stride]) + static_cast<std::uint32_t>(decoded_value));
+        } else {
+            values[i * stride] = decoded_value;
+        }
+    }
+    if (!reader.isValid()) {
+        return 0;
+    }
+    return 1 + reader.bytesRead();
+}
+}
+}
@@ -0,0 +1,437 @@
+#include "VFRendering/SnapshotSequence.hxx"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "FileCache.hxx"
+#include "RiceCoding.hxx"
+#include "ThreadPool.hxx"
+
+namespace VFRendering {
+static const char snapshot_sequence_magic[8] = {'V', 'F', 'R', 'S', 'N', 'A', 'P', '1'};
+static const char compressed_snapshot_sequence_magic[8] = {'V', 'F', 'R', 'S', 'N', 'A', 'P', 'Z'};
+static const std::size_t snapshot_sequence_header_size = 24;
+// large enough to code efficiently, small enough to decode in parallel
+static const std::uint32_t compressed_snapshot_block_size = 16384;
+// quantized components are limited to this magnitude, so that their
+// differences of at most 2^31 - 2 can be stored as 32 bit integers
+static const double max_quantized_component = (1 << 30) - 1;
+
+static std::uint32_t readUInt32(const char* data) {
+    std::uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+SnapshotSequence::SnapshotSequence(VectorField& vf, const std::string& path, std::size_t num_prefetched_frames) : m_vf(vf), m_file(new Utilities::MappedFile(path)), m_num_prefetched_frames(num_prefetched_frames) {
+    if (!m_file->isValid() || m_file->size() < snapshot_sequence_header_size) {
+        return;
+    }
+    if (std::memcmp(m_file->data(), compressed_snapshot_sequence_magic, sizeof(compressed_snapshot_sequence_magic)) == 0) {
+        if (!openCompressedFile()) {
+            return;
+        }
+    } else {
+        if (std::memcmp(m_file->data(), snapshot_sequence_magic, sizeof(snapshot_sequence_magic)) != 0) {
+            return;
+        }
+        std::uint32_t component_size = readUInt32(m_file->data() + 8);
+        std::uint64_t num_vectors;
+        std::memcpy(&num_vectors, m_file->data() + 16, sizeof(num_vectors));
+        if ((component_size != sizeof(float) && component_size != sizeof(double)) || num_vectors == 0) {
+            return;
+        }
+        m_component_size = component_size;
+        m_num_vectors = num_vectors;
+        // a partially written last frame is ignored
+        m_num_frames = (m_file->size() - snapshot_sequence_header_size) / (3 * m_component_size * m_num_vectors);
+        if (m_num_frames == 0) {
+            return;
+        }
+    }
+    showFrame(0);
+#ifndef VFRENDERING_NO_THREADS
+    if (m_num_prefetched_frames > 0) {
+        m_has_prefetch_frame_changed = true;
+        m_prefetch_thread = std::thread(&SnapshotSequence::prefetchFrames, this);
+    }
+#endif
+}
+
+SnapshotSequence::~SnapshotSequence() {
+    if (m_prefetch_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_prefetch_mutex);
+            m_is_stopping = true;
+        }
+        m_prefetch_condition_variable.notify_one();
+        m_prefetch_thread.join();
+    }
+    // the vector field may still read the vectors from the mapping or the
+    // decoded vectors, so it gets a copy of its own before they are released
+    if (m_num_frames > 0 && m_vf.directionEncoding() == VectorField::DirectionEncoding::FLOAT) {
+        std::vector<glm::vec3> vectors(m_vf.numVectors());
+        m_vf.copyVectors(0, vectors.size(), vectors.data());
+        m_vf.updateVectors(vectors);
+    }
+}
+
+bool SnapshotSequence::isValid() const {
+    return m_num_frames > 0 && !m_has_decoding_error;
+}
+
+Geometry::index_type SnapshotSequence::numVectors() const {
+    return m_num_vectors;
+}
+
+std::size_t SnapshotSequence::numFrames() const {
+    return m_num_frames;
+}
+
+std::size_t SnapshotSequence::currentFrame() const {
+    return m_current_frame;
+}
+
+void SnapshotSequence::seek(std::size_t frame) {
+    if (!isValid()) {
+        return;
+    }
+    frame = std::min(frame, m_num_frames - 1);
+    m_play_start_frame = frame;
+    m_play_start_time = std::chrono::steady_clock::now();
+    if (frame != m_current_frame) {
+        showFrame(frame);
+    }
+}
+
+void SnapshotSequence::play(double frames_per_second, bool is_looping) {
+    m_frames_per_second = frames_per_second;
+    m_is_looping = is_looping;
+    m_is_playing = (frames_per_second > 0);
+    m_play_start_frame = m_current_frame;
+    m_play_start_time = std::chrono::steady_clock::now();
+}
+
+void SnapshotSequence::pause() {
+    m_is_playing = false;
+}
+
+bool SnapshotSequence::isPlaying() const {
+    return m_is_playing;
+}
+
+bool SnapshotSequence::update() {
+    if (!isValid() || !m_is_playing) {
+        return false;
+    }
+    std::chrono::duration<double> elapsed_time = std::chrono::steady_clock::now() - m_play_start_time;
+    std::size_t frame = m_play_start_frame + static_cast<std::size_t>(std::floor(elapsed_time.count() * m_frames_per_second));
+    if (frame >= m_num_frames) {
+        if (m_is_looping) {
+            frame %= m_num_frames;
+        } else {
+            frame = m_num_frames - 1;
+            m_is_playing = false;
+        }
+    }
+    if (frame == m_current_frame) {
+        return false;
+    }
+    showFrame(frame);
+    return true;
+}
+
+bool SnapshotSequence::openCompressedFile() {
+    const char* data = m_file->data();
+    const std::size_t size = m_file->size();
+    std::uint64_t num_vectors;
+    std::memcpy(&num_vectors, data + 16, sizeof(num_vectors));
+    m_block_size = readUInt32(data + 8);
+    std::memcpy(&m_quantization_step, data + 12, sizeof(m_quantization_step));
+    if (num_vectors == 0 || m_block_size == 0 || !(m_quantization_step > 0)) {
+        return false;
+    }
+    const std::uint64_t num_blocks = (num_vectors + m_block_size - 1) / m_block_size;
+    // a partially written last frame is ignored, and so are all frames before
+    // the first keyframe
+    std::size_t offset = snapshot_sequence_header_size;
+    while (offset + 8 <= size) {
+        bool is_keyframe = (readUInt32(data + offset) != 0);
+        if (readUInt32(data + offset + 4) != num_blocks || size - offset - 8 < 4 * num_blocks) {
+            break;
+        }
+        std::uint64_t frame_size = 8 + 4 * num_blocks;
+        for (std::uint64_t i = 0; i < num_blocks; i++) {
+            frame_size += readUInt32(data + offset + 8 + 4 * i);
+        }
+        if (frame_size > size - offset) {
+            break;
+        }
+        if (is_keyframe) {
+            m_keyframes.push_back(m_frame_offsets.size());
+        } else if (m_keyframes.empty()) {
+            return false;
+        } else {
+            m_keyframes.push_back(m_keyframes.back());
+        }
+        m_frame_offsets.push_back(offset);
+        offset += frame_size;
+    }
+    if (m_frame_offsets.empty()) {
+        return false;
+    }
+    m_frame_offsets.push_back(offset);
+    m_is_compressed = true;
+    m_num_vectors = num_vectors;
+    m_num_frames = m_keyframes.size();
+    m_quantized_vectors.resize(3 * m_num_vectors);
+    m_decoded_vectors.resize(m_num_vectors);
+    return true;
+}
+
+void SnapshotSequence::showFrame(std::size_t frame) {
+    m_current_frame = frame;
+    if (m_is_compressed) {
+        // continue from the decoded frame if there is no keyframe in between
+        std::size_t first_frame = m_keyframes[frame];
+        if (m_has_decoded_frame && m_decoded_frame < frame && m_decoded_frame >= first_frame) {
+            first_frame = m_decoded_frame + 1;
+        }
+        for (std::size_t i = first_frame; i <= frame; i++) {
+            if (!decodeFrame(i)) {
+                // the vector field keeps the last frame that was decoded, and
+                // the quantized vectors have to be decoded from a keyframe
+                m_has_decoded_frame = false;
+                m_has_decoding_error = true;
+                m_is_playing = false;
+                return;
+            }
+        }
+        m_decoded_frame = frame;
+        m_has_decoded_frame = true;
+        Utilities::parallelFor(0, m_num_vectors, [this](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; i++) {
+                m_decoded_vectors[i] = glm::vec3(m_quantized_vectors[3 * i + 0], m_quantized_vectors[3 * i + 1], m_quantized_vectors[3 * i + 2]) * m_quantization_step;
+            }
+        });
+        m_vf.updateVectors(&m_decoded_vectors[0].x, m_num_vectors);
+    } else {
+        const char* data = m_file->data() + snapshot_sequence_header_size + frame * 3 * m_component_size * m_num_vectors;
+        if (m_component_size == sizeof(float)) {
+            m_vf.updateVectors(reinterpret_cast<const float*>(data), m_num_vectors);
+        } else {
+            m_vf.updateVectors(reinterpret_cast<const double*>(data), m_num_vectors);
+        }
+    }
+    if (m_prefetch_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_prefetch_mutex);
+            m_prefetch_frame = frame;
+            m_has_prefetch_frame_changed = true;
+        }
+        m_prefetch_condition_variable.notify_one();
+    }
+}
+
+bool SnapshotSequence::decodeFrame(std::size_t frame) {
+    const char* data = m_file->data() + m_frame_offsets[frame];
+    const bool is_keyframe = (readUInt32(data) != 0);
+    const std::size_t num_blocks = readUInt32(data + 4);
+    std::vector<std::size_t> block_offsets(num_blocks + 1);
+    block_offsets[0] = 8 + 4 * num_blocks;
+    for (std::size_t i = 0; i < num_blocks; i++) {
+        block_offsets[i + 1] = block_offsets[i] + readUInt32(data + 8 + 4 * i);
+    }
+    std::vector<char> is_block_valid(num_blocks, true);
+    Utilities::parallelFor(0, num_blocks, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) {
+            const std::size_t first = i * m_block_size;
+            const std::size_t count = std::min<std::size_t>(m_block_size, m_num_vectors - first);
+            const unsigned char* block = reinterpret_cast<const unsigned char*>(data + block_offsets[i]);
+            std::size_t block_size = block_offsets[i + 1] - block_offsets[i];
+            std::int32_t* quantized_vectors = &m_quantized_vectors[3 * first];
+            // keyframes store the components, other frames their differences
+            for (int j = 0; j < 3; j++) {
+                std::size_t num_bytes_read = Utilities::riceDecode(block, block_size, count, quantized_vectors + j, 3, !is_keyframe);
+                if (num_bytes_read == 0) {
+                    is_block_valid[i] = false;
+                    break;
+                }
+                block += num_bytes_read;
+                block_size -= num_bytes_read;
+            }
+        }
+    }, 1);
+    return std::find(is_block_valid.begin(), is_block_valid.end(), false) == is_block_valid.end();
+}
+
+void SnapshotSequence::prefetchFrames() {
+    const std::size_t frame_size = 3 * m_component_size * m_num_vectors;
+    std::unique_lock<std::mutex> lock(m_prefetch_mutex);
+    while (true) {
+        m_prefetch_condition_variable.wait(lock, [this] {
+            return m_is_stopping || m_has_prefetch_frame_changed;
+        });
+        if (m_is_stopping) {
+            return;
+        }
+        std::size_t frame = m_prefetch_frame;
+        m_has_prefetch_frame_changed = false;
+        lock.unlock();
+        // the current frame is needed first, then the following ones
+        for (std::size_t i = 0; i <= m_num_prefetched_frames; i++) {
+            std::size_t prefetched_frame = (frame + i) % m_num_frames;
+            if (m_is_compressed) {
+                m_file->prefetch(m_frame_offsets[prefetched_frame], m_frame_offsets[prefetched_frame + 1] - m_frame_offsets[prefetched_frame]);
+            } else {
+                m_file->prefetch(snapshot_sequence_header_size + prefetched_frame * frame_size, frame_size);
+            }
+            std::lock_guard<std::mutex> change_lock(m_prefetch_mutex);
+            if (m_has_prefetch_frame_changed || m_is_stopping) {
+                break;
+            }
+        }
+        lock.lock();
+    }
+}
+
+SnapshotSequenceWriter::SnapshotSequenceWriter(const std::string& path, Geometry::index_type num_vectors, bool is_double_precision) : m_file(path, std::ios::binary), m_num_vectors(num_vectors), m_is_double_precision(is_double_precision) {
+    char header[snapshot_sequence_header_size] = {};
+    std::uint32_t component_size = is_double_precision ? sizeof(double) : sizeof(float);
+    std::uint64_t header_num_vectors = num_vectors;
+    std::memcpy(header, snapshot_sequence_magic, sizeof(snapshot_sequence_magic));
+    std::memcpy(header + 8, &component_size, sizeof(component_size));
+    std::memcpy(header + 16, &header_num_vectors, sizeof(header_num_vectors));
+    m_file.write(header, sizeof(header));
+}
+
+bool SnapshotSequenceWriter::isValid() const {
+    return static_cast<bool>(m_file);
+}
+
+bool SnapshotSequenceWriter::appendFrame(const glm::vec3* vectors) {
+    if (!m_is_double_precision) {
+        m_file.write(reinterpret_cast<const char*>(vectors), sizeof(glm::vec3) * m_num_vectors);
+    } else {
+        std::vector<double> components(3 * m_num_vectors);
+        for (Geometry::index_type i = 0; i < m_num_vectors; i++) {
+            components[3 * i + 0] = vectors[i].x;
+            components[3 * i + 1] = vectors[i].y;
+            components[3 * i + 2] = vectors[i].z;
+        }
+        m_file.write(reinterpret_cast<const char*>(components.data()), sizeof(double) * components.size());
+    }
+    m_file.flush();
+    return static_cast<bool>(m_file);
+}
+
+bool SnapshotSequenceWriter::appendFrame(const double* vectors) {
+    if (m_is_double_precision) {
+        m_file.write(reinterpret_cast<const char*>(vectors), 3 * sizeof(double) * m_num_vectors);
+    } else {
+        std::vector<float> components(vectors, vectors + 3 * m_num_vectors);
+        m_file.write(reinterpret_cast<const char*>(components.data()), sizeof(float) * components.size());
+    }
+    m_file.flush();
+    return static_cast<bool>(m_file);
+}
+
+bool SnapshotSequenceWriter::appendFrame(const std::vector<glm::vec3>& vectors) {
+    if (vectors.size() != m_num_vectors) {
+        return false;
+    }
+    return appendFrame(vectors.data());
+}
+
+Geometry::index_type SnapshotSequenceWriter::numVectors() const {
+    return m_num_vectors;
+}
+
+CompressedSnapshotSequenceWriter::CompressedSnapshotSequenceWriter(const std::string& path, Geometry::index_type num_vectors, float quantization_step, std::size_t keyframe_interval) : m_file(path, std::ios::binary), m_num_vectors(num_vectors), m_quantization_step(quantization_step), m_keyframe_interval(std::max<std::size_t>(keyframe_interval, 1)), m_quantized_vectors(3 * num_vectors) {
+    char header[snapshot_sequence_header_size] = {};
+    std::uint64_t header_num_vectors = num_vectors;
+    std::memcpy(header, compressed_snapshot_sequence_magic, sizeof(compressed_snapshot_sequence_magic));
+    std::memcpy(header + 8, &compressed_snapshot_block_size, sizeof(compressed_snapshot_block_size));
+    std::memcpy(header + 12, &quantization_step, sizeof(quantization_step));
+    std::memcpy(header + 16, &header_num_vectors, sizeof(header_num_vectors));
+    m_file.write(header, sizeof(header));
+}
+
+bool CompressedSnapshotSequenceWriter::isValid() const {
+    return m_file && m_quantization_step > 0;
+}
+
+bool CompressedSnapshotSequenceWriter::appendFrame(const glm::vec3* vectors) {
+    return appendQuantizedFrame(&vectors[0].x);
+}
+
+bool CompressedSnapshotSequenceWriter::appendFrame(const double* vectors) {
+    return appendQuantizedFrame(vectors);
+}
+
+bool CompressedSnapshotSequenceWriter::appendFrame(const std::vector<glm::vec3>& vectors) {
+    if (vectors.size() != m_num_vectors) {
+        return false;
+    }
+    return appendFrame(vectors.data());
+}
+
+Geometry::index_type CompressedSnapshotSequenceWriter::numVectors() const {
+    return m_num_vectors;
+}
+
+template<typename T>
+bool CompressedSnapshotSequenceWriter::appendQuantizedFrame(const T* components) {
+    if (!isValid()) {
+        return false;
+    }
+    const bool is_keyframe = (m_num_frames % m_keyframe_interval == 0);
+    std::swap(m_quantized_vectors, m_previous_quantized_vectors);
+    m_quantized_vectors.resize(3 * m_num_vectors);
+    Utilities::parallelFor(0, m_quantized_vectors.size(), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) {
+            double quantized_component = std::round(components[i] / static_cast<double>(m_quantization_step));
+            quantized_component = std::max(-max_quantized_component, std::min(max_quantized_component, quantized_component));
+            m_quantized_vectors[i] = static_cast<std::int32_t>(quantized_component);
+        }
+    });
+    const std::size_t num_blocks = (m_num_vectors + compressed_snapshot_block_size - 1) / compressed_snapshot_block_size;
+    std::vector<std::vector<unsigned char>> blocks(num_blocks);
+    Utilities::parallelFor(0, num_blocks, [&](std::size_t begin, std::size_t end) {
+        std::vector<std::int32_t> differences;
+        for (std::size_t i = begin; i < end; i++) {
+            const std::size_t first = i * compressed_snapshot_block_size;
+            const std::size_t count = std::min<std::size_t>(compressed_snapshot_block_size, m_num_vectors - first);
+            const std::int32_t* values = &m_quantized_vectors[3 * first];
+            if (!is_keyframe) {
+                differences.resize(3 * count);
+                for (std::size_t j = 0; j < 3 * count; j++) {
+                    differences[j] = values[j] - m_previous_quantized_vectors[3 * first + j];
+                }
+                values = differences.data();
+            }
+            for (int j = 0; j < 3; j++) {
+                Utilities::riceEncode(values + j, count, 3, blocks[i]);
+            }
+        }
+    }, 1);
+    std::vector<std::uint32_t> frame_header;
+    frame_header.push_back(is_keyframe ? 1 : 0);
+    frame_header.push_back(num_blocks);
+    for (const auto& block : blocks) {
+        frame_header.push_back(block.size());
+    }
+    m_file.write(reinterpret_cast<const char*>(frame_header.data()), sizeof(std::uint32_t) * frame_header.size());
+    for (const auto& block : blocks) {
+        m_file.write(reinterpret_cast<const char*>(block.data()), block.size());
+    }
+    m_file.flush();
+    if (!m_file) {
+        return false;
+    }
+    m_num_frames++;
+    return true;
+}
+}
@@ -0,0 +1,217 @@
+#include "StreamingBuffer.hxx"
+
+#include <algorithm>
+
+#ifndef __EMSCRIPTEN__
+#include <glad/glad.h>
+#else
+#include <GLES3/gl3.h>
+#endif
+
+namespace VFRendering {
+namespace Utilities {
+// segments start at multiples of this, so that any vertex attribute type is
+// aligned
+static const std::size_t segment_alignment = 256;
+
+StreamingBuffer::StreamingBuffer(std::size_t num_segments) : m_num_segments(std::max<std::size_t>(num_segments, 1)), m_fences(m_num_segments, nullptr) {}
+
+StreamingBuffer::~StreamingBuffer() {
+    release();
+}
+
+void StreamingBuffer::release() {
+    for (auto& fence : m_fences) {
+        if (fence) {
+            glDeleteSync(static_cast<GLsync>(fence));
+            fence = nullptr;
+        }
+    }
+    if (m_buffer) {
+        // deleting the buffer also unmaps it, the GPU keeps the storage until
+        // it finished reading it
+        glDeleteBuffers(1, &m_buffer);
+        m_buffer = 0;
+    }
+    m_is_persistent = false;
+    m_mapped_data = nullptr;
+    m_segment_size = 0;
+    m_segment = 0;
+}
+
+void* StreamingBuffer::map(std::size_t size) {
+    m_size = size;
+#ifndef __EMSCRIPTEN__
+    if (GLAD_GL_ARB_buffer_storage) {
+        void* data = mapPersistently(size);
+        if (data) {
+            return data;
+        }
+    } else if (size > 0) {
+        if (m_is_persistent) {
+            release();
+        }
+        if (!m_buffer) {
+            glGenBuffers(1, &m_buffer);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+        // orphaning the storage lets the driver allocate new storage instead
+        // of waiting for the GPU to finish reading the old one
+        glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STREAM_DRAW);
+        void* data = glMapBufferRange(GL_ARRAY_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        if (data) {
+            return data;
+        }
+    }
+#endif
+    // WebGL does not support mapping buffers
+    if (!m_buffer) {
+        glGenBuffers(1, &m_buffer);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+    m_is_staged = true;
+    m_staged_data.resize(size);
+    return m_staged_data.data();
+}
+
+void* StreamingBuffer::mapPersistently(std::size_t size) {
+#ifndef __EMSCRIPTEN__
+    if (m_buffer && !m_is_persistent) {
+        release();
+    }
+    if (!m_buffer || size > m_segment_size) {
+        // segments grow geometrically, so that slowly growing data does not
+        // lead to a new buffer for every update
+        std::size_t segment_size = std::max(size, m_segment_size + m_segment_size / 2);
+        release();
+        segment_size = std::max<std::size_t>((segment_size + segment_alignment - 1) / segment_alignment * segment_alignment, segment_alignment);
+        glGenBuffers(1, &m_buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, m_num_segments * segment_size, nullptr, flags | GL_DYNAMIC_STORAGE_BIT);
+        m_mapped_data = static_cast<char*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, m_num_segments * segment_size, flags));
+        if (!m_mapped_data) {
+            release();
+            return nullptr;
+        }
+        m_is_persistent = true;
+        m_segment_size = segment_size;
+        return m_mapped_data;
+    }
+    nextSegment();
+    return m_mapped_data + m_segment * m_segment_size;
+#else
+    (void)size;
+    return nullptr;
+#endif
+}
+
+void StreamingBuffer::nextSegment() {
+    // the GPU may still read the current segment, so the next one is used
+    fenceSegment(m_segment);
+    m_segment = (m_segment + 1) % m_num_segments;
+    waitForSegment(m_segment);
+    glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+}
+
+void StreamingBuffer::fenceSegment(std::size_t segment) {
+    GLsync fence = static_cast<GLsync>(m_fences[segment]);
+    if (fence) {
+        glDeleteSync(fence);
+    }
+    m_fences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void StreamingBuffer::waitForSegment(std::size_t segment) {
+    GLsync fence = static_cast<GLsync>(m_fences[segment]);
+    if (!fence) {
+        return;
+    }
+    while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {
+    }
+    glDeleteSync(fence);
+    m_fences[segment] = nullptr;
+}
+
+void* StreamingBuffer::mapRanges(const std::vector<std::array<std::size_t, 2>>& ranges) {
+    m_changed_ranges = ranges;
+    m_is_mapping_ranges = true;
+#ifndef __EMSCRIPTEN__
+    if (m_is_persistent) {
+        m_previous_buffer = m_buffer;
+        m_previous_offset = offset();
+        nextSegment();
+        return m_mapped_data + offset();
+    }
+#endif
+    // without persistent mapping, only the changed ranges are staged and
+    // uploaded, leaving the synchronization with the GPU to the driver
+    glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+    m_is_staged = true;
+    m_staged_data.resize(m_size);
+    return m_staged_data.data();
+}
+
+void StreamingBuffer::unmap() {
+    if (m_is_staged) {
+        if (m_is_mapping_ranges) {
+            for (const auto& range : m_changed_ranges) {
+                glBufferSubData(GL_ARRAY_BUFFER, range[0], range[1], m_staged_data.data() + range[0]);
+            }
+        } else {
+            glBufferData(GL_ARRAY_BUFFER, m_size, m_staged_data.data(), GL_STREAM_DRAW);
+        }
+        m_is_staged = false;
+    } else if (!m_is_persistent) {
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
+    if (m_previous_buffer) {
+        copyUnchangedRanges(m_previous_buffer, m_previous_offset);
+        // the copy reads the previous segment, which may only be written again
+        // once it finished
+        fenceSegment((m_segment + m_num_segments - 1) % m_num_segments);
+        m_previous_buffer = 0;
+        glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+    }
+    m_is_mapping_ranges = false;
+    m_changed_ranges.clear();
+}
+
+void StreamingBuffer::copyUnchangedRanges(unsigned int source_buffer, std::size_t source_offset) {
+    glBindBuffer(GL_COPY_READ_BUFFER, source_buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+    std::size_t begin = 0;
+    for (std::size_t i = 0; i <= m_changed_ranges.size(); i++) {
+        std::size_t end = (i < m_changed_ranges.size()) ? m_changed_ranges[i][0] : m_size;
+        if (end > begin) {
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, source_offset + begin, offset() + begin, end - begin);
+        }
+        if (i < m_changed_ranges.size()) {
+            begin = m_changed_ranges[i][0] + m_changed_ranges[i][1];
+        }
+    }
+}
+
+void StreamingBuffer::bind() const {
+    glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+}
+
+std::size_t StreamingBuffer::offset() const {
+    if (!m_is_persistent) {
+        return 0;
+    }
+    return m_segment * m_segment_size;
+}
+
+std::size_t StreamingBuffer::size() const {
+    return m_size;
+}
+
+std::size_t StreamingBuffer::capacity() const {
+    if (!m_is_persistent) {
+        return m_size;
+    }
+    return m_num_segments * m_segment_size;
+}
+}
+}
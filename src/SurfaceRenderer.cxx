@@ -10,6 +10,7 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include "VFRendering/Utilities.hxx"
+#include "GpuBuffer.hxx"
 
 #include "shaders/surface.vert.glsl.hxx"
 #include "shaders/surface.frag.glsl.hxx"
@@ -26,22 +27,17 @@ void SurfaceRenderer::initialize() {
     glGenVertexArrays(1, &m_vao);
     glBindVertexArray(m_vao);
     
-    glGenBuffers(1, &m_ibo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ibo);
+    m_ibo.reset(new Utilities::GpuBuffer(GL_ELEMENT_ARRAY_BUFFER));
+    m_ibo->bind();
     m_num_indices = 0;
 
-    glGenBuffers(1, &m_position_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, m_position_vbo);
-    glVertexAttribPointer(0, 3, GL_FLOAT, false, 0, nullptr);
+    // the positions and directions are bound in update
     glEnableVertexAttribArray(0);
-
-    glGenBuffers(1, &m_direction_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, m_direction_vbo);
-    glVertexAttribPointer(1, 3, GL_FLOAT, false, 0, nullptr);
     glEnableVertexAttribArray(1);
 
     updateShaderProgram();
     update(false);
+    updateChannels();
 }
 
 SurfaceRenderer::~SurfaceRenderer() {
@@ -49,10 +45,15 @@ SurfaceRenderer::~SurfaceRenderer() {
         return;
     }
     glDeleteVertexArrays(1, &m_vao);
-    glDeleteBuffers(1, &m_ibo);
-    glDeleteBuffers(1, &m_position_vbo);
-    glDeleteBuffers(1, &m_direction_vbo);
-    glDeleteProgram(m_program);
+    Utilities::releaseProgram(m_view, m_program);
+}
+
+std::size_t SurfaceRenderer::gpuMemoryUsage() const {
+    std::size_t memory_usage = VectorFieldRenderer::gpuMemoryUsage();
+    if (m_is_initialized) {
+        memory_usage += m_ibo->capacity();
+    }
+    return memory_usage;
 }
 
 void SurfaceRenderer::optionsHaveChanged(const std::vector<int>& changed_options) {
@@ -79,12 +80,19 @@ void SurfaceRenderer::update(bool keep_geometry) {
     }
     glBindVertexArray(m_vao);
     if (!keep_geometry) {
-        glBindBuffer(GL_ARRAY_BUFFER, m_position_vbo);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * positions().size(), positions().data(), GL_STREAM_DRAW);
+        bindPositionData(0);
         updateSurfaceIndices();
     }
-    glBindBuffer(GL_ARRAY_BUFFER, m_direction_vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * directions().size(), directions().data(), GL_STREAM_DRAW);
+    bindDirectionData(1);
+}
+
+void SurfaceRenderer::updatePositions() {
+    if (!m_is_initialized) {
+        return;
+    }
+    // the topology is unchanged, so the surface indices can be kept
+    glBindVertexArray(m_vao);
+    bindPositionData(0);
 }
 
 void SurfaceRenderer::draw(float aspect_ratio) {
@@ -95,15 +103,9 @@ void SurfaceRenderer::draw(float aspect_ratio) {
     glBindVertexArray(m_vao);
     glUseProgram(m_program);
 
-    auto matrices = Utilities::getMatrices(options(), aspect_ratio);
-    auto model_view_matrix = matrices.first;
-    auto projection_matrix = matrices.second;
-    glm::vec3 camera_position = options().get<View::Option::CAMERA_POSITION>();
-    glm::vec4 light_position = model_view_matrix * glm::vec4(camera_position, 1.0f);
-
-    glUniformMatrix4fv(glGetUniformLocation(m_program, "uProjectionMatrix"), 1, false, glm::value_ptr(projection_matrix));
-    glUniformMatrix4fv(glGetUniformLocation(m_program, "uModelviewMatrix"), 1, false, glm::value_ptr(model_view_matrix));
-    glUniform3f(glGetUniformLocation(m_program, "uLightPosition"), light_position[0], light_position[1], light_position[2]);
+    useCamera(m_program, aspect_ratio);
+    setColormapUniforms();
+    setDecodingUniforms();
 
     glDisable(GL_CULL_FACE);
     glDrawElements(GL_TRIANGLES, m_num_indices, GL_UNSIGNED_INT, nullptr);
@@ -115,28 +117,40 @@ void SurfaceRenderer::updateShaderProgram() {
         return;
     }
     if (m_program) {
-        glDeleteProgram(m_program);
+        Utilities::releaseProgram(m_view, m_program);
+        m_program = 0;
     }
     std::string vertex_shader_source = SURFACE_VERT_GLSL;
+    vertex_shader_source += channelsImplementation(ChannelSource::ATTRIBUTES);
     vertex_shader_source += options().get<View::Option::COLORMAP_IMPLEMENTATION>();
+    vertex_shader_source += directionDecodingImplementation();
+    vertex_shader_source += positionDecodingImplementation();
     std::string fragment_shader_source = SURFACE_FRAG_GLSL;
+    fragment_shader_source += channelsImplementation(ChannelSource::VARYINGS);
     fragment_shader_source += options().get<View::Option::COLORMAP_IMPLEMENTATION>();
     fragment_shader_source += options().get<View::Option::IS_VISIBLE_IMPLEMENTATION>();
-    m_program = Utilities::createProgram(vertex_shader_source, fragment_shader_source, {"ivPosition", "ivDirection"});
+    std::vector<std::string> attributes = {"ivPosition", "ivDirection"};
+    for (const auto& attribute : channelAttributes()) {
+        attributes.push_back(attribute);
+    }
+    m_program = Utilities::createProgram(m_view, vertex_shader_source, fragment_shader_source, attributes);
+    resolveColormapUniforms(m_program);
+    resolveDecodingUniforms(m_program);
 }
 
-void SurfaceRenderer::updateSurfaceIndices() {
+void SurfaceRenderer::updateChannels() {
     if (!m_is_initialized) {
         return;
     }
-    const auto& surface_indices = surfaceIndices();
-    if (surface_indices.empty()) {
-        m_num_indices = 0;
+    glBindVertexArray(m_vao);
+    bindChannelData(2, 0);
+}
+
+void SurfaceRenderer::updateSurfaceIndices() {
+    if (!m_is_initialized) {
         return;
     }
     glBindVertexArray(m_vao);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ibo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, 3 * sizeof(GLuint) * surface_indices.size(), &(surface_indices[0][0]), GL_STREAM_DRAW);
-    m_num_indices = 3 * surface_indices.size();
+    m_num_indices = 3 * bufferSurfaceIndexData(*m_ibo);
 }
 }
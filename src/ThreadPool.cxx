@@ -0,0 +1,199 @@
+#include "ThreadPool.hxx"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace VFRendering {
+namespace Utilities {
+namespace {
+class ThreadPool {
+public:
+    ThreadPool(std::size_t num_workers, bool discards_tasks_when_stopping=false) : m_discards_tasks_when_stopping(discards_tasks_when_stopping) {
+        for (std::size_t i = 0; i < num_workers; i++) {
+            m_workers.emplace_back(&ThreadPool::work, this);
+        }
+    }
+
+    ~ThreadPool() {
+        // discarded tasks are destroyed after the mutex is unlocked
+        std::queue<std::function<void()>> discarded_tasks;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_is_stopping = true;
+            if (m_discards_tasks_when_stopping) {
+                m_tasks.swap(discarded_tasks);
+            }
+        }
+        m_condition_variable.notify_all();
+        for (auto& worker : m_workers) {
+            worker.join();
+        }
+    }
+
+    std::size_t numWorkers() const {
+        return m_workers.size();
+    }
+
+    void enqueue(const std::function<void()>& task) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_tasks.push(task);
+        }
+        m_condition_variable.notify_one();
+    }
+
+    static ThreadPool& instance() {
+#ifdef VFRENDERING_NO_THREADS
+        static ThreadPool thread_pool(0);
+#else
+        static ThreadPool thread_pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+#endif
+        return thread_pool;
+    }
+
+    static ThreadPool& backgroundInstance() {
+        // background tasks may use parallelFor, so the workers of instance()
+        // are created first and therefore only stopped after this thread
+        instance();
+        static ThreadPool thread_pool(1, true);
+        return thread_pool;
+    }
+
+private:
+    void work() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_condition_variable.wait(lock, [this] {
+                    return m_is_stopping || !m_tasks.empty();
+                });
+                if (m_tasks.empty()) {
+                    return;
+                }
+                task = std::move(m_tasks.front());
+                m_tasks.pop();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::thread> m_workers;
+    std::queue<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_condition_variable;
+    bool m_is_stopping = false;
+    const bool m_discards_tasks_when_stopping;
+};
+
+// State shared by the threads working on one parallelFor call. Workers that
+// only start after all blocks are done still hold a reference to it, so it
+// must outlive the call itself.
+struct ParallelForState {
+    std::function<void(std::size_t, std::size_t)> function;
+    std::size_t first;
+    std::size_t last;
+    std::size_t block_size;
+    std::size_t num_blocks;
+    std::atomic<std::size_t> next_block{0};
+    std::size_t num_finished_blocks = 0;
+    std::exception_ptr exception;
+    std::mutex mutex;
+    std::condition_variable finished;
+
+    void processBlocks() {
+        while (true) {
+            std::size_t block = next_block++;
+            if (block >= num_blocks) {
+                return;
+            }
+            std::size_t begin = first + block * block_size;
+            std::size_t end = std::min(begin + block_size, last);
+            std::exception_ptr block_exception;
+            try {
+                function(begin, end);
+            } catch (...) {
+                block_exception = std::current_exception();
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if (block_exception && !exception) {
+                exception = block_exception;
+            }
+            num_finished_blocks++;
+            if (num_finished_blocks == num_blocks) {
+                finished.notify_all();
+            }
+        }
+    }
+};
+
+std::atomic<std::size_t> max_num_threads{0};
+}
+
+std::size_t numThreads() {
+    std::size_t num_threads = ThreadPool::instance().numWorkers() + 1;
+    if (max_num_threads > 0) {
+        num_threads = std::min<std::size_t>(num_threads, max_num_threads);
+    }
+    return num_threads;
+}
+
+void setNumThreads(std::size_t num_threads) {
+    max_num_threads = num_threads;
+}
+
+void runInBackground(const std::function<void()>& task) {
+#ifdef VFRENDERING_NO_THREADS
+    task();
+#else
+    ThreadPool::backgroundInstance().enqueue(task);
+#endif
+}
+
+void parallelFor(std::size_t first, std::size_t last, const std::function<void(std::size_t, std::size_t)>& function, std::size_t min_block_size) {
+    if (first >= last) {
+        return;
+    }
+    ThreadPool& thread_pool = ThreadPool::instance();
+    std::size_t num_threads = numThreads();
+    std::size_t count = last - first;
+    min_block_size = std::max<std::size_t>(min_block_size, 1);
+    if (num_threads == 1 || count <= min_block_size) {
+        function(first, last);
+        return;
+    }
+
+    // Use a few blocks per thread, so that uneven blocks balance out
+    std::size_t block_size = std::max((count + 4 * num_threads - 1) / (4 * num_threads), min_block_size);
+
+    auto state = std::make_shared<ParallelForState>();
+    state->function = function;
+    state->first = first;
+    state->last = last;
+    state->block_size = block_size;
+    state->num_blocks = (count + block_size - 1) / block_size;
+    std::size_t num_helpers = std::min(num_threads - 1, state->num_blocks - 1);
+    for (std::size_t i = 0; i < num_helpers; i++) {
+        thread_pool.enqueue([state] {
+            state->processBlocks();
+        });
+    }
+    state->processBlocks();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&state] {
+        return state->num_finished_blocks == state->num_blocks;
+    });
+    if (state->exception) {
+        std::rethrow_exception(state->exception);
+    }
+}
+}
+}
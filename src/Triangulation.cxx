@@ -0,0 +1,320 @@
+#include "Triangulation.hxx"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#ifndef NO_QHULL
+#include "Qhull.h"
+#include "QhullFacetList.h"
+#include "QhullVertexSet.h"
+#endif
+
+#include "BravaisLattice.hxx"
+#include "FileCache.hxx"
+#include "Hash.hxx"
+#include "ThreadPool.hxx"
+
+namespace VFRendering {
+namespace Triangulation {
+static const char tetrahedralization_qhull_options[] = "qhull d Qt Qbb Qz";
+
+// Geometries with fewer points are triangulated quickly enough that caching
+// their tetrahedra would only fill the cache directory.
+static const std::size_t min_cached_positions = 4096;
+
+namespace {
+struct TetrahedraCacheHeader {
+    char magic[8];
+    std::uint32_t byte_order;
+    std::uint32_t index_size;
+    std::uint64_t num_positions;
+    std::uint64_t num_tetrahedra;
+    std::uint64_t hashes[2];
+};
+}
+
+static TetrahedraCacheHeader tetrahedraCacheHeader(const std::vector<glm::vec3>& positions) {
+    TetrahedraCacheHeader header;
+    std::memcpy(header.magic, "VFRTET01", sizeof(header.magic));
+    header.byte_order = 0x01020304;
+    header.index_size = sizeof(Geometry::index_type);
+    header.num_positions = positions.size();
+    header.num_tetrahedra = 0;
+    // the options are part of the key, as they change the tetrahedralization
+    std::uint64_t options_hash = Utilities::hash(tetrahedralization_qhull_options, sizeof(tetrahedralization_qhull_options));
+    for (int i = 0; i < 2; i++) {
+        header.hashes[i] = Utilities::hash(positions.data(), positions.size() * sizeof(glm::vec3), options_hash + i);
+    }
+    return header;
+}
+
+static std::string tetrahedraCacheFilePath(const TetrahedraCacheHeader& header) {
+    return Utilities::cacheFilePath("tetrahedra-" + Utilities::hashToString(header.hashes[0]) + Utilities::hashToString(header.hashes[1]) + ".bin");
+}
+
+static bool readCachedTetrahedra(const std::string& path, const TetrahedraCacheHeader& expected_header, std::vector<std::array<Geometry::index_type, 4>>& tetrahedra) {
+    Utilities::MappedFile file(path);
+    if (!file.isValid() || file.size() < sizeof(TetrahedraCacheHeader)) {
+        return false;
+    }
+    TetrahedraCacheHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, expected_header.magic, sizeof(header.magic)) != 0 || header.byte_order != expected_header.byte_order || header.index_size != expected_header.index_size || header.num_positions != expected_header.num_positions || header.hashes[0] != expected_header.hashes[0] || header.hashes[1] != expected_header.hashes[1]) {
+        return false;
+    }
+    const std::size_t data_size = header.num_tetrahedra * sizeof(std::array<Geometry::index_type, 4>);
+    if (file.size() != sizeof(header) + data_size) {
+        return false;
+    }
+    tetrahedra.resize(header.num_tetrahedra);
+    std::memcpy(tetrahedra.data(), file.data() + sizeof(header), data_size);
+    for (const auto& tetrahedron : tetrahedra) {
+        for (auto index : tetrahedron) {
+            if (index >= header.num_positions) {
+                tetrahedra.clear();
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+std::vector<std::array<Geometry::index_type, 4>> tetrahedra(const std::vector<glm::vec3>& positions) {
+    BravaisLattice lattice;
+    if (BravaisLattice::detect(positions, lattice) && lattice.hasCellTetrahedra()) {
+        std::vector<std::array<Geometry::index_type, 4>> tetrahedra(lattice.numTetrahedra());
+        Utilities::parallelFor(0, tetrahedra.size(), [&](std::size_t begin, std::size_t end) {
+            lattice.copyTetrahedra(begin, end - begin, tetrahedra.data() + begin);
+        });
+        return tetrahedra;
+    }
+    return delaunayTetrahedra(positions);
+}
+
+std::vector<std::array<Geometry::index_type, 4>> delaunayTetrahedra(const std::vector<glm::vec3>& positions) {
+    std::vector<std::array<Geometry::index_type, 4>> tetrahedra;
+    std::string cache_file_path;
+    TetrahedraCacheHeader cache_header = TetrahedraCacheHeader();
+    if (positions.size() >= min_cached_positions) {
+        cache_header = tetrahedraCacheHeader(positions);
+        cache_file_path = tetrahedraCacheFilePath(cache_header);
+        if (!cache_file_path.empty() && readCachedTetrahedra(cache_file_path, cache_header, tetrahedra)) {
+            Utilities::touchCacheFile(cache_file_path);
+            return tetrahedra;
+        }
+    }
+#ifdef NO_QHULL
+    std::cerr << "volume indices calculation for arbitrary geometry required QHull" << std::endl;
+#else
+    // QHull requires double precision floating point numbers
+    const std::vector<glm::dvec3> dpositions(positions.cbegin(), positions.cend());
+
+    ::orgQhull::Qhull qhull;
+    qhull.runQhull("", 3, dpositions.size(), &(dpositions[0].x), tetrahedralization_qhull_options);
+
+    // copy results
+    for (auto facet : qhull.facetList()) {
+        if (!facet.isUpperDelaunay()) {
+            std::array<Geometry::index_type, 4> tetrahedron;
+            auto vertices = facet.vertices();
+            for (int i = 0; i < 4; i++) {
+                tetrahedron[i] = vertices[i].point().id();
+            }
+            tetrahedra.push_back(tetrahedron);
+        }
+    }
+
+    if (!cache_file_path.empty() && !tetrahedra.empty()) {
+        cache_header.num_tetrahedra = tetrahedra.size();
+        Utilities::writeCacheFile(cache_file_path, &cache_header, sizeof(cache_header), tetrahedra.data(), tetrahedra.size() * sizeof(tetrahedra[0]));
+    }
+#endif
+    return tetrahedra;
+}
+
+std::vector<std::array<Geometry::index_type, 3>> planarDelaunayTriangles(const std::vector<glm::vec3>& positions) {
+    std::vector<std::array<Geometry::index_type, 3>> triangles;
+#ifdef NO_QHULL
+    (void)positions;
+    std::cerr << "surface indices calculation for arbitrary geometry required QHull" << std::endl;
+#else
+    // Span the plane with the point farthest from the first one and the point
+    // farthest from the line between those two.
+    glm::dvec3 origin = positions[0];
+    glm::dvec3 u;
+    double u_length = 0;
+    for (const auto& position : positions) {
+        double length = glm::length(glm::dvec3(position) - origin);
+        if (length > u_length) {
+            u_length = length;
+            u = glm::dvec3(position) - origin;
+        }
+    }
+    glm::dvec3 normal;
+    double normal_length = 0;
+    for (const auto& position : positions) {
+        glm::dvec3 cross = glm::cross(u, glm::dvec3(position) - origin);
+        if (glm::length(cross) > normal_length) {
+            normal_length = glm::length(cross);
+            normal = cross;
+        }
+    }
+    if (u_length == 0 || normal_length == 0) {
+        // all points are on a line, so there is no surface
+        return triangles;
+    }
+    u = glm::normalize(u);
+    glm::dvec3 v = glm::normalize(glm::cross(normal, u));
+
+    // QHull requires double precision floating point numbers
+    std::vector<glm::dvec2> dpositions;
+    dpositions.reserve(positions.size());
+    for (const auto& position : positions) {
+        glm::dvec3 relative_position = glm::dvec3(position) - origin;
+        dpositions.push_back({glm::dot(relative_position, u), glm::dot(relative_position, v)});
+    }
+
+    ::orgQhull::Qhull qhull;
+    qhull.runQhull("", 2, dpositions.size(), &(dpositions[0].x), "qhull d Qt Qbb Qz");
+
+    // copy results
+    for (auto facet : qhull.facetList()) {
+        if (!facet.isUpperDelaunay()) {
+            std::array<Geometry::index_type, 3> triangle;
+            auto vertices = facet.vertices();
+            for (int i = 0; i < 3; i++) {
+                triangle[i] = vertices[i].point().id();
+            }
+            triangles.push_back(triangle);
+        }
+    }
+#endif
+    return triangles;
+}
+
+namespace {
+// A tetrahedron face, encoded as 4 * tetrahedron index + index of the
+// tetrahedron vertex opposite of the face.
+typedef std::uint32_t face_type;
+const face_type EMPTY_FACE = ~face_type(0);
+
+class FaceTable {
+public:
+    FaceTable(const std::vector<std::array<Geometry::index_type, 4>>& tetrahedra) : m_tetrahedra(tetrahedra) {}
+
+    std::array<Geometry::index_type, 3> vertices(face_type face) const {
+        const auto& tetrahedron = m_tetrahedra[face / 4];
+        std::array<Geometry::index_type, 3> face_vertices;
+        int j = 0;
+        for (int i = 0; i < 4; i++) {
+            if (i != int(face % 4)) {
+                face_vertices[j++] = tetrahedron[i];
+            }
+        }
+        std::sort(face_vertices.begin(), face_vertices.end());
+        return face_vertices;
+    }
+
+    std::uint64_t hash(face_type face) const {
+        auto v = vertices(face);
+        std::uint64_t h = v[0];
+        h = h * 0x9E3779B97F4A7C15ull + v[1];
+        h = h * 0x9E3779B97F4A7C15ull + v[2];
+        return h ^ (h >> 29);
+    }
+
+private:
+    const std::vector<std::array<Geometry::index_type, 4>>& m_tetrahedra;
+};
+}
+
+std::vector<std::array<Geometry::index_type, 3>> boundaryTriangles(const std::vector<glm::vec3>& positions, const std::vector<std::array<Geometry::index_type, 4>>& tetrahedra) {
+    const FaceTable face_table(tetrahedra);
+    const std::size_t num_faces = 4 * tetrahedra.size();
+    const std::size_t num_partitions = 4 * Utilities::numThreads();
+    const std::size_t num_blocks = num_partitions;
+    const std::size_t block_size = (num_faces + num_blocks - 1) / num_blocks;
+
+    // Scatter the faces into partitions, in two passes over fixed blocks so
+    // that every block knows where to write its faces.
+    std::vector<std::size_t> counts(num_blocks * num_partitions, 0);
+    Utilities::parallelFor(0, num_blocks, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t block = begin; block < end; block++) {
+            for (std::size_t face = block * block_size; face < std::min((block + 1) * block_size, num_faces); face++) {
+                counts[block * num_partitions + face_table.hash(face) % num_partitions]++;
+            }
+        }
+    }, 1);
+    std::vector<std::size_t> partition_offsets(num_partitions + 1, 0);
+    std::vector<std::size_t> offsets(num_blocks * num_partitions, 0);
+    std::size_t offset = 0;
+    for (std::size_t partition = 0; partition < num_partitions; partition++) {
+        partition_offsets[partition] = offset;
+        for (std::size_t block = 0; block < num_blocks; block++) {
+            offsets[block * num_partitions + partition] = offset;
+            offset += counts[block * num_partitions + partition];
+        }
+    }
+    partition_offsets[num_partitions] = offset;
+    std::vector<face_type> faces(num_faces);
+    Utilities::parallelFor(0, num_blocks, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t block = begin; block < end; block++) {
+            for (std::size_t face = block * block_size; face < std::min((block + 1) * block_size, num_faces); face++) {
+                faces[offsets[block * num_partitions + face_table.hash(face) % num_partitions]++] = face;
+            }
+        }
+    }, 1);
+
+    // Match the faces of each partition. In a valid tetrahedralization, every
+    // face is shared by at most two tetrahedra.
+    std::vector<std::vector<std::array<Geometry::index_type, 3>>> partition_triangles(num_partitions);
+    Utilities::parallelFor(0, num_partitions, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t partition = begin; partition < end; partition++) {
+            std::size_t table_size = 1;
+            while (table_size < 2 * (partition_offsets[partition + 1] - partition_offsets[partition])) {
+                table_size *= 2;
+            }
+            std::vector<face_type> table(table_size, EMPTY_FACE);
+            std::vector<bool> is_shared(table_size, false);
+            for (std::size_t i = partition_offsets[partition]; i < partition_offsets[partition + 1]; i++) {
+                face_type face = faces[i];
+                auto face_vertices = face_table.vertices(face);
+                // the low bits were used to pick the partition, so use the high bits here
+                std::size_t slot = (face_table.hash(face) >> 32) & (table_size - 1);
+                while (table[slot] != EMPTY_FACE && face_table.vertices(table[slot]) != face_vertices) {
+                    slot = (slot + 1) & (table_size - 1);
+                }
+                if (table[slot] == EMPTY_FACE) {
+                    table[slot] = face;
+                } else {
+                    is_shared[slot] = true;
+                }
+            }
+            for (std::size_t slot = 0; slot < table_size; slot++) {
+                if (table[slot] == EMPTY_FACE || is_shared[slot]) {
+                    continue;
+                }
+                const auto& tetrahedron = tetrahedra[table[slot] / 4];
+                Geometry::index_type opposite_index = tetrahedron[table[slot] % 4];
+                auto triangle = face_table.vertices(table[slot]);
+                const glm::vec3& p1 = positions[triangle[0]];
+                const glm::vec3& p2 = positions[triangle[1]];
+                const glm::vec3& p3 = positions[triangle[2]];
+                if (glm::dot(glm::cross(p2 - p1, p3 - p1), positions[opposite_index] - p1) > 0) {
+                    std::swap(triangle[1], triangle[2]);
+                }
+                partition_triangles[partition].push_back(triangle);
+            }
+        }
+    }, 1);
+
+    std::vector<std::array<Geometry::index_type, 3>> triangles;
+    for (const auto& triangles_of_partition : partition_triangles) {
+        triangles.insert(triangles.end(), triangles_of_partition.begin(), triangles_of_partition.end());
+    }
+    return triangles;
+}
+}
+}
@@ -1,6 +1,12 @@
 #include "VFRendering/Utilities.hxx"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
+#include <map>
+#include <utility>
 #ifndef __EMSCRIPTEN__
 #include <glad/glad.h>
 #else
@@ -10,6 +16,10 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "VFRendering/View.hxx"
+#include "CameraBlock.hxx"
+#include "FileCache.hxx"
+#include "Hash.hxx"
+#include "ProgramCache.hxx"
 
 #include "shaders/colormap.hsv.glsl.hxx"
 #include "shaders/colormap.bluered.glsl.hxx"
@@ -17,6 +27,7 @@
 #include "shaders/colormap.bluewhitered.glsl.hxx"
 #include "shaders/colormap.black.glsl.hxx"
 #include "shaders/colormap.white.glsl.hxx"
+#include "shaders/colormap.range.glsl.hxx"
 
 namespace VFRendering {
 namespace Utilities {
@@ -52,11 +63,18 @@ static GLuint createShader(GLenum shader_type, const std::string& shader_source)
 
 OpenGLException::OpenGLException(const std::string& message) : std::runtime_error(message) {}
 
-unsigned int createProgram(const std::string& vertex_shader_source, const std::string& fragment_shader_source, const std::vector<std::string>& attributes) {
+static GLuint linkProgram(const std::string& vertex_shader_source, const std::string& fragment_shader_source, const std::vector<std::string>& attributes, bool is_binary_retrievable) {
     GLuint vertex_shader = createShader(GL_VERTEX_SHADER, vertex_shader_source);
     GLuint fragment_shader = createShader(GL_FRAGMENT_SHADER, fragment_shader_source);
 
     GLuint program = glCreateProgram();
+#ifndef __EMSCRIPTEN__
+    if (is_binary_retrievable) {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+#else
+    (void)is_binary_retrievable;
+#endif
     glAttachShader(program, vertex_shader);
     glAttachShader(program, fragment_shader);
     for (std::vector<std::string>::size_type i = 0; i < attributes.size(); i++) {
@@ -95,6 +113,221 @@ unsigned int createProgram(const std::string& vertex_shader_source, const std::s
     return program;
 }
 
+static void bindCameraBlock(GLuint program) {
+#ifndef __EMSCRIPTEN__
+    GLuint camera_block_index = glGetUniformBlockIndex(program, "CameraBlock");
+    if (camera_block_index != GL_INVALID_INDEX) {
+        glUniformBlockBinding(program, camera_block_index, camera_block_binding);
+    }
+#else
+    (void)program;
+#endif
+}
+
+using ProgramKey = std::pair<std::uint64_t, std::uint64_t>;
+
+// number of unused programs that are kept, so that switching back to
+// previous options does not have to compile them again
+static const std::size_t max_num_unused_programs = 32;
+// how long a program has to be in use before its binary is written
+static const std::chrono::seconds min_program_binary_use_duration(2);
+
+ProgramCache::~ProgramCache() {
+    for (const auto& entry : programs) {
+        glDeleteProgram(entry.second.program);
+    }
+}
+
+static std::uint64_t hashProgram(const std::string& vertex_shader_source, const std::string& fragment_shader_source, const std::vector<std::string>& attributes, std::uint64_t seed) {
+    std::uint64_t hash = Utilities::hash(vertex_shader_source.data(), vertex_shader_source.size(), seed);
+    hash = Utilities::hash(fragment_shader_source.data(), fragment_shader_source.size(), hash ^ vertex_shader_source.size());
+    for (const auto& attribute : attributes) {
+        // the terminating null character separates the attributes
+        hash = Utilities::hash(attribute.c_str(), attribute.size() + 1, hash);
+    }
+    return hash;
+}
+
+#ifndef __EMSCRIPTEN__
+namespace {
+struct ProgramBinaryHeader {
+    char magic[8];
+    std::uint32_t byte_order;
+    std::uint32_t binary_format;
+    std::uint64_t binary_size;
+    std::uint64_t hashes[2];
+};
+}
+
+static bool hasProgramBinaryFormats() {
+    if (!GLAD_GL_ARB_get_program_binary) {
+        return false;
+    }
+    // e.g. Mesa only supports binaries while its shader cache is enabled
+    GLint num_binary_formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_binary_formats);
+    return num_binary_formats > 0;
+}
+
+static ProgramBinaryHeader programBinaryHeader(const ProgramKey& key) {
+    ProgramBinaryHeader header;
+    std::memcpy(header.magic, "VFRPRG01", sizeof(header.magic));
+    header.byte_order = 0x01020304;
+    header.binary_format = 0;
+    header.binary_size = 0;
+    // binaries can only be used with the driver that created them
+    std::string driver;
+    for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+        const char* value = reinterpret_cast<const char*>(glGetString(name));
+        if (value) {
+            driver += value;
+        }
+        driver += '\n';
+    }
+    header.hashes[0] = Utilities::hash(driver.data(), driver.size(), key.first);
+    header.hashes[1] = Utilities::hash(driver.data(), driver.size(), key.second);
+    return header;
+}
+
+static std::string programBinaryFilePath(const ProgramBinaryHeader& header) {
+    return cacheFilePath("program-" + hashToString(header.hashes[0]) + hashToString(header.hashes[1]) + ".bin");
+}
+
+static GLuint readProgramBinary(const std::string& path, const ProgramBinaryHeader& expected_header) {
+    MappedFile file(path);
+    if (!file.isValid() || file.size() < sizeof(ProgramBinaryHeader)) {
+        return 0;
+    }
+    ProgramBinaryHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, expected_header.magic, sizeof(header.magic)) != 0 || header.byte_order != expected_header.byte_order || header.hashes[0] != expected_header.hashes[0] || header.hashes[1] != expected_header.hashes[1]) {
+        return 0;
+    }
+    if (file.size() != sizeof(header) + header.binary_size) {
+        return 0;
+    }
+    // passing a format the driver does not support would cause an error
+    GLint num_binary_formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_binary_formats);
+    std::vector<GLint> binary_formats(std::max(num_binary_formats, 0));
+    if (!binary_formats.empty()) {
+        glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, binary_formats.data());
+    }
+    if (std::find(binary_formats.begin(), binary_formats.end(), static_cast<GLint>(header.binary_format)) == binary_formats.end()) {
+        return 0;
+    }
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.binary_format, file.data() + sizeof(header), static_cast<GLsizei>(header.binary_size));
+    // drivers reject binaries they cannot use, e.g. after an update
+    GLint status = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (!status) {
+        glDeleteProgram(program);
+        return 0;
+    }
+    touchCacheFile(path);
+    return program;
+}
+
+static void writeProgramBinary(const std::string& path, ProgramBinaryHeader header, GLuint program) {
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+    std::vector<char> binary(length);
+    GLenum binary_format = 0;
+    glGetProgramBinary(program, length, &length, &binary_format, binary.data());
+    if (length <= 0) {
+        return;
+    }
+    header.binary_format = binary_format;
+    header.binary_size = length;
+    writeCacheFile(path, &header, sizeof(header), binary.data(), length);
+}
+#endif
+
+unsigned int createProgram(const View& view, const std::string& vertex_shader_source, const std::string& fragment_shader_source, const std::vector<std::string>& attributes) {
+    ProgramKey key = {
+        hashProgram(vertex_shader_source, fragment_shader_source, attributes, 0),
+        hashProgram(vertex_shader_source, fragment_shader_source, attributes, 1)
+    };
+    auto& program_cache = view.m_program_cache->programs;
+    auto it = program_cache.find(key);
+    if (it == program_cache.end()) {
+        GLuint program = 0;
+        bool is_binary_pending = false;
+#ifndef __EMSCRIPTEN__
+        if (hasProgramBinaryFormats()) {
+            ProgramBinaryHeader binary_header = programBinaryHeader(key);
+            std::string binary_path = programBinaryFilePath(binary_header);
+            if (!binary_path.empty()) {
+                program = readProgramBinary(binary_path, binary_header);
+                // the binary is written once the program has been in use for
+                // a while
+                is_binary_pending = !program;
+            }
+        }
+#endif
+        if (!program) {
+            program = linkProgram(vertex_shader_source, fragment_shader_source, attributes, is_binary_pending);
+        }
+        bindCameraBlock(program);
+        it = program_cache.insert({key, {program, 0, 0, is_binary_pending, std::chrono::steady_clock::now()}}).first;
+    } else if (it->second.num_references == 0) {
+        it->second.use_time = std::chrono::steady_clock::now();
+    }
+    it->second.num_references++;
+    return it->second.program;
+}
+
+void writeProgramBinaries(ProgramCache& program_cache) {
+#ifndef __EMSCRIPTEN__
+    auto now = std::chrono::steady_clock::now();
+    for (auto& entry : program_cache.programs) {
+        auto& cached_program = entry.second;
+        if (!cached_program.is_binary_pending || cached_program.num_references == 0 || now - cached_program.use_time < min_program_binary_use_duration) {
+            continue;
+        }
+        cached_program.is_binary_pending = false;
+        ProgramBinaryHeader binary_header = programBinaryHeader(entry.first);
+        std::string binary_path = programBinaryFilePath(binary_header);
+        if (!binary_path.empty()) {
+            writeProgramBinary(binary_path, binary_header, cached_program.program);
+        }
+    }
+#else
+    (void)program_cache;
+#endif
+}
+
+void releaseProgram(const View& view, unsigned int program) {
+    auto& release_time = view.m_program_cache->release_time;
+    auto& program_cache = view.m_program_cache->programs;
+    std::size_t num_unused_programs = 0;
+    for (auto& entry : program_cache) {
+        auto& cached_program = entry.second;
+        if (cached_program.program == program && cached_program.num_references > 0) {
+            cached_program.num_references--;
+            cached_program.release_time = ++release_time;
+        }
+        if (cached_program.num_references == 0) {
+            num_unused_programs++;
+        }
+    }
+    while (num_unused_programs > max_num_unused_programs) {
+        auto oldest = program_cache.end();
+        for (auto it = program_cache.begin(); it != program_cache.end(); ++it) {
+            if (it->second.num_references == 0 && (oldest == program_cache.end() || it->second.release_time < oldest->second.release_time)) {
+                oldest = it;
+            }
+        }
+        glDeleteProgram(oldest->second.program);
+        program_cache.erase(oldest);
+        num_unused_programs--;
+    }
+}
+
 std::string getColormapImplementation(const Colormap& colormap) {
     switch (colormap) {
     case Colormap::BLUERED:
@@ -115,6 +348,17 @@ std::string getColormapImplementation(const Colormap& colormap) {
     }
 }
 
+std::string getRangedColormapImplementation(const Colormap& colormap) {
+    std::string implementation = getColormapImplementation(colormap);
+    const std::string signature = "vec3 colormap(vec3 direction)";
+    auto signature_position = implementation.find(signature);
+    if (signature_position == std::string::npos) {
+        return implementation;
+    }
+    implementation.replace(signature_position, signature.size(), "vec3 colormapOfDirection(vec3 direction)");
+    return COLORMAP_RANGE_GLSL + implementation;
+}
+
 std::pair<glm::mat4, glm::mat4> getMatrices(const VFRendering::Options& options, float aspect_ratio) {
     auto vertical_field_of_view = options.get<View::Option::VERTICAL_FIELD_OF_VIEW>();
     auto camera_position = options.get<View::Option::CAMERA_POSITION>();
@@ -139,5 +383,21 @@ std::pair<glm::mat4, glm::mat4> getMatrices(const VFRendering::Options& options,
                model_view_matrix, projection_matrix
     };
 }
+
+CameraBlock getCameraBlock(const Options& options, float aspect_ratio) {
+    auto matrices = getMatrices(options, aspect_ratio);
+    CameraBlock camera_block;
+    camera_block.projection_matrix = matrices.second;
+    camera_block.modelview_matrix = matrices.first;
+    camera_block.light_position = matrices.first * glm::vec4(options.get<View::Option::CAMERA_POSITION>(), 1.0f);
+    return camera_block;
+}
+
+bool hasSameCamera(const Options& options, const Options& other_options) {
+    return options.get<View::Option::CAMERA_POSITION>() == other_options.get<View::Option::CAMERA_POSITION>()
+        && options.get<View::Option::CENTER_POSITION>() == other_options.get<View::Option::CENTER_POSITION>()
+        && options.get<View::Option::UP_VECTOR>() == other_options.get<View::Option::UP_VECTOR>()
+        && options.get<View::Option::VERTICAL_FIELD_OF_VIEW>() == other_options.get<View::Option::VERTICAL_FIELD_OF_VIEW>();
+}
 }
 }
@@ -1,49 +1,731 @@
 #include "VFRendering/VectorField.hxx"
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+
+#include "HalfFloat.hxx"
+#include "Hash.hxx"
+#include "ThreadPool.hxx"
 
 namespace VFRendering {
-VectorField::VectorField(const Geometry& geometry, const std::vector<glm::vec3>& vectors) : m_geometry(geometry), m_vectors(vectors) {
+// the number of vectors per block of the content hashes and statistics,
+// which are calculated again as a whole if any of their vectors changed
+static const Geometry::index_type vector_block_size = 16384;
+
+glm::dvec3 VectorField::Statistics::mean() const {
+    if (num_vectors == 0) {
+        return glm::dvec3(0);
+    }
+    return sum / static_cast<double>(num_vectors);
+}
+
+VectorField::InstanceId::InstanceId() {
+    static std::atomic<std::uint64_t> next_instance_id{0};
+    value = next_instance_id++;
+}
+
+VectorField::VectorField(const Geometry& geometry, const std::vector<glm::vec3>& vectors) : m_geometry(Geometry::shared(geometry)), m_vectors(vectors) {
     m_vectors_update_id++;
     m_geometry_update_id++;
+    m_changed_vector_ranges_since = m_vectors_update_id;
 }
 
 VectorField::~VectorField() {}
 
 void VectorField::update(const Geometry& geometry, const std::vector<glm::vec3>& vectors) {
-    m_geometry = geometry;
-    m_vectors = vectors;
-    m_vectors_update_id++;
-    m_geometry_update_id++;
+    updateGeometry(geometry);
+    updateVectors(vectors);
 }
 
 void VectorField::updateGeometry(const Geometry& geometry) {
-    m_geometry = geometry;
+    // keep the current geometry and its lazily calculated indices if it is
+    // equal to the new one, so that renderers do not need to update it
+    if (geometry == m_geometry) {
+        return;
+    }
+    if (geometry.hasSameTopology(m_geometry) && geometry.numPositions() == m_geometry.numPositions()) {
+        m_geometry = geometry;
+        m_positions_update_id++;
+        return;
+    }
+    m_geometry = Geometry::shared(geometry);
     m_geometry_update_id++;
 }
 
+void VectorField::updatePositions(const std::vector<glm::vec3>& positions) {
+    Geometry geometry = m_geometry.withPositions(positions);
+    if (!geometry.hasSameTopology(m_geometry)) {
+        updateGeometry(geometry);
+        return;
+    }
+    // comparing the geometries would hash all positions, which are most
+    // likely to have changed anyway
+    m_geometry = geometry;
+    m_positions_update_id++;
+}
+
+void VectorField::updatePositions(Geometry::index_type first, Geometry::index_type count, const glm::vec3* positions) {
+    const Geometry::index_type num_positions = m_geometry.numPositions();
+    if (first + count > num_positions) {
+        // the kept positions are copied directly, as positions() would
+        // materialize and cache them for implicit geometries
+        std::vector<glm::vec3> new_positions(first + count);
+        m_geometry.copyPositions(0, std::min(first, num_positions), new_positions.data());
+        std::copy(positions, positions + count, new_positions.begin() + first);
+        updateGeometry(Geometry(new_positions, {}, {}, m_geometry.is2d()));
+        return;
+    }
+    m_geometry = m_geometry.withPositions(first, count, positions);
+    m_positions_update_id++;
+}
+
 void VectorField::updateVectors(const std::vector<glm::vec3>& vectors) {
+    if (m_direction_encoding != DirectionEncoding::FLOAT) {
+        // encode the vectors without copying them first
+        updateVectors(reinterpret_cast<const float*>(vectors.data()), vectors.size());
+        return;
+    }
     m_vectors = vectors;
+    m_external_vectors = nullptr;
+    vectorsHaveChanged();
+}
+
+void VectorField::updateVectors(const float* vectors, Geometry::index_type count, std::size_t stride) {
+    m_vectors.clear();
+    m_external_vectors = vectors;
+    m_external_vectors_are_double = false;
+    m_external_vectors_stride = stride;
+    m_num_external_vectors = count;
+    m_are_external_vectors_copied = false;
+    vectorsHaveChanged();
+}
+
+void VectorField::updateVectors(const double* vectors, Geometry::index_type count, std::size_t stride) {
+    m_vectors.clear();
+    m_external_vectors = vectors;
+    m_external_vectors_are_double = true;
+    m_external_vectors_stride = stride;
+    m_num_external_vectors = count;
+    m_are_external_vectors_copied = false;
+    vectorsHaveChanged();
+}
+
+void VectorField::updateVectors(Geometry::index_type first, Geometry::index_type count, const glm::vec3* vectors) {
+    bool is_encoded = (m_direction_encoding != DirectionEncoding::FLOAT);
+    if (is_encoded && !vectors) {
+        // encoded vectors do not refer to caller-owned memory, so there is
+        // nothing that could have changed
+        throw std::invalid_argument("VectorField::updateVectors: vectors must not be nullptr with a direction encoding other than FLOAT");
+    }
+    bool exceeds_magnitude_scale = false;
+    if (m_direction_encoding == DirectionEncoding::OCTAHEDRAL_WITH_MAGNITUDE) {
+        for (Geometry::index_type i = 0; i < count; i++) {
+            exceeds_magnitude_scale = exceeds_magnitude_scale || glm::length(vectors[i]) > m_encoded_magnitude_scale;
+        }
+    }
+    if (first + count > numVectors() || exceeds_magnitude_scale) {
+        // the number of vectors or the magnitude scale changes, so this is
+        // not a partial update
+        std::vector<glm::vec3> new_vectors(directions());
+        new_vectors.resize(std::max(first + count, numVectors()));
+        if (vectors) {
+            std::copy(vectors, vectors + count, new_vectors.begin() + first);
+        }
+        updateVectors(new_vectors);
+        return;
+    }
+    if (is_encoded) {
+        encodeVectors(first, count, vectors);
+        m_are_encoded_vectors_decoded = false;
+    } else if (vectors) {
+        if (m_external_vectors) {
+            directions();
+            m_external_vectors = nullptr;
+        }
+        std::copy(vectors, vectors + count, m_vectors.begin() + first);
+    } else if (m_external_vectors) {
+        m_are_external_vectors_copied = false;
+    }
+    if (is_encoded) {
+        // the hashes are of the unencoded vectors, which are not kept
+        m_vector_block_hashes.clear();
+    } else if (m_vector_block_hashes.size() == (numVectors() + vector_block_size - 1) / vector_block_size) {
+        Geometry::index_type last_block = (first + count + vector_block_size - 1) / vector_block_size;
+        for (Geometry::index_type i = first / vector_block_size; i < last_block; i++) {
+            m_vector_block_hashes[i] = hashVectorBlock(i);
+        }
+    }
     m_vectors_update_id++;
+    addChangedVectorRange(first, count);
+}
+
+void VectorField::addChangedVectorRange(Geometry::index_type first, Geometry::index_type count) const {
+    m_changed_vector_ranges.push_back({m_vectors_update_id, {{first, count}}});
+    // forget old ranges, renderers that have not seen them yet will upload
+    // all vectors instead
+    const std::size_t max_changed_vector_ranges = 1024;
+    if (m_changed_vector_ranges.size() > max_changed_vector_ranges) {
+        auto last_forgotten = m_changed_vector_ranges.begin() + max_changed_vector_ranges / 2;
+        m_changed_vector_ranges_since = last_forgotten->first;
+        m_changed_vector_ranges.erase(m_changed_vector_ranges.begin(), last_forgotten + 1);
+    }
+}
+
+void VectorField::publishVectors(const glm::vec3* vectors, Geometry::index_type count) {
+    auto& published_vectors = m_published_vectors;
+    published_vectors.slots[published_vectors.producer_slot].assign(vectors, vectors + count);
+    // swap the producer slot with the latest slot, which is either unused or
+    // holds an older snapshot that was not acquired in time
+    unsigned int latest_slot = published_vectors.latest_slot.exchange(published_vectors.producer_slot | PublishedVectors::is_new_flag, std::memory_order_acq_rel);
+    published_vectors.producer_slot = latest_slot & ~PublishedVectors::is_new_flag;
+}
+
+void VectorField::publishVectors(const std::vector<glm::vec3>& vectors) {
+    publishVectors(vectors.data(), vectors.size());
+}
+
+bool VectorField::acquirePublishedVectors() const {
+    auto& published_vectors = m_published_vectors;
+    if (!(published_vectors.latest_slot.load(std::memory_order_relaxed) & PublishedVectors::is_new_flag)) {
+        return false;
+    }
+    unsigned int latest_slot = published_vectors.latest_slot.exchange(published_vectors.consumer_slot, std::memory_order_acq_rel);
+    published_vectors.consumer_slot = latest_slot & ~PublishedVectors::is_new_flag;
+    // the previous vectors are left in the slot and overwritten later on
+    m_vectors.swap(published_vectors.slots[published_vectors.consumer_slot]);
+    m_external_vectors = nullptr;
+    vectorsHaveChanged();
+    return true;
+}
+
+void VectorField::setDirectionEncoding(DirectionEncoding direction_encoding) {
+    if (direction_encoding == m_direction_encoding) {
+        return;
+    }
+    if (m_direction_encoding != DirectionEncoding::FLOAT) {
+        directions();
+        m_are_encoded_vectors_decoded = false;
+        std::vector<std::int16_t>().swap(m_encoded_vectors);
+        m_num_encoded_vectors = 0;
+    }
+    m_direction_encoding = direction_encoding;
+    // the vectors need to be encoded and uploaded again
+    m_vector_block_hashes.clear();
+    vectorsHaveChanged();
+    if (m_direction_encoding != DirectionEncoding::FLOAT) {
+        std::vector<glm::vec3>().swap(m_vectors);
+    }
 }
 
+VectorField::DirectionEncoding VectorField::directionEncoding() const {
+    return m_direction_encoding;
+}
+
+const std::int16_t* VectorField::encodedVectorsData() const {
+    if (m_direction_encoding == DirectionEncoding::FLOAT) {
+        return nullptr;
+    }
+    return m_encoded_vectors.data();
+}
+
+unsigned int VectorField::numEncodedComponents() const {
+    switch (m_direction_encoding) {
+    case DirectionEncoding::OCTAHEDRAL:
+        return 2;
+    case DirectionEncoding::OCTAHEDRAL_WITH_MAGNITUDE:
+    case DirectionEncoding::HALF_FLOAT:
+        return 3;
+    default:
+        return 0;
+    }
+}
+
+float VectorField::encodedMagnitudeScale() const {
+    return m_encoded_magnitude_scale;
+}
+
+void VectorField::setPositionEncoding(PositionEncoding position_encoding) {
+    if (position_encoding == m_position_encoding) {
+        return;
+    }
+    m_position_encoding = position_encoding;
+    // renderers need to upload the positions again
+    m_geometry_update_id++;
+}
+
+VectorField::PositionEncoding VectorField::positionEncoding() const {
+    return m_position_encoding;
+}
+
+void VectorField::updateChannel(const std::string& name, const std::vector<float>& values) {
+    updateChannel(name, 1, values.data(), values.size());
+}
+
+void VectorField::updateChannel(const std::string& name, const std::vector<glm::vec3>& values) {
+    updateChannel(name, 3, reinterpret_cast<const float*>(values.data()), 3 * values.size());
+}
+
+void VectorField::updateChannel(const std::string& name, unsigned int num_components, const float* values, std::size_t num_values) {
+    auto channel = m_channels.find(name);
+    if (channel == m_channels.end()) {
+        channel = m_channels.insert({name, Channel()}).first;
+        m_channels_layout_id++;
+    } else if (channel->second.num_components != num_components) {
+        m_channels_layout_id++;
+    }
+    channel->second.num_components = num_components;
+    channel->second.values.assign(values, values + num_values);
+    channel->second.update_id = ++m_channels_update_id;
+}
+
+void VectorField::removeChannel(const std::string& name) {
+    if (m_channels.erase(name)) {
+        m_channels_layout_id++;
+        m_channels_update_id++;
+    }
+}
+
+std::vector<std::string> VectorField::channelNames() const {
+    std::vector<std::string> names;
+    for (const auto& channel : m_channels) {
+        names.push_back(channel.first);
+    }
+    return names;
+}
+
+unsigned int VectorField::channelNumComponents(const std::string& name) const {
+    auto channel = m_channels.find(name);
+    if (channel == m_channels.end()) {
+        return 0;
+    }
+    return channel->second.num_components;
+}
+
+const std::vector<float>& VectorField::channelValues(const std::string& name) const {
+    static const std::vector<float> no_values;
+    auto channel = m_channels.find(name);
+    if (channel == m_channels.end()) {
+        return no_values;
+    }
+    return channel->second.values;
+}
+
+unsigned long VectorField::channelUpdateId(const std::string& name) const {
+    auto channel = m_channels.find(name);
+    if (channel == m_channels.end()) {
+        return 0;
+    }
+    return channel->second.update_id;
+}
+
+unsigned long VectorField::channelsUpdateId() const {
+    return m_channels_update_id;
+}
+
+unsigned long VectorField::channelsLayoutId() const {
+    return m_channels_layout_id;
+}
+
+void VectorField::vectorsHaveChanged() const {
+    // compare the hashes of blocks of vectors with those of the previous
+    // vectors, so that unchanged vectors are neither encoded nor uploaded
+    // again
+    const Geometry::index_type count = m_external_vectors ? m_num_external_vectors : m_vectors.size();
+    const std::size_t num_blocks = (count + vector_block_size - 1) / vector_block_size;
+    std::vector<std::uint64_t> block_hashes(num_blocks);
+    Utilities::parallelFor(0, num_blocks, [this, &block_hashes](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) {
+            block_hashes[i] = hashVectorBlock(i);
+        }
+    }, 1);
+    bool have_all_changed = (m_vector_block_hashes.size() != num_blocks || m_num_hashed_vectors != count);
+    std::vector<std::array<Geometry::index_type, 2>> changed_ranges;
+    if (!have_all_changed) {
+        for (std::size_t i = 0; i < num_blocks; i++) {
+            if (block_hashes[i] == m_vector_block_hashes[i]) {
+                continue;
+            }
+            Geometry::index_type first = i * vector_block_size;
+            Geometry::index_type block_count = std::min(vector_block_size, count - first);
+            if (!changed_ranges.empty() && changed_ranges.back()[0] + changed_ranges.back()[1] == first) {
+                changed_ranges.back()[1] += block_count;
+            } else {
+                changed_ranges.push_back({{first, block_count}});
+            }
+        }
+    }
+    m_vector_block_hashes.swap(block_hashes);
+    m_num_hashed_vectors = count;
+
+    if (m_direction_encoding != DirectionEncoding::FLOAT) {
+        m_num_encoded_vectors = count;
+        m_encoded_vectors.resize(count * numEncodedComponents());
+        if (m_direction_encoding == DirectionEncoding::OCTAHEDRAL_WITH_MAGNITUDE) {
+            float previous_magnitude_scale = m_encoded_magnitude_scale;
+            m_encoded_magnitude_scale = 0;
+            std::mutex mutex;
+            Utilities::parallelFor(0, count, [this, &mutex](std::size_t begin, std::size_t end) {
+                std::vector<glm::vec3> block(end - begin);
+                copyUnencodedVectors(begin, end - begin, block.data());
+                float max_length = 0;
+                for (const auto& vector : block) {
+                    max_length = std::max(max_length, glm::length(vector));
+                }
+                std::lock_guard<std::mutex> lock(mutex);
+                m_encoded_magnitude_scale = std::max(m_encoded_magnitude_scale, max_length);
+            });
+            // all magnitudes are relative to the scale
+            have_all_changed = have_all_changed || (m_encoded_magnitude_scale != previous_magnitude_scale);
+        }
+        if (have_all_changed) {
+            changed_ranges.assign(1, {{0, count}});
+        }
+        for (const auto& range : changed_ranges) {
+            Utilities::parallelFor(range[0], range[0] + range[1], [this](std::size_t begin, std::size_t end) {
+                std::vector<glm::vec3> block(end - begin);
+                copyUnencodedVectors(begin, end - begin, block.data());
+                encodeVectors(begin, end - begin, block.data());
+            });
+        }
+        // only the encoded vectors are kept
+        m_vectors.clear();
+        m_external_vectors = nullptr;
+        m_are_encoded_vectors_decoded = false;
+    }
+    if (have_all_changed) {
+        m_vectors_update_id++;
+        m_changed_vector_ranges.clear();
+        m_changed_vector_ranges_since = m_vectors_update_id;
+    } else if (!changed_ranges.empty()) {
+        m_vectors_update_id++;
+        for (const auto& range : changed_ranges) {
+            addChangedVectorRange(range[0], range[1]);
+        }
+    }
+}
+
+std::uint64_t VectorField::hashVectorBlock(std::size_t block) const {
+    const Geometry::index_type first = block * vector_block_size;
+    const Geometry::index_type count = std::min(vector_block_size, (m_external_vectors ? m_num_external_vectors : static_cast<Geometry::index_type>(m_vectors.size())) - first);
+    if (!m_external_vectors || m_are_external_vectors_copied) {
+        return Utilities::hash(m_vectors.data() + first, count * sizeof(glm::vec3));
+    }
+    if (!m_external_vectors_are_double && m_external_vectors_stride == sizeof(glm::vec3)) {
+        return Utilities::hash(static_cast<const glm::vec3*>(m_external_vectors) + first, count * sizeof(glm::vec3));
+    }
+    // other vectors are hashed as they are uploaded
+    std::vector<glm::vec3> vectors(count);
+    copyUnencodedVectors(first, count, vectors.data());
+    return Utilities::hash(vectors.data(), count * sizeof(glm::vec3));
+}
+
+// Octahedral encoding maps unit vectors onto the faces of an octahedron,
+// which is then unfolded into the square [-1, 1]^2 and stored as signed
+// normalized 16 bit integers. The code (0, 0) is reserved for zero vectors,
+// so vectors close to +z that would be rounded to it use (1, 0) instead. The
+// loops are kept free of branches, so that compilers can vectorize them.
+void VectorField::encodeVectors(Geometry::index_type first, Geometry::index_type count, const glm::vec3* vectors) const {
+    if (m_direction_encoding == DirectionEncoding::HALF_FLOAT) {
+        Utilities::floatsToHalfs(&vectors[0].x, 3 * count, reinterpret_cast<std::uint16_t*>(m_encoded_vectors.data() + 3 * first));
+        return;
+    }
+    const unsigned int num_components = numEncodedComponents();
+    const bool has_magnitude = (num_components == 3);
+    const float magnitude_factor = (m_encoded_magnitude_scale > 0) ? 32767.0f / m_encoded_magnitude_scale : 0.0f;
+    std::int16_t* destination = m_encoded_vectors.data() + first * num_components;
+    for (Geometry::index_type i = 0; i < count; i++) {
+        const glm::vec3& vector = vectors[i];
+        float l1_norm = std::abs(vector.x) + std::abs(vector.y) + std::abs(vector.z);
+        float inverse_l1_norm = (l1_norm > 0) ? 1.0f / l1_norm : 0.0f;
+        float x = vector.x * inverse_l1_norm;
+        float y = vector.y * inverse_l1_norm;
+        // fold the lower hemisphere over the diagonals
+        float folded_x = std::copysign(1.0f - std::abs(y), x);
+        float folded_y = std::copysign(1.0f - std::abs(x), y);
+        bool is_lower = (vector.z < 0);
+        x = is_lower ? folded_x : x;
+        y = is_lower ? folded_y : y;
+        std::int16_t encoded_x = static_cast<std::int16_t>(x * 32767.0f + std::copysign(0.5f, x));
+        std::int16_t encoded_y = static_cast<std::int16_t>(y * 32767.0f + std::copysign(0.5f, y));
+        encoded_x |= static_cast<std::int16_t>(encoded_x == 0 && encoded_y == 0 && l1_norm > 0);
+        destination[i * num_components + 0] = encoded_x;
+        destination[i * num_components + 1] = encoded_y;
+        if (has_magnitude) {
+            float magnitude = std::min(glm::length(vector) * magnitude_factor, 32767.0f);
+            destination[i * num_components + 2] = static_cast<std::int16_t>(magnitude + 0.5f);
+        }
+    }
+}
+
+void VectorField::decodeVectors(Geometry::index_type first, Geometry::index_type count, glm::vec3* destination) const {
+    if (m_direction_encoding == DirectionEncoding::HALF_FLOAT) {
+        Utilities::halfsToFloats(reinterpret_cast<const std::uint16_t*>(m_encoded_vectors.data() + 3 * first), 3 * count, &destination[0].x);
+        return;
+    }
+    const unsigned int num_components = numEncodedComponents();
+    const bool has_magnitude = (num_components == 3);
+    const float magnitude_factor = m_encoded_magnitude_scale / 32767.0f;
+    const std::int16_t* source = m_encoded_vectors.data() + first * num_components;
+    for (Geometry::index_type i = 0; i < count; i++) {
+        float x = std::max(source[i * num_components + 0] / 32767.0f, -1.0f);
+        float y = std::max(source[i * num_components + 1] / 32767.0f, -1.0f);
+        float z = 1.0f - std::abs(x) - std::abs(y);
+        float t = std::max(-z, 0.0f);
+        x -= std::copysign(t, x);
+        y -= std::copysign(t, y);
+        bool is_zero = (source[i * num_components + 0] == 0 && source[i * num_components + 1] == 0);
+        glm::vec3 vector = is_zero ? glm::vec3(0, 0, 0) : glm::normalize(glm::vec3(x, y, z));
+        if (has_magnitude) {
+            vector *= source[i * num_components + 2] * magnitude_factor;
+        }
+        destination[i] = vector;
+    }
+}
+
+const VectorField::Statistics& VectorField::statistics() const {
+    if (m_statistics_update_id == m_vectors_update_id) {
+        return m_statistics;
+    }
+    const Geometry::index_type num_vectors = numVectors();
+    const std::size_t num_blocks = (num_vectors + vector_block_size - 1) / vector_block_size;
+    std::vector<std::size_t> changed_blocks;
+    std::vector<std::array<Geometry::index_type, 2>> ranges;
+    if (m_statistics_update_id > 0 && m_block_statistics.size() == num_blocks && m_statistics.num_vectors == num_vectors && changedVectorRanges(m_statistics_update_id, ranges)) {
+        for (const auto& range : ranges) {
+            if (range[1] == 0) {
+                continue;
+            }
+            std::size_t first_block = range[0] / vector_block_size;
+            std::size_t last_block = (range[0] + range[1] - 1) / vector_block_size;
+            // ranges are sorted, so blocks are only added once
+            if (!changed_blocks.empty() && changed_blocks.back() >= first_block) {
+                first_block = changed_blocks.back() + 1;
+            }
+            for (std::size_t i = first_block; i <= last_block; i++) {
+                changed_blocks.push_back(i);
+            }
+        }
+    } else {
+        m_block_statistics.assign(num_blocks, Statistics());
+        changed_blocks.resize(num_blocks);
+        for (std::size_t i = 0; i < num_blocks; i++) {
+            changed_blocks[i] = i;
+        }
+    }
+    Utilities::parallelFor(0, changed_blocks.size(), [this, &changed_blocks, num_vectors](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) {
+            const Geometry::index_type first = changed_blocks[i] * vector_block_size;
+            calculateStatistics(first, std::min(vector_block_size, num_vectors - first), m_block_statistics[changed_blocks[i]]);
+        }
+    }, 1);
+    // combining the blocks is cheap compared to calculating their statistics
+    Statistics statistics;
+    for (const auto& block_statistics : m_block_statistics) {
+        if (statistics.num_vectors == 0) {
+            statistics.min = block_statistics.min;
+            statistics.max = block_statistics.max;
+            statistics.min_length = block_statistics.min_length;
+            statistics.max_length = block_statistics.max_length;
+        } else {
+            statistics.min = glm::min(statistics.min, block_statistics.min);
+            statistics.max = glm::max(statistics.max, block_statistics.max);
+            statistics.min_length = std::min(statistics.min_length, block_statistics.min_length);
+            statistics.max_length = std::max(statistics.max_length, block_statistics.max_length);
+        }
+        statistics.num_vectors += block_statistics.num_vectors;
+        statistics.sum += block_statistics.sum;
+        for (unsigned int i = 0; i < Statistics::num_histogram_bins; i++) {
+            statistics.z_histogram[i] += block_statistics.z_histogram[i];
+            statistics.azimuth_histogram[i] += block_statistics.azimuth_histogram[i];
+        }
+    }
+    m_statistics = statistics;
+    m_statistics_update_id = m_vectors_update_id;
+    return m_statistics;
+}
+
+// The minimum, maximum, sum and lengths are calculated in loops without
+// branches, so that compilers can vectorize them.
+void VectorField::calculateStatistics(Geometry::index_type first, Geometry::index_type count, Statistics& statistics) const {
+    statistics = Statistics();
+    if (count == 0) {
+        return;
+    }
+    std::vector<glm::vec3> copied_vectors;
+    const glm::vec3* vectors = vectorsData();
+    if (vectors) {
+        vectors += first;
+    } else {
+        copied_vectors.resize(count);
+        copyVectors(first, count, copied_vectors.data());
+        vectors = copied_vectors.data();
+    }
+    statistics.num_vectors = count;
+    glm::vec3 min = vectors[0];
+    glm::vec3 max = vectors[0];
+    glm::dvec3 sum(0);
+    for (Geometry::index_type i = 0; i < count; i++) {
+        min = glm::min(min, vectors[i]);
+        max = glm::max(max, vectors[i]);
+        sum += glm::dvec3(vectors[i]);
+    }
+    statistics.min = min;
+    statistics.max = max;
+    statistics.sum = sum;
+    std::vector<float> lengths(count);
+    for (Geometry::index_type i = 0; i < count; i++) {
+        lengths[i] = glm::length(vectors[i]);
+    }
+    statistics.min_length = *std::min_element(lengths.begin(), lengths.end());
+    statistics.max_length = *std::max_element(lengths.begin(), lengths.end());
+    // bins are calculated first and vectors of length zero are put into an
+    // additional bin, which is not part of the histograms
+    const unsigned int num_bins = Statistics::num_histogram_bins;
+    const float pi = 3.14159265358979f;
+    std::vector<unsigned int> z_bins(count);
+    std::vector<unsigned int> azimuth_bins(count);
+    for (Geometry::index_type i = 0; i < count; i++) {
+        const glm::vec3& vector = vectors[i];
+        float z = vector.z / std::max(lengths[i], std::numeric_limits<float>::min());
+        // a polynomial approximation of atan2 with an error below 1e-5
+        float abs_x = std::abs(vector.x);
+        float abs_y = std::abs(vector.y);
+        float a = std::min(abs_x, abs_y) / std::max(std::max(abs_x, abs_y), std::numeric_limits<float>::min());
+        float s = a * a;
+        float azimuth = ((((0.0208351f * s - 0.0851330f) * s + 0.1801410f) * s - 0.3302995f) * s + 0.9998660f) * a;
+        azimuth = (abs_y > abs_x) ? 0.5f * pi - azimuth : azimuth;
+        azimuth = (vector.x < 0) ? pi - azimuth : azimuth;
+        azimuth = std::copysign(azimuth, vector.y);
+        float z_bin = std::min(std::max((z * 0.5f + 0.5f) * num_bins, 0.0f), num_bins - 1.0f);
+        float azimuth_bin = std::min(std::max((azimuth / pi * 0.5f + 0.5f) * num_bins, 0.0f), num_bins - 1.0f);
+        bool is_counted = (lengths[i] > 0);
+        z_bins[i] = is_counted ? static_cast<unsigned int>(z_bin) : num_bins;
+        azimuth_bins[i] = is_counted ? static_cast<unsigned int>(azimuth_bin) : num_bins;
+    }
+    std::array<Geometry::index_type, num_bins + 1> z_histogram = {{}};
+    std::array<Geometry::index_type, num_bins + 1> azimuth_histogram = {{}};
+    for (Geometry::index_type i = 0; i < count; i++) {
+        z_histogram[z_bins[i]]++;
+        azimuth_histogram[azimuth_bins[i]]++;
+    }
+    std::copy(z_histogram.begin(), z_histogram.begin() + num_bins, statistics.z_histogram.begin());
+    std::copy(azimuth_histogram.begin(), azimuth_histogram.begin() + num_bins, statistics.azimuth_histogram.begin());
+}
 
 unsigned long VectorField::geometryUpdateId() const {
     return m_geometry_update_id;
 }
 
+unsigned long VectorField::positionsUpdateId() const {
+    return m_positions_update_id;
+}
+
 unsigned long VectorField::vectorsUpdateId() const {
     return m_vectors_update_id;
 }
 
+bool VectorField::changedVectorRanges(unsigned long since_update_id, std::vector<std::array<Geometry::index_type, 2>>& ranges) const {
+    ranges.clear();
+    if (since_update_id < m_changed_vector_ranges_since) {
+        return false;
+    }
+    for (const auto& changed_range : m_changed_vector_ranges) {
+        if (changed_range.first > since_update_id) {
+            ranges.push_back(changed_range.second);
+        }
+    }
+    std::sort(ranges.begin(), ranges.end());
+    // merge overlapping and adjacent ranges
+    std::size_t num_merged_ranges = 0;
+    for (const auto& range : ranges) {
+        if (num_merged_ranges > 0 && range[0] <= ranges[num_merged_ranges - 1][0] + ranges[num_merged_ranges - 1][1]) {
+            auto& merged_range = ranges[num_merged_ranges - 1];
+            merged_range[1] = std::max(merged_range[0] + merged_range[1], range[0] + range[1]) - merged_range[0];
+        } else {
+            ranges[num_merged_ranges++] = range;
+        }
+    }
+    ranges.resize(num_merged_ranges);
+    return true;
+}
+
+const Geometry& VectorField::geometry() const {
+    return m_geometry;
+}
+
 const std::vector<glm::vec3>& VectorField::positions() const {
     return m_geometry.positions();
 }
 
 const std::vector<glm::vec3>& VectorField::directions() const {
+    if (m_direction_encoding != DirectionEncoding::FLOAT) {
+        if (!m_are_encoded_vectors_decoded) {
+            m_vectors.resize(m_num_encoded_vectors);
+            Utilities::parallelFor(0, m_vectors.size(), [this](std::size_t begin, std::size_t end) {
+                decodeVectors(begin, end - begin, m_vectors.data() + begin);
+            });
+            m_are_encoded_vectors_decoded = true;
+        }
+    } else if (m_external_vectors && !m_are_external_vectors_copied) {
+        m_vectors.resize(m_num_external_vectors);
+        copyVectors(0, m_num_external_vectors, m_vectors.data());
+        m_are_external_vectors_copied = true;
+    }
     return m_vectors;
 }
 
+Geometry::index_type VectorField::numVectors() const {
+    if (m_direction_encoding != DirectionEncoding::FLOAT) {
+        return m_num_encoded_vectors;
+    }
+    if (m_external_vectors) {
+        return m_num_external_vectors;
+    }
+    return m_vectors.size();
+}
+
+void VectorField::copyVectors(Geometry::index_type first, Geometry::index_type count, glm::vec3* destination) const {
+    if (m_direction_encoding != DirectionEncoding::FLOAT) {
+        decodeVectors(first, count, destination);
+        return;
+    }
+    copyUnencodedVectors(first, count, destination);
+}
+
+void VectorField::copyUnencodedVectors(Geometry::index_type first, Geometry::index_type count, glm::vec3* destination) const {
+    if (!m_external_vectors || m_are_external_vectors_copied) {
+        std::copy(m_vectors.begin() + first, m_vectors.begin() + first + count, destination);
+        return;
+    }
+    const char* vector = static_cast<const char*>(m_external_vectors) + first * m_external_vectors_stride;
+    for (Geometry::index_type i = 0; i < count; i++, vector += m_external_vectors_stride) {
+        if (m_external_vectors_are_double) {
+            const double* components = reinterpret_cast<const double*>(vector);
+            destination[i] = {components[0], components[1], components[2]};
+        } else {
+            const float* components = reinterpret_cast<const float*>(vector);
+            destination[i] = {components[0], components[1], components[2]};
+        }
+    }
+}
+
+const glm::vec3* VectorField::vectorsData() const {
+    if (m_direction_encoding != DirectionEncoding::FLOAT) {
+        return nullptr;
+    }
+    if (!m_external_vectors || m_are_external_vectors_copied) {
+        return m_vectors.data();
+    }
+    if (!m_external_vectors_are_double && m_external_vectors_stride == sizeof(glm::vec3)) {
+        return static_cast<const glm::vec3*>(m_external_vectors);
+    }
+    return nullptr;
+}
+
 const std::vector<std::array<Geometry::index_type, 3>>& VectorField::surfaceIndices() const {
     return m_geometry.surfaceIndices();
 }
@@ -1,7 +1,104 @@
 #include "VFRendering/VectorFieldRenderer.hxx"
 
+#include <algorithm>
+#include <mutex>
+#include <utility>
+
+#include "GpuBuffer.hxx"
+#include "HalfFloat.hxx"
+#include "StreamingBuffer.hxx"
+#include "ThreadPool.hxx"
+#include "shaders/direction_decoding.glsl.hxx"
+#include "shaders/position_decoding.glsl.hxx"
+
+#ifndef __EMSCRIPTEN__
+#include <glad/glad.h>
+#else
+#include <GLES3/gl3.h>
+#endif
+
 namespace VFRendering {
-VectorFieldRenderer::VectorFieldRenderer(const View& view, const VectorField& vf)  : RendererBase(view), m_vf(vf) {}
+/** The buffers of a vector field shared by its renderers in a view, along
+ *  with the update ids of the data they contain. Buffers are created when
+ *  they are first bound and deleted with the last renderer using them.
+ */
+struct VectorFieldRenderer::SharedBuffers {
+    ~SharedBuffers();
+
+    Utilities::StreamingBuffer positions;
+    bool has_positions = false;
+    unsigned long geometry_update_id = 0;
+    unsigned long positions_update_id = 0;
+    std::unique_ptr<Utilities::GpuBuffer> position_brick_centers_buffer;
+    unsigned int position_brick_centers_texture = 0;
+    Utilities::StreamingBuffer directions;
+    bool has_directions = false;
+    unsigned long vectors_update_id = 0;
+    VectorField::DirectionEncoding direction_encoding = VectorField::DirectionEncoding::FLOAT;
+    // buffer and buffered update id of each channel
+    std::map<std::string, std::pair<std::unique_ptr<Utilities::GpuBuffer>, unsigned long>> channel_buffers;
+    Geometry::index_type num_channel_points = 0;
+};
+
+VectorFieldRenderer::SharedBuffers::~SharedBuffers() {
+    if (position_brick_centers_texture) {
+        glDeleteTextures(1, &position_brick_centers_texture);
+    }
+}
+
+VectorFieldRenderer::VectorFieldRenderer(const View& view, const VectorField& vf)  : RendererBase(view), m_vf(vf) {
+    static std::mutex registry_mutex;
+    // keyed by ids instead of addresses, which may be reused by a new view
+    // or vector field while renderers of the old one are still alive
+    static std::map<std::pair<std::uint64_t, std::uint64_t>, std::weak_ptr<SharedBuffers>> registry;
+
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    for (auto it = registry.begin(); it != registry.end();) {
+        if (it->second.expired()) {
+            it = registry.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    auto& shared_buffers = registry[{view.m_id, vf.m_instance_id.value}];
+    m_shared_buffers = shared_buffers.lock();
+    if (!m_shared_buffers) {
+        m_shared_buffers = std::make_shared<SharedBuffers>();
+        shared_buffers = m_shared_buffers;
+    }
+}
+
+VectorFieldRenderer::~VectorFieldRenderer() {
+    if (m_position_brick_centers_texture) {
+        glDeleteTextures(1, &m_position_brick_centers_texture);
+    }
+}
+
+std::size_t VectorFieldRenderer::gpuMemoryUsage() const {
+    std::map<const void*, std::size_t> shared_memory_usage;
+    sharedGpuMemoryUsage(shared_memory_usage);
+    std::size_t memory_usage = RendererBase::gpuMemoryUsage() + shared_memory_usage[m_shared_buffers.get()];
+    if (m_position_brick_centers_buffer) {
+        memory_usage += m_position_brick_centers_buffer->capacity();
+    }
+    return memory_usage;
+}
+
+void VectorFieldRenderer::sharedGpuMemoryUsage(std::map<const void*, std::size_t>& shared_memory_usage) const {
+    const SharedBuffers& buffers = *m_shared_buffers;
+    std::size_t memory_usage = buffers.positions.capacity() + buffers.directions.capacity();
+    if (buffers.position_brick_centers_buffer) {
+        memory_usage += buffers.position_brick_centers_buffer->capacity();
+    }
+    for (const auto& channel_buffer : buffers.channel_buffers) {
+        memory_usage += channel_buffer.second.first->capacity();
+    }
+    shared_memory_usage[&buffers] = memory_usage;
+}
+
+const Geometry& VectorFieldRenderer::geometry() const {
+    return m_vf.geometry();
+}
 
 const std::vector<glm::vec3>& VectorFieldRenderer::positions() const {
     return m_vf.positions();
@@ -19,15 +116,388 @@ const std::vector<std::array<Geometry::index_type, 4>>& VectorFieldRenderer::vol
     return m_vf.volumeIndices();
 }
 
+// Implicit geometries are generated into a small staging buffer and uploaded
+// chunk by chunk, so that they never exist as a whole in main memory. Each
+// chunk is generated in parallel.
+template<typename T, typename CopyFunction>
+static void bufferChunkedData(Utilities::GpuBuffer& buffer, Geometry::index_type count, CopyFunction copy) {
+    const Geometry::index_type chunk_size = 1 << 16;
+    buffer.resize(sizeof(T) * count);
+    std::vector<T> chunk(std::min(count, chunk_size));
+    for (Geometry::index_type first = 0; first < count; first += chunk_size) {
+        Geometry::index_type chunk_count = std::min(count - first, chunk_size);
+        Utilities::parallelFor(0, chunk_count, [&](std::size_t begin, std::size_t end) {
+            copy(first + begin, end - begin, chunk.data() + begin);
+        });
+        buffer.update(sizeof(T) * first, sizeof(T) * chunk_count, chunk.data());
+    }
+}
+
+// Vertex data is generated or copied in parallel directly into the mapped
+// memory of a streaming buffer, so that e.g. implicit geometries never exist
+// as a whole in main memory.
+template<typename T, typename CopyFunction>
+static void streamData(Utilities::StreamingBuffer& buffer, Geometry::index_type count, CopyFunction copy) {
+    T* destination = static_cast<T*>(buffer.map(sizeof(T) * count));
+    Utilities::parallelFor(0, count, [&](std::size_t begin, std::size_t end) {
+        copy(begin, end - begin, destination + begin);
+    });
+    buffer.unmap();
+}
+
+static const void* bufferOffset(std::size_t offset) {
+    return reinterpret_cast<const void*>(offset);
+}
+
+// Half float positions are stored relative to the center of their brick of
+// consecutive positions, which the vertex shaders look up in a buffer texture.
+static const Geometry::index_type position_brick_size = 64;
+
+template<typename CopyFunction>
+static void streamHalfFloatPositionData(Utilities::StreamingBuffer& buffer, Geometry::index_type count, CopyFunction copy, std::vector<glm::vec4>& brick_centers) {
+    std::uint16_t* destination = static_cast<std::uint16_t*>(buffer.map(3 * sizeof(std::uint16_t) * count));
+    Geometry::index_type num_bricks = (count + position_brick_size - 1) / position_brick_size;
+    brick_centers.resize(num_bricks);
+    Utilities::parallelFor(0, num_bricks, [&](std::size_t begin, std::size_t end) {
+        std::array<glm::vec3, position_brick_size> positions;
+        for (std::size_t brick = begin; brick < end; brick++) {
+            Geometry::index_type brick_first = brick * position_brick_size;
+            Geometry::index_type brick_count = std::min(count - brick_first, position_brick_size);
+            copy(brick_first, brick_count, positions.data());
+            glm::vec3 min_position = positions[0];
+            glm::vec3 max_position = positions[0];
+            for (Geometry::index_type i = 1; i < brick_count; i++) {
+                min_position = glm::min(min_position, positions[i]);
+                max_position = glm::max(max_position, positions[i]);
+            }
+            glm::vec3 center = 0.5f * (min_position + max_position);
+            for (Geometry::index_type i = 0; i < brick_count; i++) {
+                positions[i] -= center;
+            }
+            Utilities::floatsToHalfs(&positions[0].x, 3 * brick_count, destination + 3 * brick_first);
+            brick_centers[brick] = glm::vec4(center, 0);
+        }
+    }, 64);
+    buffer.unmap();
+}
+
+bool VectorFieldRenderer::hasHalfFloatPositions() const {
+#ifdef __EMSCRIPTEN__
+    // WebGL supports neither buffer textures nor gl_VertexID
+    return false;
+#else
+    return m_vf.positionEncoding() == VectorField::PositionEncoding::HALF_FLOAT;
+#endif
+}
+
+static void bufferPositionBrickCenters(const std::vector<glm::vec4>& brick_centers, std::unique_ptr<Utilities::GpuBuffer>& buffer, unsigned int& texture) {
+#ifndef __EMSCRIPTEN__
+    if (!buffer) {
+        buffer.reset(new Utilities::GpuBuffer(GL_TEXTURE_BUFFER));
+        glGenTextures(1, &texture);
+    }
+    buffer->upload(brick_centers);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_BUFFER, texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer->id());
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+#else
+    (void)brick_centers;
+    (void)buffer;
+    (void)texture;
+#endif
+}
+
+void VectorFieldRenderer::bindPositionData(unsigned int attribute_index) const {
+    SharedBuffers& buffers = *m_shared_buffers;
+    const Geometry& geometry = m_vf.geometry();
+    if (!buffers.has_positions || buffers.geometry_update_id != m_vf.geometryUpdateId() || buffers.positions_update_id != m_vf.positionsUpdateId()) {
+        buffers.has_positions = true;
+        buffers.geometry_update_id = m_vf.geometryUpdateId();
+        buffers.positions_update_id = m_vf.positionsUpdateId();
+        if (hasHalfFloatPositions()) {
+            std::vector<glm::vec4> brick_centers;
+            streamHalfFloatPositionData(buffers.positions, geometry.numPositions(), [&geometry](Geometry::index_type first, Geometry::index_type count, glm::vec3* destination) {
+                geometry.copyPositions(first, count, destination);
+            }, brick_centers);
+            bufferPositionBrickCenters(brick_centers, buffers.position_brick_centers_buffer, buffers.position_brick_centers_texture);
+        } else if (!geometry.isImplicit()) {
+            const glm::vec3* positions = geometry.positions().data();
+            streamData<glm::vec3>(buffers.positions, geometry.numPositions(), [positions](Geometry::index_type first, Geometry::index_type count, glm::vec3* destination) {
+                std::copy(positions + first, positions + first + count, destination);
+            });
+        } else {
+            streamData<glm::vec3>(buffers.positions, geometry.numPositions(), [&geometry](Geometry::index_type first, Geometry::index_type count, glm::vec3* destination) {
+                geometry.copyPositions(first, count, destination);
+            });
+        }
+    } else {
+        buffers.positions.bind();
+    }
+    if (hasHalfFloatPositions()) {
+        glVertexAttribPointer(attribute_index, 3, GL_HALF_FLOAT, false, 0, bufferOffset(buffers.positions.offset()));
+    } else {
+        glVertexAttribPointer(attribute_index, 3, GL_FLOAT, false, 0, bufferOffset(buffers.positions.offset()));
+    }
+}
+
+void VectorFieldRenderer::streamPositionData(Utilities::StreamingBuffer& buffer, unsigned int attribute_index, const std::vector<glm::vec3>& positions) const {
+    if (hasHalfFloatPositions()) {
+        std::vector<glm::vec4> brick_centers;
+        streamHalfFloatPositionData(buffer, positions.size(), [&positions](Geometry::index_type first, Geometry::index_type count, glm::vec3* destination) {
+            std::copy(positions.begin() + first, positions.begin() + first + count, destination);
+        }, brick_centers);
+        bufferPositionBrickCenters(brick_centers, m_position_brick_centers_buffer, m_position_brick_centers_texture);
+        glVertexAttribPointer(attribute_index, 3, GL_HALF_FLOAT, false, 0, bufferOffset(buffer.offset()));
+        return;
+    }
+    streamData<glm::vec3>(buffer, positions.size(), [&positions](Geometry::index_type first, Geometry::index_type count, glm::vec3* destination) {
+        std::copy(positions.begin() + first, positions.begin() + first + count, destination);
+    });
+    glVertexAttribPointer(attribute_index, 3, GL_FLOAT, false, 0, bufferOffset(buffer.offset()));
+}
+
+void VectorFieldRenderer::streamVectorData(Utilities::StreamingBuffer& buffer, unsigned int attribute_index, const std::vector<glm::vec3>& vectors) const {
+    if (m_vf.directionEncoding() == VectorField::DirectionEncoding::HALF_FLOAT) {
+        streamData<std::array<std::uint16_t, 3>>(buffer, vectors.size(), [&vectors](Geometry::index_type first, Geometry::index_type count, std::array<std::uint16_t, 3>* destination) {
+            Utilities::floatsToHalfs(&vectors[first].x, 3 * count, destination->data());
+        });
+        glVertexAttribPointer(attribute_index, 3, GL_HALF_FLOAT, false, 0, bufferOffset(buffer.offset()));
+        return;
+    }
+    streamData<glm::vec3>(buffer, vectors.size(), [&vectors](Geometry::index_type first, Geometry::index_type count, glm::vec3* destination) {
+        std::copy(vectors.begin() + first, vectors.begin() + first + count, destination);
+    });
+    glVertexAttribPointer(attribute_index, 3, GL_FLOAT, false, 0, bufferOffset(buffer.offset()));
+}
+
+Geometry::index_type VectorFieldRenderer::bufferSurfaceIndexData(Utilities::GpuBuffer& buffer) const {
+    const Geometry& geometry = m_vf.geometry();
+    if (!geometry.isImplicit()) {
+        const auto& surface_indices = geometry.surfaceIndices();
+        buffer.upload(surface_indices);
+        return surface_indices.size();
+    }
+    Geometry::index_type num_triangles = geometry.numSurfaceTriangles();
+    bufferChunkedData<std::array<Geometry::index_type, 3>>(buffer, num_triangles, [&geometry](Geometry::index_type first, Geometry::index_type count, std::array<Geometry::index_type, 3>* destination) {
+        geometry.copySurfaceIndices(first, count, destination);
+    });
+    return num_triangles;
+}
+
+void VectorFieldRenderer::bindDirectionData(unsigned int attribute_index) const {
+    SharedBuffers& buffers = *m_shared_buffers;
+    const glm::vec3* vectors = m_vf.vectorsData();
+    const std::int16_t* encoded_vectors = m_vf.encodedVectorsData();
+    const unsigned int num_encoded_components = m_vf.numEncodedComponents();
+    if (!buffers.has_directions || buffers.vectors_update_id != m_vf.vectorsUpdateId() || buffers.direction_encoding != m_vf.directionEncoding()) {
+        std::vector<std::array<Geometry::index_type, 2>> ranges;
+        unsigned long buffered_vectors_update_id = buffers.vectors_update_id;
+        bool is_buffer_valid = (buffers.has_directions && buffered_vectors_update_id != 0 && buffers.direction_encoding == m_vf.directionEncoding());
+        buffers.has_directions = true;
+        buffers.vectors_update_id = m_vf.vectorsUpdateId();
+        buffers.direction_encoding = m_vf.directionEncoding();
+        if (is_buffer_valid && m_vf.changedVectorRanges(buffered_vectors_update_id, ranges)) {
+            // only the changed ranges are written, the rest is copied from the
+            // current data on the GPU
+            const std::size_t vector_size = encoded_vectors ? sizeof(std::int16_t) * num_encoded_components : sizeof(glm::vec3);
+            std::vector<std::array<std::size_t, 2>> byte_ranges;
+            for (const auto& range : ranges) {
+                byte_ranges.push_back({{vector_size * range[0], vector_size * range[1]}});
+            }
+            char* data = static_cast<char*>(buffers.directions.mapRanges(byte_ranges));
+            for (const auto& range : ranges) {
+                if (encoded_vectors) {
+                    std::copy(encoded_vectors + num_encoded_components * range[0], encoded_vectors + num_encoded_components * (range[0] + range[1]), reinterpret_cast<std::int16_t*>(data + vector_size * range[0]));
+                } else if (vectors) {
+                    std::copy(vectors + range[0], vectors + range[0] + range[1], reinterpret_cast<glm::vec3*>(data + vector_size * range[0]));
+                } else {
+                    m_vf.copyVectors(range[0], range[1], reinterpret_cast<glm::vec3*>(data + vector_size * range[0]));
+                }
+            }
+            buffers.directions.unmap();
+        } else if (encoded_vectors) {
+            streamData<std::int16_t>(buffers.directions, num_encoded_components * m_vf.numVectors(), [encoded_vectors](Geometry::index_type first, Geometry::index_type count, std::int16_t* destination) {
+                std::copy(encoded_vectors + first, encoded_vectors + first + count, destination);
+            });
+        } else if (vectors) {
+            streamData<glm::vec3>(buffers.directions, m_vf.numVectors(), [vectors](Geometry::index_type first, Geometry::index_type count, glm::vec3* destination) {
+                std::copy(vectors + first, vectors + first + count, destination);
+            });
+        } else {
+            // strided or double precision vectors are converted while copying
+            const VectorField& vf = m_vf;
+            streamData<glm::vec3>(buffers.directions, vf.numVectors(), [&vf](Geometry::index_type first, Geometry::index_type count, glm::vec3* destination) {
+                vf.copyVectors(first, count, destination);
+            });
+        }
+    } else {
+        buffers.directions.bind();
+    }
+    if (m_vf.directionEncoding() == VectorField::DirectionEncoding::HALF_FLOAT) {
+        glVertexAttribPointer(attribute_index, num_encoded_components, GL_HALF_FLOAT, false, 0, bufferOffset(buffers.directions.offset()));
+    } else if (encoded_vectors) {
+        glVertexAttribPointer(attribute_index, num_encoded_components, GL_SHORT, true, 0, bufferOffset(buffers.directions.offset()));
+    } else {
+        glVertexAttribPointer(attribute_index, 3, GL_FLOAT, false, 0, bufferOffset(buffers.directions.offset()));
+    }
+}
+
+std::string VectorFieldRenderer::directionDecodingImplementation() const {
+    m_direction_encoding = m_vf.directionEncoding();
+    switch (m_direction_encoding) {
+    case VectorField::DirectionEncoding::OCTAHEDRAL:
+        return DIRECTION_DECODING_OCTAHEDRAL_GLSL;
+    case VectorField::DirectionEncoding::OCTAHEDRAL_WITH_MAGNITUDE:
+        return DIRECTION_DECODING_OCTAHEDRAL_WITH_MAGNITUDE_GLSL;
+    default:
+        // half floats are converted when they are read as attributes
+        return DIRECTION_DECODING_FLOAT_GLSL;
+    }
+}
+
+std::string VectorFieldRenderer::positionDecodingImplementation() const {
+    m_position_encoding = m_vf.positionEncoding();
+    if (hasHalfFloatPositions()) {
+        return "const int POSITION_BRICK_SIZE = " + std::to_string(position_brick_size) + ";\n" + POSITION_DECODING_HALF_FLOAT_GLSL;
+    }
+    return POSITION_DECODING_FLOAT_GLSL;
+}
+
+void VectorFieldRenderer::resolveDecodingUniforms(unsigned int program) {
+    m_direction_magnitude_scale_location = glGetUniformLocation(program, "uDirectionMagnitudeScale");
+    m_position_brick_centers_location = glGetUniformLocation(program, "uPositionBrickCenters");
+}
+
+void VectorFieldRenderer::setDecodingUniforms() const {
+    if (m_vf.directionEncoding() == VectorField::DirectionEncoding::OCTAHEDRAL_WITH_MAGNITUDE) {
+        glUniform1f(m_direction_magnitude_scale_location, m_vf.encodedMagnitudeScale());
+    }
+#ifndef __EMSCRIPTEN__
+    if (hasHalfFloatPositions()) {
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_BUFFER, m_position_brick_centers_texture ? m_position_brick_centers_texture : m_shared_buffers->position_brick_centers_texture);
+        glUniform1i(m_position_brick_centers_location, 0);
+    }
+#endif
+}
+
+std::string VectorFieldRenderer::channelsImplementation(ChannelSource source) const {
+    m_channels_layout_id = m_vf.channelsLayoutId();
+    std::string declarations;
+    std::string implementation = "void loadChannels() {\n";
+    for (const auto& name : m_vf.channelNames()) {
+        std::string type = (m_vf.channelNumComponents(name) == 3) ? "vec3" : "float";
+        declarations += type + " " + name + ";\n";
+        switch (source) {
+        case ChannelSource::ATTRIBUTES:
+            declarations += "in " + type + " ivChannel_" + name + ";\n";
+            declarations += "out " + type + " vfChannel_" + name + ";\n";
+            implementation += "  " + name + " = ivChannel_" + name + ";\n";
+            implementation += "  vfChannel_" + name + " = " + name + ";\n";
+            break;
+        case ChannelSource::VARYINGS:
+            declarations += "in " + type + " vfChannel_" + name + ";\n";
+            implementation += "  " + name + " = vfChannel_" + name + ";\n";
+            break;
+        case ChannelSource::NONE:
+            implementation += "  " + name + " = " + type + "(0.0);\n";
+            break;
+        }
+    }
+    return declarations + implementation + "}\n";
+}
+
+std::vector<std::string> VectorFieldRenderer::channelAttributes() const {
+    std::vector<std::string> attributes;
+    for (const auto& name : m_vf.channelNames()) {
+        attributes.push_back("ivChannel_" + name);
+    }
+    return attributes;
+}
+
+void VectorFieldRenderer::bindChannelData(unsigned int first_attribute_index, unsigned int divisor) const {
+    auto& channel_buffers = m_shared_buffers->channel_buffers;
+    const auto names = m_vf.channelNames();
+    // forget the buffers of removed channels
+    for (auto channel_buffer = channel_buffers.begin(); channel_buffer != channel_buffers.end();) {
+        if (m_vf.channelNumComponents(channel_buffer->first) == 0) {
+            channel_buffer = channel_buffers.erase(channel_buffer);
+        } else {
+            ++channel_buffer;
+        }
+    }
+    // channels are padded with zeros or cut to the number of directions, so
+    // that no values are read from beyond their buffers
+    const Geometry::index_type num_points = numDirections();
+    const bool has_num_points_changed = (num_points != m_shared_buffers->num_channel_points);
+    m_shared_buffers->num_channel_points = num_points;
+    m_num_channel_points = num_points;
+    unsigned int attribute_index = first_attribute_index;
+    for (const auto& name : names) {
+        auto& channel_buffer = channel_buffers[name];
+        if (!channel_buffer.first) {
+            channel_buffer.first.reset(new Utilities::GpuBuffer(GL_ARRAY_BUFFER));
+        }
+        channel_buffer.first->bind();
+        if (channel_buffer.second != m_vf.channelUpdateId(name) || has_num_points_changed) {
+            channel_buffer.second = m_vf.channelUpdateId(name);
+            const auto& values = m_vf.channelValues(name);
+            const std::size_t num_values = num_points * m_vf.channelNumComponents(name);
+            if (values.size() >= num_values) {
+                channel_buffer.first->upload(values.data(), sizeof(float) * num_values);
+            } else {
+                std::vector<float> padded_values(values);
+                padded_values.resize(num_values, 0.0f);
+                channel_buffer.first->upload(padded_values);
+            }
+        }
+        glVertexAttribPointer(attribute_index, m_vf.channelNumComponents(name), GL_FLOAT, false, 0, nullptr);
+        glEnableVertexAttribArray(attribute_index);
+        glVertexAttribDivisor(attribute_index, divisor);
+        attribute_index++;
+    }
+    for (unsigned int i = attribute_index; i < first_attribute_index + m_num_channel_attributes; i++) {
+        glDisableVertexAttribArray(i);
+    }
+    m_num_channel_attributes = names.size();
+}
+
+Geometry::index_type VectorFieldRenderer::numDirections() const {
+    return m_vf.numVectors();
+}
+
 void VectorFieldRenderer::updateIfNecessary() {
+    m_vf.acquirePublishedVectors();
+    if (m_direction_encoding != m_vf.directionEncoding() || m_position_encoding != m_vf.positionEncoding() || m_channels_layout_id != m_vf.channelsLayoutId()) {
+        m_direction_encoding = m_vf.directionEncoding();
+        m_position_encoding = m_vf.positionEncoding();
+        m_channels_layout_id = m_vf.channelsLayoutId();
+        updateShaderProgram();
+    }
+    if (m_channels_update_id != m_vf.channelsUpdateId() || m_num_channel_points != numDirections()) {
+        updateChannels();
+        m_channels_update_id = m_vf.channelsUpdateId();
+    }
     if (m_geometry_update_id != m_vf.geometryUpdateId()) {
         update(false);
         m_geometry_update_id = m_vf.geometryUpdateId();
+        m_positions_update_id = m_vf.positionsUpdateId();
         m_vectors_update_id = m_vf.vectorsUpdateId();
-    } else if (m_vectors_update_id != m_vf.vectorsUpdateId()) {
+        return;
+    }
+    if (m_positions_update_id != m_vf.positionsUpdateId()) {
+        updatePositions();
+        m_positions_update_id = m_vf.positionsUpdateId();
+    }
+    if (m_vectors_update_id != m_vf.vectorsUpdateId()) {
         update(true);
         m_vectors_update_id = m_vf.vectorsUpdateId();
     }
 }
 
+void VectorFieldRenderer::updatePositions() {
+    update(false);
+}
+
 }
@@ -11,6 +11,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "VFRendering/Utilities.hxx"
+#include "GpuBuffer.hxx"
 
 #include "shaders/sphere_points.vert.glsl.hxx"
 #include "shaders/sphere_points.frag.glsl.hxx"
@@ -28,19 +29,14 @@ void VectorSphereRenderer::initialize() {
 
     glGenVertexArrays(1, &m_sphere_points_vao);
     glBindVertexArray(m_sphere_points_vao);
-    glGenBuffers(1, &m_sphere_points_positions_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, m_sphere_points_positions_vbo);
-    glVertexAttribPointer(0, 3, GL_FLOAT, false, 0, nullptr);
+    // the positions and directions are bound in update
     glEnableVertexAttribArray(0);
-    glGenBuffers(1, &m_sphere_points_directions_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, m_sphere_points_directions_vbo);
-    glVertexAttribPointer(1, 3, GL_FLOAT, false, 0, nullptr);
     glEnableVertexAttribArray(1);
 
     glGenVertexArrays(1, &m_sphere_background_vao);
     glBindVertexArray(m_sphere_background_vao);
-    glGenBuffers(1, &m_sphere_background_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, m_sphere_background_vbo);
+    m_sphere_background_vbo.reset(new Utilities::GpuBuffer(GL_ARRAY_BUFFER));
+    m_sphere_background_vbo->bind();
     glVertexAttribPointer(0, 3, GL_FLOAT, false, 0, nullptr);
     std::vector<GLfloat> vertices = {
         -1, -1, 0,
@@ -50,11 +46,12 @@ void VectorSphereRenderer::initialize() {
         1, -1, 0,
         1, 1, 0
     };
-    glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
+    m_sphere_background_vbo->upload(vertices);
     glEnableVertexAttribArray(0);
 
     updateShaderProgram();
     update(false);
+    updateChannels();
 }
 
 VectorSphereRenderer::~VectorSphereRenderer() {
@@ -63,11 +60,16 @@ VectorSphereRenderer::~VectorSphereRenderer() {
     }
     glDeleteVertexArrays(1, &m_sphere_points_vao);
     glDeleteVertexArrays(1, &m_sphere_background_vao);
-    glDeleteBuffers(1, &m_sphere_background_vbo);
-    glDeleteBuffers(1, &m_sphere_points_positions_vbo);
-    glDeleteBuffers(1, &m_sphere_points_directions_vbo);
-    glDeleteProgram(m_sphere_points_program);
-    glDeleteProgram(m_sphere_background_program);
+    Utilities::releaseProgram(m_view, m_sphere_points_program);
+    Utilities::releaseProgram(m_view, m_sphere_background_program);
+}
+
+std::size_t VectorSphereRenderer::gpuMemoryUsage() const {
+    std::size_t memory_usage = VectorFieldRenderer::gpuMemoryUsage();
+    if (m_is_initialized) {
+        memory_usage += m_sphere_background_vbo->capacity();
+    }
+    return memory_usage;
 }
 
 void VectorSphereRenderer::optionsHaveChanged(const std::vector<int>& changed_options) {
@@ -92,13 +94,28 @@ void VectorSphereRenderer::update(bool keep_geometry) {
     if (!m_is_initialized) {
         return;
     }
+    glBindVertexArray(m_sphere_points_vao);
     if (!keep_geometry) {
-        glBindBuffer(GL_ARRAY_BUFFER, m_sphere_points_positions_vbo);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * positions().size(), positions().data(), GL_STREAM_DRAW);
+        bindPositionData(0);
     }
-    glBindBuffer(GL_ARRAY_BUFFER, m_sphere_points_directions_vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * directions().size(), directions().data(), GL_STREAM_DRAW);
-    m_num_instances = directions().size();
+    bindDirectionData(1);
+    m_num_instances = numDirections();
+}
+
+void VectorSphereRenderer::updatePositions() {
+    if (!m_is_initialized) {
+        return;
+    }
+    glBindVertexArray(m_sphere_points_vao);
+    bindPositionData(0);
+}
+
+void VectorSphereRenderer::updateChannels() {
+    if (!m_is_initialized) {
+        return;
+    }
+    glBindVertexArray(m_sphere_points_vao);
+    bindChannelData(2, 0);
 }
 
 void VectorSphereRenderer::draw(float aspect_ratio) {
@@ -111,8 +128,8 @@ void VectorSphereRenderer::draw(float aspect_ratio) {
         glUseProgram(m_sphere_background_program);
 
         glBindVertexArray(m_sphere_background_vao);
-        glUniform1f(glGetUniformLocation(m_sphere_background_program, "uAspectRatio"), aspect_ratio);
-        glUniform1f(glGetUniformLocation(m_sphere_background_program, "uInnerSphereRadius"), inner_sphere_radius);
+        glUniform1f(m_background_aspect_ratio_location, aspect_ratio);
+        glUniform1f(m_background_inner_sphere_radius_location, inner_sphere_radius);
         glDisable(GL_CULL_FACE);
         glDepthMask(false);
         glDrawArrays(GL_TRIANGLES, 0, 6);
@@ -126,6 +143,8 @@ void VectorSphereRenderer::draw(float aspect_ratio) {
 
     glUseProgram(m_sphere_points_program);
     glBindVertexArray(m_sphere_points_vao);
+    setColormapUniforms();
+    setDecodingUniforms();
 
     glm::vec3 camera_position = options().get<View::Option::CAMERA_POSITION>();
     glm::vec3 center_position = options().get<View::Option::CENTER_POSITION>();
@@ -141,18 +160,16 @@ void VectorSphereRenderer::draw(float aspect_ratio) {
     glm::mat4 modelview_matrix = glm::lookAt(glm::normalize(camera_position - center_position), {0, 0, 0}, upVector);
     glm::vec4 light_position = modelview_matrix * glm::vec4(camera_position, 1.0f);
 
-    glUniformMatrix4fv(glGetUniformLocation(m_sphere_points_program, "uProjectionMatrix"), 1, false, glm::value_ptr(projection_matrix));
-    glUniformMatrix4fv(glGetUniformLocation(m_sphere_points_program, "uModelviewMatrix"), 1, false, glm::value_ptr(modelview_matrix));
-    glUniform3f(glGetUniformLocation(m_sphere_points_program, "uLightPosition"), light_position[0], light_position[1], light_position[2]);
-    glUniform2f(glGetUniformLocation(m_sphere_points_program, "uPointSizeRange"), point_size_range[0], point_size_range[1]);
+    useCamera(m_sphere_points_program, projection_matrix, modelview_matrix, glm::vec3(light_position));
+    glUniform2f(m_point_size_range_location, point_size_range[0], point_size_range[1]);
 
-    glUniform1f(glGetUniformLocation(m_sphere_points_program, "uAspectRatio"), aspect_ratio);
-    glUniform1f(glGetUniformLocation(m_sphere_points_program, "uInnerSphereRadius"), inner_sphere_radius);
+    glUniform1f(m_points_aspect_ratio_location, aspect_ratio);
+    glUniform1f(m_points_inner_sphere_radius_location, inner_sphere_radius);
     bool use_sphere_fake_perspective = options().get<VectorSphereRenderer::Option::USE_SPHERE_FAKE_PERSPECTIVE>();
     if (use_sphere_fake_perspective) {
-        glUniform1f(glGetUniformLocation(m_sphere_points_program, "uUseFakePerspective"), 1.0f);
+        glUniform1f(m_use_fake_perspective_location, 1.0f);
     } else {
-        glUniform1f(glGetUniformLocation(m_sphere_points_program, "uUseFakePerspective"), 0.0f);
+        glUniform1f(m_use_fake_perspective_location, 0.0f);
     }
 
 #ifndef __EMSCRIPTEN__
@@ -172,21 +189,39 @@ void VectorSphereRenderer::updateShaderProgram() {
     }
     {
         if (m_sphere_points_program) {
-            glDeleteProgram(m_sphere_points_program);
+            Utilities::releaseProgram(m_view, m_sphere_points_program);
+            m_sphere_points_program = 0;
         }
         std::string vertex_shader_source = SPHERE_POINTS_VERT_GLSL;
+        vertex_shader_source += channelsImplementation(ChannelSource::ATTRIBUTES);
+        vertex_shader_source += directionDecodingImplementation();
+        vertex_shader_source += positionDecodingImplementation();
         std::string fragment_shader_source = SPHERE_POINTS_FRAG_GLSL;
+        fragment_shader_source += channelsImplementation(ChannelSource::VARYINGS);
         fragment_shader_source += options().get<View::Option::COLORMAP_IMPLEMENTATION>();
         fragment_shader_source += options().get<View::Option::IS_VISIBLE_IMPLEMENTATION>();
-        m_sphere_points_program = Utilities::createProgram(vertex_shader_source, fragment_shader_source, {"ivPosition", "ivDirection"});
+        std::vector<std::string> attributes = {"ivPosition", "ivDirection"};
+        for (const auto& attribute : channelAttributes()) {
+            attributes.push_back(attribute);
+        }
+        m_sphere_points_program = Utilities::createProgram(m_view, vertex_shader_source, fragment_shader_source, attributes);
+        m_point_size_range_location = glGetUniformLocation(m_sphere_points_program, "uPointSizeRange");
+        m_points_aspect_ratio_location = glGetUniformLocation(m_sphere_points_program, "uAspectRatio");
+        m_points_inner_sphere_radius_location = glGetUniformLocation(m_sphere_points_program, "uInnerSphereRadius");
+        m_use_fake_perspective_location = glGetUniformLocation(m_sphere_points_program, "uUseFakePerspective");
+        resolveColormapUniforms(m_sphere_points_program);
+        resolveDecodingUniforms(m_sphere_points_program);
     }
     {
         if (m_sphere_background_program) {
-            glDeleteProgram(m_sphere_background_program);
+            Utilities::releaseProgram(m_view, m_sphere_background_program);
+            m_sphere_background_program = 0;
         }
         std::string vertex_shader_source = SPHERE_BACKGROUND_VERT_GLSL;
         std::string fragment_shader_source = SPHERE_BACKGROUND_FRAG_GLSL;
-        m_sphere_background_program = Utilities::createProgram(vertex_shader_source, fragment_shader_source, {"ivPosition"});
+        m_sphere_background_program = Utilities::createProgram(m_view, vertex_shader_source, fragment_shader_source, {"ivPosition"});
+        m_background_aspect_ratio_location = glGetUniformLocation(m_sphere_background_program, "uAspectRatio");
+        m_background_inner_sphere_radius_location = glGetUniformLocation(m_sphere_background_program, "uInnerSphereRadius");
     }
 }
 }
@@ -1,5 +1,6 @@
 #include "VectorfieldIsosurface.hxx"
 
+#include <algorithm>
 #include <iostream>
 #include <map>
 #include <limits>
@@ -9,7 +10,8 @@
 namespace VFRendering {
 class VectorfieldIsosurfaceCalculation {
 public:
-    VectorfieldIsosurfaceCalculation(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& directions, const std::vector<float>& values, float isovalue) : in_positions(positions), in_directions(directions), in_values(values), in_isovalue(isovalue) {}
+    VectorfieldIsosurfaceCalculation(const Geometry& geometry, const std::vector<glm::vec3>& directions, const std::vector<float>& values, float isovalue) : in_geometry(&geometry), in_positions(nullptr), in_directions(directions), in_values(values), in_isovalue(isovalue) {}
+    VectorfieldIsosurfaceCalculation(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& directions, const std::vector<float>& values, float isovalue) : in_geometry(nullptr), in_positions(positions.data()), in_directions(directions), in_values(values), in_isovalue(isovalue) {}
 
     void addTetrahedron(std::array<Geometry::index_type, 4> t);
     VectorfieldIsosurface getResultAndReset();
@@ -21,13 +23,18 @@ private:
     template<int NUM_INSIDE_POINTS>
     void generateTriangle(index_type i1, index_type i2, index_type i3, const std::array<glm::vec3, NUM_INSIDE_POINTS>& inside_points, bool flip_normal);
 
+    glm::vec3 position(index_type i) const {
+        return in_positions ? in_positions[i] : in_geometry->position(i);
+    }
     index_type getIsopointIndex(const edge_type& edge);
 
     void generateOneTetrahedronTriangle(index_type in_i1, index_type out_i1, index_type out_i2, index_type out_i3, bool flip_normal);
     void generateTwoTetrahedronTriangles(index_type in_i1, index_type in_i2, index_type out_i1, index_type out_i2, bool flip_normal);
 
-    // input
-    const std::vector<glm::vec3>& in_positions;
+    // input, with positions either generated by a geometry or borrowed from
+    // an array
+    const Geometry* in_geometry;
+    const glm::vec3* in_positions;
     const std::vector<glm::vec3>& in_directions;
     const std::vector<float>& in_values;
     float in_isovalue;
@@ -129,8 +136,8 @@ VectorfieldIsosurfaceCalculation::index_type VectorfieldIsosurfaceCalculation::g
             }
         }
 
-        glm::vec3 left_point = in_positions[edge.first];
-        glm::vec3 right_point = in_positions[edge.second];
+        glm::vec3 left_point = position(edge.first);
+        glm::vec3 right_point = position(edge.second);
         glm::vec3 isopoint = glm::mix(left_point, right_point, alpha);
 
         glm::vec3 left_direction = in_directions[edge.first];
@@ -152,7 +159,7 @@ void VectorfieldIsosurfaceCalculation::generateOneTetrahedronTriangle(index_type
     index_type i1 = getIsopointIndex({in_i1, out_i1});
     index_type i2 = getIsopointIndex({in_i1, out_i2});
     index_type i3 = getIsopointIndex({in_i1, out_i3});
-    generateTriangle<1>(i1, i2, i3, {{in_positions[in_i1]}}, flip_normal);
+    generateTriangle<1>(i1, i2, i3, {{position(in_i1)}}, flip_normal);
 }
 
 void VectorfieldIsosurfaceCalculation::generateTwoTetrahedronTriangles(index_type in_i1, index_type in_i2, index_type out_i1, index_type out_i2, bool flip_normal) {
@@ -160,8 +167,8 @@ void VectorfieldIsosurfaceCalculation::generateTwoTetrahedronTriangles(index_typ
     index_type i2 = getIsopointIndex({in_i1, out_i2});
     index_type i3 = getIsopointIndex({in_i2, out_i1});
     index_type i4 = getIsopointIndex({in_i2, out_i2});
-    generateTriangle<2>(i1, i4, i2, {{in_positions[in_i1], in_positions[in_i2]}}, flip_normal);
-    generateTriangle<2>(i1, i4, i3, {{in_positions[in_i1], in_positions[in_i2]}}, flip_normal);
+    generateTriangle<2>(i1, i4, i2, {{position(in_i1), position(in_i2)}}, flip_normal);
+    generateTriangle<2>(i1, i4, i3, {{position(in_i1), position(in_i2)}}, flip_normal);
 }
 
 void VectorfieldIsosurfaceCalculation::addTetrahedron(std::array<Geometry::index_type, 4> t) {
@@ -242,10 +249,33 @@ void VectorfieldIsosurfaceCalculation::addTetrahedron(std::array<Geometry::index
 }
 
 VectorfieldIsosurface VectorfieldIsosurface::calculate(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& directions, const std::vector<float>& values, float isovalue, const std::vector<std::array<Geometry::index_type, 4>>& tetrahedra) {
+    // the positions are borrowed, as a geometry would copy them
     VectorfieldIsosurfaceCalculation calculation(positions, directions, values, isovalue);
     for (auto& t : tetrahedra) {
         calculation.addTetrahedron(t);
     }
     return calculation.getResultAndReset();
 }
+
+VectorfieldIsosurface VectorfieldIsosurface::calculate(const Geometry& geometry, const std::vector<glm::vec3>& directions, const std::vector<float>& values, float isovalue) {
+    VectorfieldIsosurfaceCalculation calculation(geometry, directions, values, isovalue);
+    if (!geometry.isImplicit()) {
+        for (auto& t : geometry.volumeIndices()) {
+            calculation.addTetrahedron(t);
+        }
+        return calculation.getResultAndReset();
+    }
+    // implicit geometries generate their tetrahedra in chunks
+    const Geometry::index_type chunk_size = 1 << 16;
+    Geometry::index_type num_tetrahedra = geometry.numVolumeTetrahedra();
+    std::vector<std::array<Geometry::index_type, 4>> chunk(std::min(num_tetrahedra, chunk_size));
+    for (Geometry::index_type first = 0; first < num_tetrahedra; first += chunk_size) {
+        Geometry::index_type chunk_count = std::min(num_tetrahedra - first, chunk_size);
+        geometry.copyVolumeIndices(first, chunk_count, chunk.data());
+        for (Geometry::index_type i = 0; i < chunk_count; i++) {
+            calculation.addTetrahedron(chunk[i]);
+        }
+    }
+    return calculation.getResultAndReset();
+}
 }
@@ -1,5 +1,8 @@
 #include "VFRendering/View.hxx"
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <iostream>
 
 #include <glm/gtx/transform.hpp>
@@ -17,9 +20,21 @@
 #include "VFRendering/BoundingBoxRenderer.hxx"
 #include "VFRendering/CombinedRenderer.hxx"
 #include "VFRendering/CoordinateSystemRenderer.hxx"
+#include "CameraBlock.hxx"
+#include "GpuBuffer.hxx"
+#include "ProgramCache.hxx"
 
 namespace VFRendering {
-View::View() { }
+static float viewportAspectRatio(const std::array<float, 4>& viewport, const glm::vec2& framebuffer_size) {
+    return viewport[2] * framebuffer_size.x / viewport[3] / framebuffer_size.y;
+}
+
+static std::uint64_t nextViewId() {
+    static std::atomic<std::uint64_t> next_view_id{0};
+    return next_view_id++;
+}
+
+View::View() : m_id(nextViewId()), m_program_cache(new Utilities::ProgramCache()) { }
 
 void View::initialize() {
     if (m_is_initialized) {
@@ -37,6 +52,13 @@ void View::initialize() {
     glGetError();
     glEnable(GL_DEPTH_TEST);
     glDepthFunc(GL_LESS);
+
+#ifndef __EMSCRIPTEN__
+    m_camera_buffer.reset(new Utilities::GpuBuffer(GL_UNIFORM_BUFFER));
+    GLint alignment = 1;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    m_camera_block_stride = (sizeof(Utilities::CameraBlock) + alignment - 1) / alignment * alignment;
+#endif
 }
 
 View::~View() {}
@@ -48,21 +70,54 @@ void View::draw() {
         glClearColor(background_color.x, background_color.y, background_color.z, 1.0);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     }
-    for (auto it : m_renderers) {
-        auto renderer = it.first;
-        auto viewport = it.second;
+    updateCameraBlocks();
+    m_is_drawing = true;
+    for (std::size_t i = 0; i < m_renderers.size(); i++) {
+        auto renderer = m_renderers[i].first;
+        auto viewport = m_renderers[i].second;
         float width = m_framebuffer_size.x;
         float height = m_framebuffer_size.y;
         glViewport((GLint)(viewport[0] * width), (GLint)(viewport[1] * height), (GLsizei)(viewport[2] * width), (GLsizei)(viewport[3] * height));
         if (m_options.get<View::Option::CLEAR>()) {
             glClear(GL_DEPTH_BUFFER_BIT);
         }
+        m_camera_block_index = m_camera_block_indices.empty() ? 0 : m_camera_block_indices[i];
+        m_viewport_aspect_ratio = viewportAspectRatio(viewport, m_framebuffer_size);
         renderer->updateIfNecessary();
-        renderer->draw(viewport[2] * width / viewport[3] / height);
+        renderer->draw(m_viewport_aspect_ratio);
     }
+    m_is_drawing = false;
+    Utilities::writeProgramBinaries(*m_program_cache);
     m_fps_counter.tick();
 }
 
+void View::updateCameraBlocks() {
+    if (!m_camera_buffer) {
+        return;
+    }
+    // viewports with the same aspect ratio share a camera block, so usually
+    // only one or two blocks have to be calculated
+    std::vector<float> aspect_ratios;
+    m_camera_block_indices.resize(m_renderers.size());
+    for (std::size_t i = 0; i < m_renderers.size(); i++) {
+        float aspect_ratio = viewportAspectRatio(m_renderers[i].second, m_framebuffer_size);
+        auto it = std::find(aspect_ratios.begin(), aspect_ratios.end(), aspect_ratio);
+        m_camera_block_indices[i] = it - aspect_ratios.begin();
+        if (it == aspect_ratios.end()) {
+            aspect_ratios.push_back(aspect_ratio);
+        }
+    }
+    std::vector<char> camera_blocks(m_camera_block_stride * aspect_ratios.size());
+    for (std::size_t i = 0; i < aspect_ratios.size(); i++) {
+        Utilities::CameraBlock camera_block = Utilities::getCameraBlock(m_options, aspect_ratios[i]);
+        std::memcpy(camera_blocks.data() + i * m_camera_block_stride, &camera_block, sizeof(camera_block));
+    }
+    if (camera_blocks != m_camera_blocks) {
+        m_camera_blocks.swap(camera_blocks);
+        m_camera_buffer->upload(m_camera_blocks);
+    }
+}
+
 float View::getFramerate() const {
     return m_fps_counter.getFramerate();
 }
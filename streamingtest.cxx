@@ -0,0 +1,285 @@
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <glad/glad.h>
+
+#include "VFRendering/View.hxx"
+#include "VFRendering/ArrowRenderer.hxx"
+#include "VFRendering/CombinedRenderer.hxx"
+#include "VFRendering/SnapshotSequence.hxx"
+#include "VFRendering/SurfaceRenderer.hxx"
+#include "VFRendering/Utilities.hxx"
+#include "StreamingBuffer.hxx"
+
+// Checks that streamed vector data reaches the GPU unchanged, both with
+// persistently mapped ring buffers and, when run with --no-buffer-storage,
+// with the orphaning fallback, and that vector fields keep their vectors
+// after a snapshot sequence showing them is destroyed. Runs headless, e.g. on
+// Mesa llvmpipe.
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+#ifndef EGL_NO_CONFIG_KHR
+#define EGL_NO_CONFIG_KHR static_cast<EGLConfig>(0)
+#endif
+
+static const int framebuffer_size = 128;
+
+static bool createContext() {
+    EGLDisplay display = EGL_NO_DISPLAY;
+    auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    if (getPlatformDisplay) {
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+    if (display == EGL_NO_DISPLAY) {
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+    if (!eglInitialize(display, nullptr, nullptr)) {
+        return false;
+    }
+    // rendering goes to a framebuffer object, so no config is needed where
+    // EGL_KHR_no_config_context is supported, e.g. on surfaceless Mesa
+    const EGLint config_attributes[] = {EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+    EGLConfig config = EGL_NO_CONFIG_KHR;
+    EGLint num_configs = 0;
+    if (!eglChooseConfig(display, config_attributes, &config, 1, &num_configs) || num_configs < 1) {
+        config = EGL_NO_CONFIG_KHR;
+    }
+    eglBindAPI(EGL_OPENGL_API);
+    const EGLint context_attributes[] = {EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 3, EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, EGL_NONE};
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attributes);
+    if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        return false;
+    }
+    if (!gladLoadGL()) {
+        return false;
+    }
+    GLuint framebuffer, renderbuffers[2];
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glGenRenderbuffers(2, renderbuffers);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, framebuffer_size, framebuffer_size);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, framebuffer_size, framebuffer_size);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+    return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+}
+
+static bool check(bool condition, const std::string& message) {
+    if (!condition) {
+        std::cerr << "FAILED: " << message << std::endl;
+    }
+    return condition;
+}
+
+static bool bufferContains(const VFRendering::Utilities::StreamingBuffer& buffer, const std::vector<float>& expected_data) {
+    std::vector<float> data(expected_data.size());
+    buffer.bind();
+    glGetBufferSubData(GL_ARRAY_BUFFER, buffer.offset(), data.size() * sizeof(float), data.data());
+    return data == expected_data;
+}
+
+static bool checkStreamingBuffer(bool is_persistent) {
+    bool success = true;
+    VFRendering::Utilities::StreamingBuffer buffer;
+
+    // data growing by 100 values per update, so that segments growing only
+    // to the requested size would reallocate the ring on every update
+    std::vector<float> data;
+    std::size_t num_capacity_changes = 0;
+    std::size_t capacity = 0;
+    for (std::size_t size = 1000; size < 5000; size += 100) {
+        data.resize(size);
+        for (std::size_t i = 0; i < size; i++) {
+            data[i] = static_cast<float>(size * 10000 + i);
+        }
+        void* mapped_data = buffer.map(data.size() * sizeof(float));
+        std::memcpy(mapped_data, data.data(), data.size() * sizeof(float));
+        buffer.unmap();
+        success &= check(bufferContains(buffer, data), "full update of " + std::to_string(size) + " values");
+        if (buffer.capacity() != capacity) {
+            capacity = buffer.capacity();
+            num_capacity_changes++;
+        }
+    }
+    if (is_persistent) {
+        success &= check(num_capacity_changes < 10, "growing data reallocated the ring " + std::to_string(num_capacity_changes) + " times");
+    }
+
+    // partial updates, cycling through all segments of the ring several times
+    for (int update = 0; update < 10; update++) {
+        std::vector<std::array<std::size_t, 2>> ranges;
+        for (std::size_t first = 17 * update; first + 50 <= data.size(); first += 200 + update) {
+            ranges.push_back({{first * sizeof(float), 50 * sizeof(float)}});
+        }
+        char* mapped_data = static_cast<char*>(buffer.mapRanges(ranges));
+        for (const auto& range : ranges) {
+            float* values = reinterpret_cast<float*>(mapped_data + range[0]);
+            for (std::size_t i = 0; i < range[1] / sizeof(float); i++) {
+                data[range[0] / sizeof(float) + i] = -static_cast<float>(update * 10000 + i);
+                values[i] = data[range[0] / sizeof(float) + i];
+            }
+        }
+        buffer.unmap();
+        success &= check(bufferContains(buffer, data), "partial update " + std::to_string(update));
+    }
+    success &= check(glGetError() == GL_NO_ERROR, "OpenGL error in streaming buffer");
+    return success;
+}
+
+static std::vector<unsigned char> drawnPixels(VFRendering::View& view) {
+    view.draw();
+    std::vector<unsigned char> pixels(framebuffer_size * framebuffer_size * 4);
+    glReadPixels(0, 0, framebuffer_size, framebuffer_size, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    return pixels;
+}
+
+static void addRenderers(VFRendering::View& view, VFRendering::VectorField& vf) {
+    VFRendering::Options options;
+    options.set<VFRendering::View::Option::CAMERA_POSITION>({0, 0, 30});
+    options.set<VFRendering::View::Option::CENTER_POSITION>({0, 0, 0});
+    // the default colormap is white, which would hide the directions
+    options.set<VFRendering::View::Option::COLORMAP_IMPLEMENTATION>(VFRendering::Utilities::getColormapImplementation(VFRendering::Utilities::Colormap::HSV));
+    view.updateOptions(options);
+    view.setFramebufferSize(framebuffer_size, framebuffer_size);
+    std::vector<std::shared_ptr<VFRendering::RendererBase>> renderers = {
+        std::make_shared<VFRendering::ArrowRenderer>(view, vf),
+        std::make_shared<VFRendering::SurfaceRenderer>(view, vf)
+    };
+    view.renderers({{std::make_shared<VFRendering::CombinedRenderer>(view, renderers), {{0, 0, 1, 1}}}});
+}
+
+static std::size_t numLitPixels(const std::vector<unsigned char>& pixels) {
+    std::size_t num_lit_pixels = 0;
+    for (std::size_t i = 0; i < pixels.size(); i += 4) {
+        num_lit_pixels += (pixels[i] > 0 || pixels[i + 1] > 0 || pixels[i + 2] > 0);
+    }
+    return num_lit_pixels;
+}
+
+static bool checkRenderedVectors(bool is_persistent) {
+    bool success = true;
+    std::vector<float> coordinates;
+    for (int i = 0; i < 30; i++) {
+        coordinates.push_back(-10 + 20 * i / 29.0f);
+    }
+    auto geometry = VFRendering::Geometry::rectilinearGeometry(coordinates, coordinates, {0});
+    std::vector<glm::vec3> directions(geometry.numPositions(), glm::vec3(0, 0, 1));
+    VFRendering::VectorField vf(geometry, directions);
+    VFRendering::View view;
+    addRenderers(view, vf);
+    view.draw();
+    if (!is_persistent) {
+        // the view loads OpenGL functions when it is drawn for the first time
+        GLAD_GL_ARB_buffer_storage = 0;
+    }
+    std::vector<unsigned char> previous_pixels;
+    for (int frame = 0; frame < 8; frame++) {
+        for (std::size_t i = 0; i < directions.size(); i++) {
+            float angle = 0.3f * frame + 0.01f * i;
+            directions[i] = glm::vec3(std::cos(angle), std::sin(angle), std::sin(0.7f * angle));
+        }
+        if (frame % 2 == 1) {
+            vf.updateVectors(100, 300, directions.data() + 100);
+            vf.updateVectors(600, directions.size() - 600, directions.data() + 600);
+        } else {
+            vf.updateVectors(directions);
+        }
+        std::vector<unsigned char> pixels = drawnPixels(view);
+
+        if (frame % 2 == 1) {
+            // vectors that were not updated keep their previous directions
+            for (std::size_t i = 0; i < directions.size(); i++) {
+                if (i < 100 || (i >= 400 && i < 600)) {
+                    float angle = 0.3f * (frame - 1) + 0.01f * i;
+                    directions[i] = glm::vec3(std::cos(angle), std::sin(angle), std::sin(0.7f * angle));
+                }
+            }
+        }
+        VFRendering::VectorField expected_vf(geometry, directions);
+        VFRendering::View expected_view;
+        addRenderers(expected_view, expected_vf);
+        std::vector<unsigned char> expected_pixels = drawnPixels(expected_view);
+        if (!is_persistent) {
+            GLAD_GL_ARB_buffer_storage = 0;
+        }
+        // make sure the comparison is meaningful: the field covers a large
+        // part of the frame and its colors change from frame to frame
+        success &= check(numLitPixels(expected_pixels) > expected_pixels.size() / 16, "too few lit pixels in frame " + std::to_string(frame));
+        success &= check(expected_pixels != previous_pixels, "frame " + std::to_string(frame) + " equals the previous frame");
+        success &= check(pixels == expected_pixels, "rendered vectors of frame " + std::to_string(frame));
+        previous_pixels = expected_pixels;
+    }
+    success &= check(glGetError() == GL_NO_ERROR, "OpenGL error while rendering");
+    return success;
+}
+
+static bool checkDestroyedSnapshotSequence(bool is_compressed) {
+    bool success = true;
+    const std::string path = is_compressed ? "streamingtest_snapshots.vfrz" : "streamingtest_snapshots.vfr";
+    std::vector<float> coordinates;
+    for (int i = 0; i < 30; i++) {
+        coordinates.push_back(-10 + 20 * i / 29.0f);
+    }
+    auto geometry = VFRendering::Geometry::rectilinearGeometry(coordinates, coordinates, {0});
+    std::vector<glm::vec3> directions(geometry.numPositions());
+    // multiples of the quantization step, so that compression is lossless
+    const float quantization_step = 1.0f / 1024;
+    for (std::size_t i = 0; i < directions.size(); i++) {
+        float angle = 0.01f * i;
+        directions[i] = glm::round(glm::vec3(std::cos(angle), std::sin(angle), 0.5f) / quantization_step) * quantization_step;
+    }
+    if (is_compressed) {
+        VFRendering::CompressedSnapshotSequenceWriter writer(path, directions.size(), quantization_step);
+        writer.appendFrame(directions);
+    } else {
+        VFRendering::SnapshotSequenceWriter writer(path, directions.size());
+        writer.appendFrame(directions);
+    }
+    VFRendering::VectorField vf(geometry, std::vector<glm::vec3>(directions.size(), glm::vec3(0, 0, 1)));
+    VFRendering::View view;
+    addRenderers(view, vf);
+    {
+        VFRendering::SnapshotSequence sequence(vf, path, 0);
+        success &= check(sequence.isValid(), "could not open " + path);
+        view.draw();
+    }
+    std::remove(path.c_str());
+
+    VFRendering::VectorField expected_vf(geometry, directions);
+    VFRendering::View expected_view;
+    addRenderers(expected_view, expected_vf);
+    std::vector<unsigned char> expected_pixels = drawnPixels(expected_view);
+    success &= check(vf.statistics().max == expected_vf.statistics().max && vf.statistics().min == expected_vf.statistics().min, "statistics after destroying the sequence of " + path);
+    success &= check(drawnPixels(view) == expected_pixels, "rendered vectors after destroying the sequence of " + path);
+    return success;
+}
+
+int main(int argc, char** argv) {
+    bool is_persistent = !(argc > 1 && std::string(argv[1]) == "--no-buffer-storage");
+    if (!createContext()) {
+        std::cerr << "could not create an OpenGL 3.3 context" << std::endl;
+        return 1;
+    }
+    std::cout << "OpenGL " << glGetString(GL_VERSION) << " / " << glGetString(GL_RENDERER) << std::endl;
+    if (is_persistent && !GLAD_GL_ARB_buffer_storage) {
+        std::cerr << "ARB_buffer_storage is not supported" << std::endl;
+        return 1;
+    }
+    GLAD_GL_ARB_buffer_storage = is_persistent;
+    bool success = checkStreamingBuffer(is_persistent);
+    success &= checkRenderedVectors(is_persistent);
+    success &= checkDestroyedSnapshotSequence(false);
+    success &= checkDestroyedSnapshotSequence(true);
+    std::cout << (success ? "passed" : "failed") << std::endl;
+    return success ? 0 : 1;
+}